@@ -0,0 +1,847 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "abp.h"
+
+#include <stdlib.h> /* qsort() */
+#include <string.h> /* strstr(), strrchr(), strcmp(), strcspn() */
+
+enum abp_action
+{
+	ABP_BLOCK,
+	ABP_CSS,
+	ABP_IGNORE,
+};
+
+enum abp_domains
+{
+	ABP_DOMAINS_ANY,
+	ABP_DOMAINS_IF,
+	ABP_DOMAINS_UNLESS,
+};
+
+#define ABP_LOAD_FIRST_PARTY (1u << 0)
+#define ABP_LOAD_THIRD_PARTY (1u << 1)
+
+/* WebKit resource types, resource_types being a bitmask of their indexes */
+static const gchar *abp_resource_types[] = {
+    "document",
+    "image",
+    "style-sheet",
+    "script",
+    "font",
+    "raw",
+    "svg-document",
+    "media",
+    "popup",
+};
+#define ABP_TYPES_ALL ((1u << G_N_ELEMENTS(abp_resource_types)) - 1)
+
+static const struct
+{
+	const gchar *option;
+	const gchar *type;
+} abp_type_options[] = {
+    {"document", "document"},
+    {"subdocument", "document"},
+    {"image", "image"},
+    {"stylesheet", "style-sheet"},
+    {"script", "script"},
+    {"font", "font"},
+    {"xmlhttprequest", "raw"},
+    {"websocket", "raw"},
+    {"ping", "raw"},
+    {"other", "raw"},
+    {"media", "media"},
+    {"object", "media"},
+    {"popup", "popup"},
+};
+
+/* Element-hiding selectors which are only understood by adblockers, not by WebKit */
+static const gchar *abp_procedural[] = {
+    ":-abp-",
+    ":has-text(",
+    ":contains(",
+    ":xpath(",
+    ":style(",
+    ":remove(",
+    ":matches-css",
+    ":upward(",
+    ":min-text-length(",
+    ":watch-attr(",
+};
+
+/* struct AbpRule: Filters sharing everything but their domains get merged into one rule
+ */
+struct AbpRule
+{
+	enum abp_action action;
+	gchar *url_filter;
+	gchar *selector;
+	guint resource_types;
+	guint load_types;
+	gboolean case_sensitive;
+
+	gboolean any_domain;
+	GHashTable *if_domain;     /* Union of the domains, NULL when none */
+	GHashTable *unless_domain; /* Intersection of the domains, NULL when none */
+};
+
+static void
+abp_rule_free(gpointer data)
+{
+	struct AbpRule *rule = data;
+
+	g_free(rule->url_filter);
+	g_free(rule->selector);
+	if(rule->if_domain != NULL) g_hash_table_destroy(rule->if_domain);
+	if(rule->unless_domain != NULL) g_hash_table_destroy(rule->unless_domain);
+	g_free(rule);
+}
+
+static void
+abp_string_free(gpointer data)
+{
+	g_string_free((GString *)data, TRUE);
+}
+
+static gboolean
+abp_unsupported(struct AbpCompiler *compiler, const gchar *reason)
+{
+	guint count = GPOINTER_TO_UINT(g_hash_table_lookup(compiler->unsupported, reason));
+
+	g_hash_table_insert(compiler->unsupported, g_strdup(reason), GUINT_TO_POINTER(count + 1));
+
+	return FALSE;
+}
+
+/* abp_pattern_to_regex: Translates the pattern of a network filter into a WebKit url-filter,
+ * which is a subset of regular expressions (no alternatives, no counted repetitions, ASCII only).
+ *
+ * Returns NULL when the pattern can't be translated.
+ */
+gchar *
+abp_pattern_to_regex(const gchar *pattern)
+{
+	gsize len      = strlen(pattern);
+	const gchar *p = pattern;
+	const gchar *end;
+	gboolean end_anchor = FALSE;
+	GString *re;
+
+	// Regular expression filters
+	if(len >= 2 && pattern[0] == '/' && pattern[len - 1] == '/') return NULL;
+
+	re = g_string_new(NULL);
+
+	if(g_str_has_prefix(p, "||"))
+	{
+		// Scheme, then the domain or any of its subdomains
+		g_string_append(re, "^[^:]+:(//)?([^/]+\\.)?");
+		p += 2;
+	}
+	else if(*p == '|')
+	{
+		g_string_append_c(re, '^');
+		p++;
+	}
+
+	end = pattern + len;
+	if(end > p && end[-1] == '|')
+	{
+		end_anchor = TRUE;
+		end--;
+	}
+
+	for(; p < end; p++)
+	{
+		switch(*p)
+		{
+		case '*':
+			if(!g_str_has_suffix(re->str, ".*")) g_string_append(re, ".*");
+			break;
+		case '^':
+			// Separator, which also matches the end of the address
+			if(p + 1 == end && !end_anchor)
+				g_string_append(re, "([^a-zA-Z0-9_.%-].*)?$");
+			else
+				g_string_append(re, "[^a-zA-Z0-9_.%-]");
+			break;
+		case '.':
+		case '+':
+		case '?':
+		case '$':
+		case '(':
+		case ')':
+		case '{':
+		case '}':
+		case '[':
+		case ']':
+		case '\\':
+		case '|':
+			g_string_append_c(re, '\\');
+			g_string_append_c(re, *p);
+			break;
+		default:
+			if((guchar)*p >= 0x80 || (guchar)*p < 0x20)
+			{
+				g_string_free(re, TRUE);
+				return NULL;
+			}
+			g_string_append_c(re, *p);
+			break;
+		}
+	}
+
+	if(end_anchor) g_string_append_c(re, '$');
+
+	if(re->len == 0) g_string_append(re, ".*");
+
+	return g_string_free(re, FALSE);
+}
+
+/* abp_parse_domains: Splits a domain list into WebKit if-domain and unless-domain entries,
+ * returns FALSE on domains WebKit can't match, like "example.*".
+ */
+static gboolean
+abp_parse_domains(const gchar *list,
+                  const gchar *separator,
+                  GPtrArray *if_domain,
+                  GPtrArray *unless_domain)
+{
+	gchar **domains = g_strsplit(list, separator, -1);
+	gboolean ok     = TRUE;
+
+	for(gchar **d = domains; *d != NULL && ok; d++)
+	{
+		const gchar *domain = *d;
+		gboolean negated    = domain[0] == '~';
+		gchar *ascii, *lower;
+
+		if(negated) domain++;
+		if(*domain == '\0') continue;
+
+		ascii = strchr(domain, '*') == NULL ? g_hostname_to_ascii(domain) : NULL;
+		if(ascii == NULL)
+		{
+			ok = FALSE;
+			break;
+		}
+
+		// "*" makes WebKit also match subdomains, like adblockers do
+		lower = g_ascii_strdown(ascii, -1);
+		g_ptr_array_add(negated ? unless_domain : if_domain, g_strconcat("*", lower, NULL));
+		g_free(lower);
+		g_free(ascii);
+	}
+
+	g_strfreev(domains);
+
+	return ok;
+}
+
+/* abp_compiler_rule: Adds a rule, taking ownership of its strings,
+ * merging it with an equivalent one when there is one.
+ */
+static gboolean
+abp_compiler_rule(struct AbpCompiler *compiler,
+                  struct AbpRule *new_rule,
+                  GPtrArray *if_domain,
+                  GPtrArray *unless_domain)
+{
+	struct AbpRule *rule;
+	gchar *key;
+
+	if(if_domain->len > 0 && unless_domain->len > 0)
+	{
+		g_free(new_rule->url_filter);
+		g_free(new_rule->selector);
+		return abp_unsupported(compiler, "both included and excluded domains");
+	}
+
+	key = g_strdup_printf("%d\n%s\n%s\n%u\n%u\n%d",
+	                      new_rule->action,
+	                      new_rule->url_filter,
+	                      new_rule->selector != NULL ? new_rule->selector : "",
+	                      new_rule->resource_types,
+	                      new_rule->load_types,
+	                      new_rule->case_sensitive);
+
+	rule = g_hash_table_lookup(compiler->rules, key);
+	if(rule == NULL)
+	{
+		rule  = g_malloc(sizeof(struct AbpRule));
+		*rule = *new_rule;
+
+		rule->any_domain    = FALSE;
+		rule->if_domain     = NULL;
+		rule->unless_domain = NULL;
+
+		g_hash_table_insert(compiler->rules, key, rule);
+		g_ptr_array_add(compiler->order, rule);
+	}
+	else
+	{
+		compiler->merged++;
+		g_free(key);
+		g_free(new_rule->url_filter);
+		g_free(new_rule->selector);
+	}
+
+	if(if_domain->len == 0 && unless_domain->len == 0)
+	{
+		rule->any_domain = TRUE;
+	}
+	else if(if_domain->len > 0)
+	{
+		if(rule->if_domain == NULL)
+			rule->if_domain = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+		for(guint i = 0; i < if_domain->len; i++)
+			g_hash_table_add(rule->if_domain, g_strdup(g_ptr_array_index(if_domain, i)));
+	}
+	else
+	{
+		// Applies everywhere but on the domains excluded by every merged filter
+		GHashTable *unless = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+		for(guint i = 0; i < unless_domain->len; i++)
+		{
+			gchar *domain = g_ptr_array_index(unless_domain, i);
+
+			if(rule->unless_domain == NULL || g_hash_table_contains(rule->unless_domain, domain))
+				g_hash_table_add(unless, g_strdup(domain));
+		}
+
+		if(rule->unless_domain != NULL) g_hash_table_destroy(rule->unless_domain);
+		rule->unless_domain = unless;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+abp_compiler_add_css(struct AbpCompiler *compiler, const gchar *filter, const gchar *separator)
+{
+	const gchar *selector    = separator + 2;
+	GPtrArray *if_domain     = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *unless_domain = g_ptr_array_new_with_free_func(g_free);
+	gchar *domains           = g_strndup(filter, (gsize)(separator - filter));
+	struct AbpRule rule      = {0};
+	gboolean ret;
+
+	for(size_t i = 0; i < G_N_ELEMENTS(abp_procedural); i++)
+		if(strstr(selector, abp_procedural[i]) != NULL)
+		{
+			ret = abp_unsupported(compiler, "procedural element hiding");
+			goto clean;
+		}
+
+	if(*selector == '\0')
+	{
+		ret = abp_unsupported(compiler, "empty selector");
+		goto clean;
+	}
+
+	if(!abp_parse_domains(domains, ",", if_domain, unless_domain))
+	{
+		ret = abp_unsupported(compiler, "wildcard or invalid domain");
+		goto clean;
+	}
+
+	rule.action     = ABP_CSS;
+	rule.url_filter = g_strdup(".*");
+	rule.selector   = g_strdup(selector);
+
+	ret = abp_compiler_rule(compiler, &rule, if_domain, unless_domain);
+
+clean:
+	g_free(domains);
+	g_ptr_array_free(if_domain, TRUE);
+	g_ptr_array_free(unless_domain, TRUE);
+
+	return ret;
+}
+
+static guint
+abp_resource_type(const gchar *option)
+{
+	for(size_t i = 0; i < G_N_ELEMENTS(abp_type_options); i++)
+	{
+		if(strcmp(option, abp_type_options[i].option) != 0) continue;
+
+		for(guint j = 0; j < G_N_ELEMENTS(abp_resource_types); j++)
+			if(strcmp(abp_type_options[i].type, abp_resource_types[j]) == 0) return 1u << j;
+	}
+
+	return 0;
+}
+
+static gboolean
+abp_compiler_add_network(struct AbpCompiler *compiler, const gchar *filter)
+{
+	GPtrArray *if_domain     = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *unless_domain = g_ptr_array_new_with_free_func(g_free);
+	gboolean exception       = g_str_has_prefix(filter, "@@");
+	gboolean whole_page      = FALSE;
+	guint types = 0, not_types = 0;
+	struct AbpRule rule = {0};
+	const gchar *options;
+	gchar **opts = NULL;
+	gchar *pattern;
+	gboolean ret;
+
+	if(exception) filter += 2;
+
+	options = strrchr(filter, '$');
+	pattern = options != NULL ? g_strndup(filter, (gsize)(options - filter)) : g_strdup(filter);
+
+	if(options != NULL) opts = g_strsplit(options + 1, ",", -1);
+
+	for(gchar **o = opts; o != NULL && *o != NULL; o++)
+	{
+		const gchar *opt = *o;
+		gboolean negated = opt[0] == '~';
+		guint type;
+
+		if(negated) opt++;
+
+		if(g_str_has_prefix(opt, "domain="))
+		{
+			if(!abp_parse_domains(opt + 7, "|", if_domain, unless_domain))
+			{
+				ret = abp_unsupported(compiler, "wildcard or invalid domain");
+				goto clean;
+			}
+		}
+		else if(strcmp(opt, "third-party") == 0 || strcmp(opt, "3p") == 0)
+			rule.load_types |= negated ? ABP_LOAD_FIRST_PARTY : ABP_LOAD_THIRD_PARTY;
+		else if(strcmp(opt, "first-party") == 0 || strcmp(opt, "1p") == 0)
+			rule.load_types |= negated ? ABP_LOAD_THIRD_PARTY : ABP_LOAD_FIRST_PARTY;
+		else if(strcmp(opt, "match-case") == 0)
+			rule.case_sensitive = TRUE;
+		else if(strcmp(opt, "important") == 0)
+			continue; // No priorities in WebKit, still better than dropping the filter
+		else if(exception && !negated &&
+		        (strcmp(opt, "document") == 0 || strcmp(opt, "elemhide") == 0 ||
+		         strcmp(opt, "ehide") == 0 || strcmp(opt, "generichide") == 0 ||
+		         strcmp(opt, "ghide") == 0))
+			whole_page = TRUE;
+		else if((type = abp_resource_type(opt)) != 0)
+		{
+			if(negated)
+				not_types |= type;
+			else
+				types |= type;
+		}
+		else
+		{
+			gchar *reason = g_strdup_printf("option %.*s", (int)strcspn(opt, "="), opt);
+			ret           = abp_unsupported(compiler, reason);
+			g_free(reason);
+			goto clean;
+		}
+	}
+
+	// Both first-party and third-party, so any
+	if(rule.load_types == (ABP_LOAD_FIRST_PARTY | ABP_LOAD_THIRD_PARTY)) rule.load_types = 0;
+
+	if(types != 0)
+		rule.resource_types = types & ~not_types;
+	else if(not_types != 0)
+		rule.resource_types = ABP_TYPES_ALL & ~not_types;
+
+	if(whole_page)
+	{
+		/* @@||example.org^$document: WebKit can only ignore every previous rule on the pages
+		 * of the domain, which is what adblockers do for $document, close enough for $elemhide.
+		 */
+		gchar *host;
+
+		if(!g_str_has_prefix(pattern, "||") || if_domain->len > 0 || unless_domain->len > 0)
+		{
+			ret = abp_unsupported(compiler, "page exception not on a domain");
+			goto clean;
+		}
+
+		host = g_strdup(pattern + 2);
+		g_strdelimit(host, "^|", '\0');
+
+		if(!abp_parse_domains(host, ",", if_domain, unless_domain) || if_domain->len != 1)
+		{
+			g_free(host);
+			ret = abp_unsupported(compiler, "page exception not on a domain");
+			goto clean;
+		}
+		g_free(host);
+
+		rule.url_filter     = g_strdup(".*");
+		rule.resource_types = 0;
+	}
+	else
+	{
+		rule.url_filter = abp_pattern_to_regex(pattern);
+
+		if(rule.url_filter == NULL)
+		{
+			ret = abp_unsupported(compiler, "regular expression or non-ASCII pattern");
+			goto clean;
+		}
+	}
+
+	rule.action = exception ? ABP_IGNORE : ABP_BLOCK;
+
+	ret = abp_compiler_rule(compiler, &rule, if_domain, unless_domain);
+
+clean:
+	g_strfreev(opts);
+	g_free(pattern);
+	g_ptr_array_free(if_domain, TRUE);
+	g_ptr_array_free(unless_domain, TRUE);
+
+	return ret;
+}
+
+struct AbpCompiler *
+abp_compiler_new(void)
+{
+	struct AbpCompiler *compiler = g_malloc0(sizeof(struct AbpCompiler));
+
+	compiler->unsupported = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	compiler->seen        = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	compiler->rules       = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	compiler->order       = g_ptr_array_new_with_free_func(abp_rule_free);
+
+	return compiler;
+}
+
+void
+abp_compiler_free(struct AbpCompiler *compiler)
+{
+	g_hash_table_destroy(compiler->unsupported);
+	g_hash_table_destroy(compiler->seen);
+	g_hash_table_destroy(compiler->rules);
+	g_ptr_array_free(compiler->order, TRUE);
+	g_free(compiler);
+}
+
+/* abp_compiler_add: Adds one line of an Adblock Plus filter list,
+ * returns FALSE when the filter isn't supported, which gets counted in compiler->unsupported.
+ */
+gboolean
+abp_compiler_add(struct AbpCompiler *compiler, const gchar *filter)
+{
+	gchar *line  = g_strstrip(g_strdup(filter));
+	gboolean ret = TRUE;
+	const gchar *separator;
+
+	compiler->lines++;
+
+	if(*line == '\0' || *line == '!' || *line == '[')
+		compiler->comments++;
+	else if(g_hash_table_contains(compiler->seen, line))
+		compiler->duplicates++;
+	else
+	{
+		g_hash_table_add(compiler->seen, g_strdup(line));
+
+		if(strstr(line, "#@#") != NULL)
+			ret = abp_unsupported(compiler, "element hiding exception");
+		else if(strstr(line, "#?#") != NULL || strstr(line, "#$#") != NULL ||
+		        strstr(line, "#%#") != NULL || strstr(line, "##+js(") != NULL ||
+		        strstr(line, "##^") != NULL)
+			ret = abp_unsupported(compiler, "extended element hiding");
+		else if((separator = strstr(line, "##")) != NULL)
+			ret = abp_compiler_add_css(compiler, line, separator);
+		else
+			ret = abp_compiler_add_network(compiler, line);
+	}
+
+	g_free(line);
+
+	return ret;
+}
+
+static void
+json_append_string(GString *out, const gchar *str)
+{
+	g_string_append_c(out, '"');
+
+	for(const gchar *c = str; *c != '\0'; c++)
+	{
+		if(*c == '"' || *c == '\\')
+		{
+			g_string_append_c(out, '\\');
+			g_string_append_c(out, *c);
+		}
+		else if((guchar)*c < 0x20)
+			g_string_append_printf(out, "\\u%04x", (guint)*c);
+		else
+			g_string_append_c(out, *c);
+	}
+
+	g_string_append_c(out, '"');
+}
+
+static int
+abp_strcmp(const void *a, const void *b)
+{
+	return strcmp(*(const gchar *const *)a, *(const gchar *const *)b);
+}
+
+/* abp_domains_sorted: Keys of a domain set, sorted to get a stable output
+ */
+static GPtrArray *
+abp_domains_sorted(GHashTable *set)
+{
+	guint len;
+	gpointer *keys  = g_hash_table_get_keys_as_array(set, &len);
+	GPtrArray *list = g_ptr_array_new_with_free_func(g_free);
+
+	qsort(keys, len, sizeof(gpointer), abp_strcmp);
+
+	for(guint i = 0; i < len; i++)
+		g_ptr_array_add(list, g_strdup(keys[i]));
+
+	g_free(keys);
+
+	return list;
+}
+
+static gchar *
+abp_rule_json(struct AbpRule *rule,
+              enum abp_domains mode,
+              GPtrArray *domains,
+              const gchar *selector)
+{
+	GString *out = g_string_new("{\"trigger\":{\"url-filter\":");
+
+	json_append_string(out, rule->url_filter);
+
+	if(rule->case_sensitive) g_string_append(out, ",\"url-filter-is-case-sensitive\":true");
+
+	if(rule->resource_types != 0)
+	{
+		const gchar *sep = "";
+
+		g_string_append(out, ",\"resource-type\":[");
+		for(guint i = 0; i < G_N_ELEMENTS(abp_resource_types); i++)
+		{
+			if((rule->resource_types & (1u << i)) == 0) continue;
+
+			g_string_append(out, sep);
+			json_append_string(out, abp_resource_types[i]);
+			sep = ",";
+		}
+		g_string_append_c(out, ']');
+	}
+
+	if(rule->load_types == ABP_LOAD_FIRST_PARTY)
+		g_string_append(out, ",\"load-type\":[\"first-party\"]");
+	else if(rule->load_types == ABP_LOAD_THIRD_PARTY)
+		g_string_append(out, ",\"load-type\":[\"third-party\"]");
+
+	if(mode != ABP_DOMAINS_ANY)
+	{
+		g_string_append(out, mode == ABP_DOMAINS_IF ? ",\"if-domain\":[" : ",\"unless-domain\":[");
+		for(guint i = 0; i < domains->len; i++)
+		{
+			if(i > 0) g_string_append_c(out, ',');
+			json_append_string(out, g_ptr_array_index(domains, i));
+		}
+		g_string_append_c(out, ']');
+	}
+
+	g_string_append(out, "},\"action\":{\"type\":");
+
+	switch(rule->action)
+	{
+	case ABP_BLOCK:
+		g_string_append(out, "\"block\"");
+		break;
+	case ABP_CSS:
+		g_string_append(out, "\"css-display-none\",\"selector\":");
+		json_append_string(out, selector);
+		break;
+	case ABP_IGNORE:
+		g_string_append(out, "\"ignore-previous-rules\"");
+		break;
+	}
+
+	g_string_append(out, "}}");
+
+	return g_string_free(out, FALSE);
+}
+
+/* struct AbpCssGroup: Element-hiding rules applying on the same domains, merged into one
+ */
+struct AbpCssGroup
+{
+	struct AbpRule *rule; /* First rule of the group, for its trigger */
+	enum abp_domains mode;
+	GPtrArray *domains;
+	GString *selectors;
+	guint count;
+};
+
+static void
+abp_css_group_free(gpointer data)
+{
+	struct AbpCssGroup *group = data;
+
+	g_ptr_array_free(group->domains, TRUE);
+	g_string_free(group->selectors, TRUE);
+	g_free(group);
+}
+
+static void
+abp_css_group_flush(struct AbpCssGroup *group, GPtrArray *out)
+{
+	if(group->count == 0) return;
+
+	g_ptr_array_add(
+	    out, abp_rule_json(group->rule, group->mode, group->domains, group->selectors->str));
+
+	g_string_truncate(group->selectors, 0);
+	group->count = 0;
+}
+
+static void
+abp_css_group_add(GHashTable *groups,
+                  GPtrArray *groups_order,
+                  GPtrArray *out,
+                  struct AbpRule *rule,
+                  enum abp_domains mode,
+                  GPtrArray *domains)
+{
+	GString *key = g_string_new(NULL);
+	struct AbpCssGroup *group;
+
+	g_string_append_printf(key, "%d", mode);
+	for(guint i = 0; i < domains->len; i++)
+		g_string_append_printf(key, ",%s", (gchar *)g_ptr_array_index(domains, i));
+
+	group = g_hash_table_lookup(groups, key->str);
+	if(group == NULL)
+	{
+		group            = g_malloc(sizeof(struct AbpCssGroup));
+		group->rule      = rule;
+		group->mode      = mode;
+		group->domains   = g_ptr_array_new_with_free_func(g_free);
+		group->selectors = g_string_new(NULL);
+		group->count     = 0;
+
+		for(guint i = 0; i < domains->len; i++)
+			g_ptr_array_add(group->domains, g_strdup(g_ptr_array_index(domains, i)));
+
+		g_hash_table_insert(groups, g_string_free(key, FALSE), group);
+		g_ptr_array_add(groups_order, group);
+	}
+	else
+		g_string_free(key, TRUE);
+
+	if(group->count > 0) g_string_append(group->selectors, ", ");
+	g_string_append(group->selectors, rule->selector);
+
+	if(++group->count >= ABP_SELECTOR_GROUP) abp_css_group_flush(group, out);
+}
+
+/* abp_compiler_finish: Writes the rules as WebKit content-filter JSON lists,
+ * each of at most max_rules rules.
+ *
+ * Exceptions only apply to the rules of their own list, so every list gets all of them.
+ * Returns NULL when there is too many exceptions to fit in a list,
+ * otherwise an array of GString, rules being set to the amount of distinct rules.
+ */
+GPtrArray *
+abp_compiler_finish(struct AbpCompiler *compiler, guint max_rules, guint *rules)
+{
+	GPtrArray *blocks       = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *css          = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *exceptions   = g_ptr_array_new_with_free_func(g_free);
+	GPtrArray *groups_order = g_ptr_array_new_with_free_func(abp_css_group_free);
+	GHashTable *groups      = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	GPtrArray *parts        = NULL;
+	GPtrArray *no_domains   = g_ptr_array_new();
+	guint per_part, next = 0;
+
+	for(guint i = 0; i < compiler->order->len; i++)
+	{
+		struct AbpRule *rule              = g_ptr_array_index(compiler->order, i);
+		GPtrArray *out                    = rule->action == ABP_IGNORE ? exceptions : blocks;
+		GPtrArray *variants[2]            = {NULL, NULL};
+		enum abp_domains variant_modes[2] = {ABP_DOMAINS_IF, ABP_DOMAINS_UNLESS};
+
+		if(rule->any_domain ||
+		   (rule->unless_domain != NULL && g_hash_table_size(rule->unless_domain) == 0))
+		{
+			// Applying everywhere supersedes any domain restriction
+			if(rule->action == ABP_CSS)
+				abp_css_group_add(groups, groups_order, css, rule, ABP_DOMAINS_ANY, no_domains);
+			else
+				g_ptr_array_add(out, abp_rule_json(rule, ABP_DOMAINS_ANY, no_domains, NULL));
+			continue;
+		}
+
+		if(rule->if_domain != NULL) variants[0] = abp_domains_sorted(rule->if_domain);
+		if(rule->unless_domain != NULL) variants[1] = abp_domains_sorted(rule->unless_domain);
+
+		for(int v = 0; v < 2; v++)
+		{
+			if(variants[v] == NULL) continue;
+
+			if(rule->action == ABP_CSS)
+				abp_css_group_add(groups, groups_order, css, rule, variant_modes[v], variants[v]);
+			else
+				g_ptr_array_add(out, abp_rule_json(rule, variant_modes[v], variants[v], NULL));
+
+			g_ptr_array_free(variants[v], TRUE);
+		}
+	}
+
+	for(guint i = 0; i < groups_order->len; i++)
+		abp_css_group_flush(g_ptr_array_index(groups_order, i), css);
+
+	// Blocking rules then element-hiding ones, exceptions have to come last
+	for(guint i = 0; i < css->len; i++)
+		g_ptr_array_add(blocks, g_strdup(g_ptr_array_index(css, i)));
+
+	*rules = blocks->len + exceptions->len;
+
+	if(exceptions->len >= max_rules) goto clean;
+
+	per_part = max_rules - exceptions->len;
+	parts    = g_ptr_array_new_with_free_func(abp_string_free);
+
+	do
+	{
+		GString *part    = g_string_new("[\n");
+		const gchar *sep = "";
+
+		for(guint n = 0; n < per_part && next < blocks->len; n++, next++)
+		{
+			g_string_append_printf(part, "%s%s", sep, (gchar *)g_ptr_array_index(blocks, next));
+			sep = ",\n";
+		}
+
+		for(guint n = 0; n < exceptions->len; n++)
+		{
+			g_string_append_printf(part, "%s%s", sep, (gchar *)g_ptr_array_index(exceptions, n));
+			sep = ",\n";
+		}
+
+		g_string_append(part, "\n]\n");
+		g_ptr_array_add(parts, part);
+	} while(next < blocks->len);
+
+clean:
+	g_ptr_array_free(no_domains, TRUE);
+	g_hash_table_destroy(groups);
+	g_ptr_array_free(groups_order, TRUE);
+	g_ptr_array_free(exceptions, TRUE);
+	g_ptr_array_free(css, TRUE);
+	g_ptr_array_free(blocks, TRUE);
+
+	return parts;
+}
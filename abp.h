@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef ABP_H_INCLUDED
+#define ABP_H_INCLUDED
+#include <glib.h>
+
+/* ABP_MAX_RULES: Default maximum amount of rules per WebKit content-filter list
+ * ABP_SELECTOR_GROUP: Maximum amount of element-hiding selectors merged into one rule
+ */
+#define ABP_MAX_RULES 50000
+#define ABP_SELECTOR_GROUP 1000
+
+/* struct AbpCompiler: Translates Adblock Plus filters into WebKit content-filter rules,
+ * see abp_compiler_add() and abp_compiler_finish().
+ */
+struct AbpCompiler
+{
+	guint lines;
+	guint comments;
+	guint duplicates;
+	guint merged;
+	GHashTable *unsupported; /* reason → count (as pointer) */
+
+	GHashTable *seen;  /* filters already added */
+	GHashTable *rules; /* merge key → struct AbpRule */
+	GPtrArray *order;  /* struct AbpRule, in order of first appearance */
+};
+
+gchar *abp_pattern_to_regex(const gchar *pattern);
+struct AbpCompiler *abp_compiler_new(void);
+void abp_compiler_free(struct AbpCompiler *compiler);
+gboolean abp_compiler_add(struct AbpCompiler *compiler, const gchar *filter);
+GPtrArray *abp_compiler_finish(struct AbpCompiler *compiler, guint max_rules, guint *rules);
+#endif /* ABP_H_INCLUDED */
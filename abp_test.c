@@ -0,0 +1,110 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "abp.h"
+
+#include <glib.h>
+#include <string.h> /* strstr() */
+
+static void
+abp_pattern_to_regex_test(void)
+{
+	struct
+	{
+		const gchar *expect;
+		const gchar *pattern;
+	} cases[] = {
+	    //
+	    {".*", ""},
+	    {".*", "*"},
+	    {"/ads/\\?", "/ads/?"},
+	    {"/ads/.*\\.gif", "/ads/*.gif"},
+	    {"^[^:]+:(//)?([^/]+\\.)?example\\.org([^a-zA-Z0-9_.%-].*)?$", "||example.org^"},
+	    {"^[^:]+:(//)?([^/]+\\.)?example\\.org[^a-zA-Z0-9_.%-]ad", "||example.org^ad"},
+	    {"^https://example\\.org/$", "|https://example.org/|"},
+	    {"\\?ad=\\(1\\)", "?ad=(1)"},
+	    {NULL, "/banner[0-9]+/"},
+	    {NULL, "/äd"} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		g_info("abp_pattern_to_regex(\"%s\")", cases[i].pattern);
+
+		gchar *got = abp_pattern_to_regex(cases[i].pattern);
+
+		if(g_strcmp0(got, cases[i].expect) != 0)
+		{
+			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got);
+		}
+
+		g_free(got);
+	}
+}
+
+static void
+abp_compiler_test(void)
+{
+	struct AbpCompiler *compiler = abp_compiler_new();
+	const gchar *filters[]       = {
+        "[Adblock Plus 2.0]",
+        "! comment",
+        "||ads.example^",
+        "||ads.example^",
+        "||tracker.example^$third-party,domain=a.example",
+        "||tracker.example^$third-party,domain=b.example",
+        "a.example##.banner",
+        "b.example##.banner",
+        "##.sponsored",
+        "##.promoted",
+        "example.org#@#.banner",
+        "example.org#?#div:-abp-has(.ad)",
+        "||cdn.example^$csp=script-src 'none'",
+        "@@||good.example^$document",
+    };
+	GPtrArray *parts;
+	guint rules;
+	gchar *json;
+
+	for(size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+		abp_compiler_add(compiler, filters[i]);
+
+	g_assert_cmpuint(compiler->lines, ==, 14);
+	g_assert_cmpuint(compiler->comments, ==, 2);
+	g_assert_cmpuint(compiler->duplicates, ==, 1);
+	g_assert_cmpuint(compiler->merged, ==, 2);
+	g_assert_cmpuint(g_hash_table_size(compiler->unsupported), ==, 3);
+
+	parts = abp_compiler_finish(compiler, ABP_MAX_RULES, &rules);
+	g_assert_nonnull(parts);
+	g_assert_cmpuint(parts->len, ==, 1);
+	// block, tracker with folded domains, .banner on both domains, merged generic selectors, exception
+	g_assert_cmpuint(rules, ==, 5);
+
+	json = ((GString *)g_ptr_array_index(parts, 0))->str;
+	g_assert_nonnull(strstr(json, "\"if-domain\":[\"*a.example\",\"*b.example\"]"));
+	g_assert_nonnull(strstr(json, "\"selector\":\".sponsored, .promoted\""));
+	g_assert_nonnull(strstr(json, "\"ignore-previous-rules\""));
+	g_ptr_array_free(parts, TRUE);
+
+	// Exceptions get repeated in every list
+	parts = abp_compiler_finish(compiler, 3, &rules);
+	g_assert_nonnull(parts);
+	g_assert_cmpuint(parts->len, ==, 2);
+	g_ptr_array_free(parts, TRUE);
+
+	abp_compiler_free(compiler);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/abp_pattern_to_regex/test", abp_pattern_to_regex_test);
+	g_test_add_func("/abp_compiler/test", abp_compiler_test);
+
+	return g_test_run();
+}
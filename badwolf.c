@@ -4,10 +4,21 @@
 
 #include "badwolf.h"
 
+#include "bookmarks.h"
+#include "completion.h"
 #include "config.h"
+#include "contexts.h"
 #include "downloads.h"
-#include "fmt.h"
+#include "filters.h"
+#include "find.h"
+#include "hibernate.h"
+#include "history.h"
 #include "keybindings.h"
+#include "perf.h"
+#include "session.h"
+#include "sitepolicy.h"
+#include "tablabel.h"
+#include "trace.h"
 #include "uri.h"
 #include "userscripts.h"
 
@@ -22,9 +33,23 @@
 const gchar *homepage = "https://hacktivis.me/projects/badwolf";
 const gchar *version  = VERSION;
 
-static gchar *web_extensions_directory;
-static uint64_t context_id_counter = 0;
-GtkTreeModel *bookmarks_completion_model;
+/* Locations known for completion, and the results shown by every location entry */
+static struct Completion *completion;
+static GtkListStore *completion_model;
+
+static struct History *history = NULL; /* NULL when disabled */
+static struct HistoryCursor history_cursor;
+static guint history_seed_id   = 0; /* completing from the history, see historyCb_seed() */
+
+static struct SitePolicies *site_policies;
+static struct SitePolicy site_policy_defaults; /* from BADWOLF_WEBKIT_SETTINGS */
+
+enum location_completion_column
+{
+	LOCATION_COMPLETION_URI,
+	LOCATION_COMPLETION_TITLE,
+	LOCATION_COMPLETION_COLUMNS,
+};
 
 static gboolean WebViewCb_close(WebKitWebView *webView, gpointer user_data);
 static gboolean WebViewCb_web_process_terminated(WebKitWebView *webView,
@@ -55,37 +80,84 @@ static gboolean WebViewCb_decide_policy(WebKitWebView *web_view,
                                         gpointer user_data);
 static void
 WebViewCb_load_changed(WebKitWebView *webView, WebKitLoadEvent load_event, gpointer user_data);
-static void web_contextCb_download_started(WebKitWebContext *web_context,
-                                           WebKitDownload *download,
-                                           gpointer user_data);
 static gboolean locationCb_activate(GtkEntry *location, gpointer user_data);
 static gboolean javascriptCb_toggled(GtkButton *javascript, gpointer user_data);
 static gboolean auto_load_imagesCb_toggled(GtkButton *auto_load_images, gpointer user_data);
 static void backCb_clicked(GtkButton *back, gpointer user_data);
 static void forwardCb_clicked(GtkButton *forward, gpointer user_data);
 static void printCb_clicked(GtkButton *forward, gpointer user_data);
-static gboolean SearchEntryCb_next__match(GtkSearchEntry *search, gpointer user_data);
-static gboolean SearchEntryCb_previous__match(GtkSearchEntry *search, gpointer user_data);
-static gboolean SearchEntryCb_search__changed(GtkSearchEntry *search, gpointer user_data);
-static gboolean SearchEntryCb_stop__search(GtkSearchEntry *search, gpointer user_data);
 static void new_tabCb_clicked(GtkButton *new_tab, gpointer user_data);
 static void closeCb_clicked(GtkButton *close, gpointer user_data);
 static void
 notebookCb_switch__page(GtkNotebook *notebook, GtkWidget *page, guint page_num, gpointer user_data);
-void content_managerCb_ready(GObject *store, GAsyncResult *result, gpointer user_data);
+static void notebookCb_page__reordered(GtkNotebook *notebook,
+                                       GtkWidget *child,
+                                       guint page_num,
+                                       gpointer user_data);
 
 static gboolean
 WebViewCb_close(WebKitWebView *UNUSED(webView), gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
 
-	gtk_widget_destroy(browser->box);
+	TRACE_BEGIN(__func__);
 
-	free(browser);
+	gtk_widget_destroy(browser->box);
 
+	TRACE_END(__func__);
 	return TRUE;
 }
 
+/* browser_new_tab_box: badwolf_new_tab_box() connected to the callbacks of badwolf.c
+ */
+static GtkWidget *
+browser_new_tab_box(const gchar *title, struct Client *browser)
+{
+	return badwolf_new_tab_box(
+	    title, browser, G_CALLBACK(closeCb_clicked), G_CALLBACK(tab_boxCb_button_release_event));
+}
+
+/* browser_set_completion_uri: Moves the open tab counted by the completion to uri,
+ * NULL or empty when the tab is closing or has no location yet
+ */
+static void
+browser_set_completion_uri(struct Client *browser, const gchar *uri)
+{
+	if(uri != NULL && uri[0] == '\0') uri = NULL;
+	if(g_strcmp0(browser->completion_uri, uri) == 0) return;
+
+	if(browser->completion_uri != NULL) completion_tab_closed(completion, browser->completion_uri);
+	g_free(browser->completion_uri);
+
+	browser->completion_uri = g_strdup(uri);
+	if(uri != NULL) completion_tab_opened(completion, uri);
+}
+
+/* boxCb_destroy: Frees browser once its tab is gone, however it got closed
+ */
+static void
+boxCb_destroy(GtkWidget *UNUSED(box), gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	badwolf_session_tab_closed(browser);
+	browser_set_completion_uri(browser, NULL);
+	badwolf_find_free(browser);
+
+	if(browser->webView != NULL) g_signal_handlers_disconnect_by_data(browser->webView, browser);
+	if(browser->restore_source != 0) g_source_remove(browser->restore_source);
+	if(browser->tick_id != 0)
+		gtk_widget_remove_tick_callback(browser->window->notebook, browser->tick_id);
+	g_free(browser->status_link);
+	if(browser->session_snapshot != NULL)
+		webkit_web_view_session_state_unref(browser->session_snapshot);
+
+	badwolf_hibernation_free(browser->hibernation);
+	if(browser->web_context != NULL) g_object_unref(browser->web_context);
+	g_free(browser->container);
+	free(browser);
+}
+
 static gboolean
 WebViewCb_web_process_terminated(WebKitWebView *UNUSED(webView),
                                  WebKitWebProcessTerminationReason reason,
@@ -93,107 +165,130 @@ WebViewCb_web_process_terminated(WebKitWebView *UNUSED(webView),
 {
 	struct Client *browser = (struct Client *)user_data;
 
+	TRACE_BEGIN(__func__);
+
 	switch(reason)
 	{
 	case WEBKIT_WEB_PROCESS_CRASHED:
 		fprintf(stderr, "%s", _("the web process crashed.\n"));
 		webView_tab_label_change(browser, _("Crashed"));
+		badwolf_tab_crashed(browser);
 		break;
 	case WEBKIT_WEB_PROCESS_EXCEEDED_MEMORY_LIMIT:
 		fprintf(stderr, "%s", _("the web process exceeded the memory limit.\n"));
 		webView_tab_label_change(browser, _("Out of Memory"));
+		badwolf_tab_crashed(browser);
 		break;
 	default:
 		fprintf(stderr, "%s", _("the web process terminated for an unknown reason.\n"));
 		webView_tab_label_change(browser, _("Unknown Crash"));
 	}
 
+	TRACE_END(__func__);
 	return FALSE;
 }
 
+/* browserCb_tick: Applies the changes collected by browser_schedule_update(),
+ * changes to hidden pages are kept until they get shown, see boxCb_map().
+ */
 static gboolean
-WebViewCb_notify__uri(WebKitWebView *UNUSED(webView), GParamSpec *UNUSED(pspec), gpointer user_data)
+browserCb_tick(GtkWidget *UNUSED(widget), GdkFrameClock *UNUSED(frame_clock), gpointer user_data)
 {
-	const gchar *location_uri;
 	struct Client *browser = (struct Client *)user_data;
+	const gchar *location_uri;
+	gchar *display_uri;
+	gdouble progress;
+
+	browser->tick_id = 0;
+
+	// Tab labels are shown for every page
+	if(browser->dirty & BADWOLF_DIRTY_TITLE)
+	{
+		browser->dirty &= ~(guint)BADWOLF_DIRTY_TITLE;
+		webView_tab_label_change(browser, NULL);
+	}
+
+	if(browser->webView == NULL)
+	{
+		browser->dirty = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	if(!gtk_widget_get_mapped(browser->box)) return G_SOURCE_REMOVE;
 
 	location_uri = webkit_web_view_get_uri(browser->webView);
-	printf("location_uri: <%s>\n", location_uri);
 
 	// Don't set if location_uri is NULL / empty, latter happens on WebProcess termination
-	if(location_uri == NULL || location_uri[0] == '\0')
+	if((browser->dirty & BADWOLF_DIRTY_URI) && location_uri != NULL && location_uri[0] != '\0')
 	{
-		return TRUE;
+		gtk_entry_set_text(GTK_ENTRY(browser->location), location_uri);
+
+		display_uri = webkit_uri_for_display(location_uri);
+		if(display_uri != NULL && g_strcmp0(display_uri, location_uri) != 0)
+			gtk_widget_set_tooltip_text(browser->location, display_uri);
+		else
+			gtk_widget_set_has_tooltip(browser->location, false);
+		g_free(display_uri);
 	}
 
-	gtk_entry_set_text(GTK_ENTRY(browser->location), location_uri);
+	if(browser->dirty & BADWOLF_DIRTY_PROGRESS)
+	{
+		progress = webkit_web_view_get_estimated_load_progress(browser->webView);
 
-	if(webkit_uri_for_display(location_uri) != location_uri)
-		gtk_widget_set_tooltip_text(browser->location, webkit_uri_for_display(location_uri));
-	else
-		gtk_widget_set_has_tooltip(browser->location, false);
+		if(progress >= 1) progress = 0;
 
-	return TRUE;
+		gtk_entry_set_progress_fraction(GTK_ENTRY(browser->location), progress);
+	}
+
+	if(browser->dirty & BADWOLF_DIRTY_STATUS)
+	{
+		display_uri = NULL;
+		if(browser->status_link != NULL) display_uri = webkit_uri_for_display(browser->status_link);
+
+		gtk_label_set_text(GTK_LABEL(browser->statuslabel), display_uri);
+		g_free(display_uri);
+	}
+
+	browser->dirty = 0;
+
+	return G_SOURCE_REMOVE;
 }
 
-GtkWidget *
-badwolf_new_tab_box(const gchar *title, struct Client *browser)
+/* browser_schedule_update: Marks parts of browser as needing an update,
+ * done at the next frame so bursts of WebView notifications (redirects, mouse moves, …)
+ * end up in a single update.
+ */
+static void
+browser_schedule_update(struct Client *browser, guint dirty)
 {
-	/* flawfinder: ignore. bound checks are done */
-	char context_id_str[BADWOLF_CTX_SIZ] = {0, 0, 0, 0, 0, 0, 0};
-
-	fmt_context_id(browser->context_id, context_id_str);
-
-	GtkWidget *tab_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
-	gtk_widget_set_name(tab_box, "browser__tabbox");
-
-	GtkWidget *close =
-	    gtk_button_new_from_icon_name("window-close-symbolic", GTK_ICON_SIZE_LARGE_TOOLBAR);
-	gtk_widget_set_name(close, "browser__tabbox__close");
-	GtkWidget *label = gtk_label_new(title);
-	gtk_widget_set_name(label, "browser__tabbox__label");
-	GtkWidget *label_event_box = gtk_event_box_new();
-	gtk_container_add(GTK_CONTAINER(label_event_box), label);
-	GtkWidget *context_label = gtk_label_new(context_id_str);
-	gtk_widget_set_name(context_label, "browser__tabbox__context_label");
-	GtkWidget *context_label_event_box = gtk_event_box_new();
-	gtk_container_add(GTK_CONTAINER(context_label_event_box), context_label);
-	GtkWidget *playing =
-	    gtk_image_new_from_icon_name("audio-volume-high-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
-	gtk_widget_set_name(playing, "browser__tabbox__playing");
-	GtkWidget *playing_event_box = gtk_event_box_new();
-	gtk_container_add(GTK_CONTAINER(playing_event_box), playing);
-
-#ifdef BADWOLF_TAB_BOX_WIDTH
-	gtk_widget_set_size_request(label, BADWOLF_TAB_BOX_WIDTH, -1);
-#endif
-#ifdef BADWOLF_TAB_LABEL_CHARWIDTH
-	gtk_label_set_width_chars(GTK_LABEL(label), BADWOLF_TAB_LABEL_CHARWIDTH);
-#endif
-	gtk_widget_set_hexpand(tab_box, BADWOLF_TAB_HEXPAND);
+	browser->dirty |= dirty;
 
-	gtk_label_set_ellipsize(GTK_LABEL(label), BADWOLF_TAB_LABEL_ELLIPSIZE);
-	gtk_label_set_single_line_mode(GTK_LABEL(label), TRUE);
-	gtk_label_set_single_line_mode(GTK_LABEL(context_label), TRUE);
+	if(browser->tick_id != 0) return;
 
-	gtk_box_pack_start(GTK_BOX(tab_box), context_label_event_box, TRUE, TRUE, 0);
-	gtk_box_pack_start(GTK_BOX(tab_box), playing_event_box, FALSE, FALSE, 0);
-	gtk_box_pack_start(GTK_BOX(tab_box), label_event_box, TRUE, TRUE, 0);
-	gtk_box_pack_start(GTK_BOX(tab_box), close, FALSE, FALSE, 0);
+	// The notebook stays mapped, unlike the hidden pages, and tab labels are always shown
+	browser->tick_id =
+	    gtk_widget_add_tick_callback(browser->window->notebook, browserCb_tick, browser, NULL);
+}
 
-	gtk_button_set_relief(GTK_BUTTON(close), GTK_RELIEF_NONE);
+static void
+boxCb_map(GtkWidget *UNUSED(box), gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	if(browser->dirty != 0) browser_schedule_update(browser, 0);
+}
 
-	g_signal_connect(close, "clicked", G_CALLBACK(closeCb_clicked), browser);
+static gboolean
+WebViewCb_notify__uri(WebKitWebView *UNUSED(webView), GParamSpec *UNUSED(pspec), gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
 
-	gtk_widget_set_tooltip_text(tab_box, title);
+	TRACE_BEGIN(__func__);
 
-	gtk_widget_show_all(tab_box);
-	gtk_widget_set_visible(playing, webkit_web_view_is_playing_audio(browser->webView));
-	gtk_widget_set_events(label, GDK_BUTTON_RELEASE_MASK);
-	g_signal_connect(
-	    tab_box, "button-release-event", G_CALLBACK(tab_boxCb_button_release_event), browser);
+	browser_schedule_update(browser, BADWOLF_DIRTY_URI);
 
-	return tab_box;
+	TRACE_END(__func__);
+	return TRUE;
 }
 
 static gboolean
@@ -202,17 +297,27 @@ WebViewCb_notify__title(WebKitWebView *UNUSED(webView),
                         gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
+	const char *title      = webkit_web_view_get_title(browser->webView);
+
+	TRACE_BEGIN(__func__);
 
 	// Don't set if title is NULL / empty, latter happens on WebProcess crash
-	const char *title = webkit_web_view_get_title(browser->webView);
-	printf("title: <%s>\n", title);
 	if(title == NULL || title[0] == '\0')
 	{
+		TRACE_END(__func__);
 		return TRUE;
 	}
 
-	webView_tab_label_change(browser, NULL);
+	if(webkit_web_view_get_uri(browser->webView) != NULL)
+	{
+		completion_set_title(completion, webkit_web_view_get_uri(browser->webView), title);
+		if(history != NULL)
+			history_set_title(history, webkit_web_view_get_uri(browser->webView), title);
+	}
 
+	browser_schedule_update(browser, BADWOLF_DIRTY_TITLE);
+
+	TRACE_END(__func__);
 	return TRUE;
 }
 
@@ -223,8 +328,11 @@ WebViewCb_notify__is__playing__audio(WebKitWebView *UNUSED(webView),
 {
 	struct Client *browser = (struct Client *)user_data;
 
-	webView_tab_label_change(browser, NULL);
+	TRACE_BEGIN(__func__);
+
+	browser_schedule_update(browser, BADWOLF_DIRTY_TITLE);
 
+	TRACE_END(__func__);
 	return TRUE;
 }
 
@@ -235,12 +343,25 @@ webView_tab_label_change(struct Client *browser, const gchar *title)
 
 #define title_IS_EMPTY title == NULL || title[0] == '\0'
 
-	if(title_IS_EMPTY) title = webkit_web_view_get_title(browser->webView);
-	if(title_IS_EMPTY) title = webkit_web_view_get_uri(browser->webView);
+	if(browser->webView == NULL)
+	{
+		if(title_IS_EMPTY) title = browser->hibernation->title;
+		if(title_IS_EMPTY) title = browser->hibernation->uri;
+	}
+	else
+	{
+		if(title_IS_EMPTY) title = webkit_web_view_get_title(browser->webView);
+		if(title_IS_EMPTY) title = webkit_web_view_get_uri(browser->webView);
+	}
 	if(title_IS_EMPTY) title = _("Empty Title");
 
-	gtk_notebook_set_tab_label(
-	    GTK_NOTEBOOK(notebook), browser->box, badwolf_new_tab_box(title, browser));
+	if(browser->tab_box == NULL)
+	{
+		gtk_notebook_set_tab_label(
+		    GTK_NOTEBOOK(notebook), browser->box, browser_new_tab_box(title, browser));
+	}
+	else if(!badwolf_tab_label_update(browser, title))
+		return;
 	gtk_notebook_set_menu_label_text(GTK_NOTEBOOK(notebook), browser->box, title);
 
 	// Set the window title if the title change was on the current tab
@@ -255,14 +376,12 @@ WebViewCb_notify__estimated_load_progress(WebKitWebView *UNUSED(webView),
                                           gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
-	gdouble progress;
 
-	progress = webkit_web_view_get_estimated_load_progress(browser->webView);
+	TRACE_BEGIN(__func__);
 
-	if(progress >= 1) progress = 0;
-
-	gtk_entry_set_progress_fraction(GTK_ENTRY(browser->location), progress);
+	browser_schedule_update(browser, BADWOLF_DIRTY_PROGRESS);
 
+	TRACE_END(__func__);
 	return TRUE;
 }
 
@@ -273,16 +392,25 @@ WebViewCb_mouse_target_changed(WebKitWebView *UNUSED(webView),
                                gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
+	const gchar *link_uri  = NULL;
+
+	TRACE_BEGIN(__func__);
 
 	if(webkit_hit_test_result_context_is_link(hit))
-	{
-		const gchar *link_uri = webkit_hit_test_result_get_link_uri(hit);
+		link_uri = webkit_hit_test_result_get_link_uri(hit);
 
-		gtk_label_set_text(GTK_LABEL(browser->statuslabel), webkit_uri_for_display(link_uri));
+	if(g_strcmp0(link_uri, browser->status_link) == 0)
+	{
+		TRACE_END(__func__);
+		return FALSE;
 	}
-	else
-		gtk_label_set_text(GTK_LABEL(browser->statuslabel), NULL);
 
+	g_free(browser->status_link);
+	browser->status_link = g_strdup(link_uri);
+
+	browser_schedule_update(browser, BADWOLF_DIRTY_STATUS);
+
+	TRACE_END(__func__);
 	return FALSE;
 }
 
@@ -293,35 +421,92 @@ WebViewCb_scroll_event(GtkWidget *UNUSED(widget), GdkEvent *event, gpointer data
 	gdouble delta_x, delta_y;
 	gdouble zoom;
 
+	TRACE_BEGIN(__func__);
+
 	if(((GdkEventScroll *)event)->state & GDK_CONTROL_MASK)
 	{
 		gdk_event_get_scroll_deltas(event, &delta_x, &delta_y);
 		zoom = webkit_web_view_get_zoom_level(WEBKIT_WEB_VIEW(browser->webView));
 		zoom -= delta_y * 0.1;
 		webkit_web_view_set_zoom_level(WEBKIT_WEB_VIEW(browser->webView), zoom);
+		TRACE_END(__func__);
 		return TRUE;
 	}
 
+	TRACE_END(__func__);
 	return FALSE;
 }
 
+/* browser_apply_site_policy: Applies the site policy of uri to browser before it gets loaded,
+ * fields without a policy getting back to their defaults
+ */
+static void
+browser_apply_site_policy(struct Client *browser, const gchar *uri)
+{
+	struct SitePolicy policy = site_policy_defaults;
+	WebKitSettings *settings;
+
+	if(browser->webView == NULL) return;
+
+	sitepolicy_lookup_uri(site_policies, uri, &policy);
+
+	settings = webkit_web_view_get_settings(browser->webView);
+	webkit_settings_set_enable_javascript_markup(settings, policy.javascript);
+	webkit_settings_set_auto_load_images(settings, policy.images);
+	webkit_settings_set_media_playback_requires_user_gesture(settings, !policy.autoplay);
+
+	// Left alone unless a policy is involved, as the user might have zoomed
+	if((policy.set | browser->site_policy) & SITEPOLICY_USER_AGENT)
+		webkit_settings_set_user_agent(settings, policy.user_agent);
+	if((policy.set | browser->site_policy) & SITEPOLICY_ZOOM)
+		webkit_web_view_set_zoom_level(browser->webView, policy.zoom);
+
+	browser->site_policy = policy.set;
+
+	// Shown by the toggles, without recording it as a policy
+	g_signal_handlers_block_by_func(browser->javascript, javascriptCb_toggled, browser);
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(browser->javascript), policy.javascript);
+	g_signal_handlers_unblock_by_func(browser->javascript, javascriptCb_toggled, browser);
+
+	g_signal_handlers_block_by_func(browser->auto_load_images, auto_load_imagesCb_toggled, browser);
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(browser->auto_load_images), policy.images);
+	g_signal_handlers_unblock_by_func(
+	    browser->auto_load_images, auto_load_imagesCb_toggled, browser);
+}
+
+/* badwolf_load_uri: Loads uri in browser, with its site policy already applied
+ */
+void
+badwolf_load_uri(struct Client *browser, const gchar *uri)
+{
+	browser_apply_site_policy(browser, uri);
+	webkit_web_view_load_uri(browser->webView, uri);
+}
+
 static WebKitWebView *
 WebViewCb_create(WebKitWebView *related_web_view,
-                 WebKitNavigationAction *UNUSED(navigation_action),
+                 WebKitNavigationAction *navigation_action,
                  gpointer user_data)
 {
 	struct Client *old_browser = (struct Client *)user_data;
 	struct Client *browser     = NULL;
+	WebKitWebView *web_view    = NULL;
+
+	TRACE_BEGIN(__func__);
 
 	// shouldn't be needed but better be safe
 	old_browser->webView = related_web_view;
 
 	browser = new_browser(old_browser->window, NULL, old_browser);
 
-	if(badwolf_new_tab(GTK_NOTEBOOK(old_browser->window->notebook), browser, FALSE) < 0)
-		return NULL;
-	else
-		return browser->webView;
+	browser_apply_site_policy(
+	    browser, webkit_uri_request_get_uri(webkit_navigation_action_get_request(navigation_action)));
+
+	if(badwolf_new_tab(GTK_NOTEBOOK(old_browser->window->notebook), browser, FALSE) >= 0)
+		web_view = browser->webView;
+
+	TRACE_END(__func__);
+	return web_view;
 }
 
 static gboolean
@@ -329,8 +514,11 @@ WebViewCb_permission_request(WebKitWebView *UNUSED(web_view),
                              WebKitPermissionRequest *request,
                              gpointer UNUSED(user_data))
 {
+	TRACE_BEGIN(__func__);
+
 	webkit_permission_request_deny(request);
 
+	TRACE_END(__func__);
 	return TRUE; /* Stop other handlers */
 }
 
@@ -345,6 +533,8 @@ WebViewCb_decide_policy(WebKitWebView *UNUSED(web_view),
 	WebKitNavigationPolicyDecision *n;
 	WebKitNavigationAction *navigation_action;
 
+	TRACE_BEGIN(__func__);
+
 	switch(decision_type)
 	{
 	case WEBKIT_POLICY_DECISION_TYPE_NAVIGATION_ACTION:
@@ -359,12 +549,13 @@ WebViewCb_decide_policy(WebKitWebView *UNUSED(web_view),
 			struct Client *browser  = new_browser(old_browser->window, target_url, old_browser);
 
 			badwolf_new_tab(GTK_NOTEBOOK(browser->window->notebook), browser, FALSE);
-			webkit_web_view_load_uri(browser->webView, target_url);
+			badwolf_load_uri(browser, target_url);
 			webkit_policy_decision_ignore(decision);
 		}
 		else
 		{
 			/* Use whatever default there is. */
+			TRACE_END(__func__);
 			return FALSE;
 		}
 		break;
@@ -377,21 +568,57 @@ WebViewCb_decide_policy(WebKitWebView *UNUSED(web_view),
 		break;
 	default:
 		/* Use whatever default there is. */
+		TRACE_END(__func__);
 		return FALSE;
 	}
 
+	TRACE_END(__func__);
 	return TRUE;
 }
 
 static void
 WebViewCb_load_changed(WebKitWebView *UNUSED(webView),
-                       WebKitLoadEvent UNUSED(load_event),
+                       WebKitLoadEvent load_event,
                        gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
 
+	TRACE_BEGIN(__func__);
+
 	gtk_widget_set_sensitive(browser->back, webkit_web_view_can_go_back(browser->webView));
 	gtk_widget_set_sensitive(browser->forward, webkit_web_view_can_go_forward(browser->webView));
+
+	badwolf_perf_load_changed(browser, load_event);
+
+	/* Main frame only, unlike decide-policy which also gets subframe navigations,
+	 * and again once redirected as it could be to another host
+	 */
+	if(load_event == WEBKIT_LOAD_STARTED || load_event == WEBKIT_LOAD_REDIRECTED)
+		browser_apply_site_policy(browser, webkit_web_view_get_uri(browser->webView));
+
+	if(load_event == WEBKIT_LOAD_COMMITTED)
+	{
+		const gchar *uri   = webkit_web_view_get_uri(browser->webView);
+		const gchar *title = webkit_web_view_get_title(browser->webView);
+		gint64 now         = g_get_real_time() / G_USEC_PER_SEC;
+
+		completion_visit(completion, uri, title, now);
+		if(history != NULL) history_visit(history, uri, title, now);
+		browser_set_completion_uri(browser, uri);
+		badwolf_find_reset(browser);
+	}
+
+	if(load_event == WEBKIT_LOAD_FINISHED)
+	{
+		badwolf_tab_snapshot(browser);
+		badwolf_session_tab_navigated(browser);
+	}
+
+	// Lazy tabs get materialized one after the other, as loading slots are available
+	if(load_event == WEBKIT_LOAD_STARTED || load_event == WEBKIT_LOAD_FINISHED)
+		badwolf_lazy_schedule(browser->window);
+
+	TRACE_END(__func__);
 }
 
 static char *
@@ -439,6 +666,8 @@ WebViewCb_load_failed_with_tls_errors(WebKitWebView *UNUSED(web_view),
 	gchar *error_details   = detail_tls_certificate_flags(errors);
 	gint dialog_response;
 
+	TRACE_BEGIN(__func__);
+
 #ifndef USE_LIBSOUP2
 	GUri *failing_uri = g_uri_parse(failing_text, G_URI_FLAGS_NONE, NULL);
 #else
@@ -491,53 +720,165 @@ WebViewCb_load_failed_with_tls_errors(WebKitWebView *UNUSED(web_view),
 	g_free(error_details);
 	gtk_widget_destroy(dialog);
 
+	TRACE_END(__func__);
 	return FALSE; /* propagate the event further */
 }
 
+static gboolean
+locationCb_activate(GtkEntry *location, gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+	gchar *uri             = badwolf_ensure_uri_scheme(gtk_entry_get_text(location), TRUE);
+
+	badwolf_load_uri(browser, uri);
+	g_free(uri);
+
+	return TRUE;
+}
+
+static gboolean
+completion_model_contains(const gchar *uri)
+{
+	GtkTreeModel *model = GTK_TREE_MODEL(completion_model);
+	GtkTreeIter iter;
+	gboolean found = FALSE;
+
+	if(!gtk_tree_model_get_iter_first(model, &iter)) return FALSE;
+
+	do
+	{
+		gchar *row_uri;
+
+		gtk_tree_model_get(model, &iter, LOCATION_COMPLETION_URI, &row_uri, -1);
+		found = g_strcmp0(row_uri, uri) == 0;
+		g_free(row_uri);
+	} while(!found && gtk_tree_model_iter_next(model, &iter));
+
+	return found;
+}
+
+/* locationCb_changed: Refills the completion results with the ones for what got typed
+ */
 static void
-web_contextCb_download_started(WebKitWebContext *UNUSED(web_context),
-                               WebKitDownload *webkit_download,
-                               gpointer user_data)
+locationCb_changed(GtkEditable *location, gpointer UNUSED(user_data))
 {
-	struct Client *browser    = (struct Client *)user_data;
-	struct Download *download = malloc(sizeof(struct Download));
+	const gchar *text = gtk_entry_get_text(GTK_ENTRY(location));
+	GPtrArray *results;
+
+	// Page loads also change the text
+	if(!gtk_widget_has_focus(GTK_WIDGET(location))) return;
 
-	assert(webkit_download);
+	// Moving through the results puts them in the entry, which shouldn't replace them
+	if(completion_model_contains(text)) return;
 
-	if(download != NULL)
+	TRACE_BEGIN(__func__);
+
+	gtk_list_store_clear(completion_model);
+
+	results = completion_query(completion, text, BADWOLF_COMPLETION_RESULTS);
+	for(guint i = 0; i < results->len; i++)
 	{
-		download->window = browser->window;
-
-		download_new_entry(webkit_download, download);
-
-		g_signal_connect(
-		    G_OBJECT(webkit_download), "received-data", G_CALLBACK(downloadCb_received_data), download);
-		g_signal_connect(G_OBJECT(webkit_download),
-		                 "created-destination",
-		                 G_CALLBACK(downloadCb_created_destination),
-		                 download);
-		g_signal_connect(G_OBJECT(webkit_download), "failed", G_CALLBACK(downloadCb_failed), download);
-		g_signal_connect(
-		    G_OBJECT(webkit_download), "finished", G_CALLBACK(downloadCb_finished), download);
+		struct CompletionEntry *entry = g_ptr_array_index(results, i);
+
+		gtk_list_store_insert_with_values(completion_model,
+		                                  NULL,
+		                                  -1,
+		                                  LOCATION_COMPLETION_URI,
+		                                  entry->uri,
+		                                  LOCATION_COMPLETION_TITLE,
+		                                  entry->title,
+		                                  -1);
 	}
+	g_ptr_array_free(results, TRUE);
 
-	g_signal_connect(G_OBJECT(webkit_download),
-	                 "decide-destination",
-	                 G_CALLBACK(downloadCb_decide_destination),
-	                 user_data);
+	TRACE_END(__func__);
 }
 
+/* location_completionCb_match: Results are already matched by completion_query()
+ */
 static gboolean
-locationCb_activate(GtkEntry *location, gpointer user_data)
+location_completionCb_match(GtkEntryCompletion *UNUSED(location_completion),
+                            const gchar *UNUSED(key),
+                            GtkTreeIter *UNUSED(iter),
+                            gpointer UNUSED(user_data))
+{
+	return TRUE;
+}
+
+static gboolean
+location_completionCb_match_selected(GtkEntryCompletion *UNUSED(location_completion),
+                                     GtkTreeModel *model,
+                                     GtkTreeIter *iter,
+                                     gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
+	gchar *uri;
+
+	gtk_tree_model_get(model, iter, LOCATION_COMPLETION_URI, &uri, -1);
+	gtk_entry_set_text(GTK_ENTRY(browser->location), uri);
+	g_free(uri);
 
-	webkit_web_view_load_uri(browser->webView,
-	                         badwolf_ensure_uri_scheme(gtk_entry_get_text(location), TRUE));
+	gtk_widget_activate(browser->location);
 
 	return TRUE;
 }
 
+/* location_completion_new: Completion of browser location entry, showing completion_model
+ */
+static GtkEntryCompletion *
+location_completion_new(struct Client *browser)
+{
+	GtkEntryCompletion *location_completion = gtk_entry_completion_new();
+	GtkCellRenderer *title_cell             = gtk_cell_renderer_text_new();
+
+	gtk_entry_completion_set_model(location_completion, GTK_TREE_MODEL(completion_model));
+	gtk_entry_completion_set_text_column(location_completion, LOCATION_COMPLETION_URI);
+	gtk_entry_completion_set_match_func(
+	    location_completion, location_completionCb_match, NULL, NULL);
+	gtk_entry_completion_set_inline_selection(location_completion,
+	                                          BADWOLF_LOCATION_INLINE_SELECTION);
+
+	g_object_set(title_cell, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
+	gtk_cell_layout_pack_start(GTK_CELL_LAYOUT(location_completion), title_cell, TRUE);
+	gtk_cell_layout_add_attribute(
+	    GTK_CELL_LAYOUT(location_completion), title_cell, "text", LOCATION_COMPLETION_TITLE);
+
+	g_signal_connect(location_completion,
+	                 "match-selected",
+	                 G_CALLBACK(location_completionCb_match_selected),
+	                 browser);
+
+	return location_completion;
+}
+
+/* browser_remember_site_policy: Records a toggle in the policy of the host of the current page,
+ * applied from its next load on
+ */
+static void
+browser_remember_site_policy(struct Client *browser, enum sitepolicy_field field, gboolean value)
+{
+	const gchar *uri  = webkit_web_view_get_uri(browser->webView);
+	GUri *guri        = uri != NULL ? g_uri_parse(uri, G_URI_FLAGS_NONE, NULL) : NULL;
+	const gchar *host = guri != NULL ? g_uri_get_host(guri) : NULL;
+	GError *err       = NULL;
+
+	if(host != NULL && host[0] != '\0')
+	{
+		sitepolicy_set_boolean(site_policies, host, field, value);
+		browser->site_policy |= field;
+
+		if(!sitepolicy_save(site_policies, &err))
+		{
+			fprintf(stderr,
+			        _("badwolf: Warning: Failed saving the site policies: %s\n"),
+			        err->message);
+			g_error_free(err);
+		}
+	}
+
+	if(guri != NULL) g_uri_unref(guri);
+}
+
 static gboolean
 javascriptCb_toggled(GtkButton *javascript, gpointer user_data)
 {
@@ -550,6 +891,9 @@ javascriptCb_toggled(GtkButton *javascript, gpointer user_data)
 
 	webkit_web_view_set_settings(browser->webView, settings);
 
+	browser_remember_site_policy(
+	    browser, SITEPOLICY_JAVASCRIPT, gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(javascript)));
+
 	return TRUE;
 }
 
@@ -565,6 +909,10 @@ auto_load_imagesCb_toggled(GtkButton *auto_load_images, gpointer user_data)
 
 	webkit_web_view_set_settings(browser->webView, settings);
 
+	browser_remember_site_policy(browser,
+	                             SITEPOLICY_IMAGES,
+	                             gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(auto_load_images)));
+
 	return TRUE;
 }
 
@@ -595,71 +943,125 @@ printCb_clicked(GtkButton *UNUSED(print), gpointer user_data)
 }
 
 static gboolean
-SearchEntryCb_next__match(GtkSearchEntry *UNUSED(search), gpointer user_data)
+widgetCb_drop_button3_event(GtkWidget *UNUSED(widget), GdkEvent *event, gpointer UNUSED(user_data))
 {
-	struct Client *browser               = (struct Client *)user_data;
-	WebKitFindController *findController = webkit_web_view_get_find_controller(browser->webView);
-
-	webkit_find_controller_search_next(findController);
-
-	return TRUE;
+	// Button3 being right-click on right-handed mode, left-click on left-handed mode
+	return ((GdkEventButton *)event)->button == 3;
 }
 
-static gboolean
-SearchEntryCb_previous__match(GtkSearchEntry *UNUSED(search), gpointer user_data)
+/* badwolf_new_web_view: Creates browser->webView in browser->web_context
+ * and packs it between the toolbar and the statusbar of browser->box.
+ *
+ * related_view is needed for views created via WebViewCb_create, NULL otherwise.
+ */
+void
+badwolf_new_web_view(struct Client *browser, WebKitWebView *related_view, WebKitSettings *settings)
 {
-	struct Client *browser               = (struct Client *)user_data;
-	WebKitFindController *findController = webkit_web_view_get_find_controller(browser->webView);
+	browser->webView = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
+	                                                "web-context",
+	                                                browser->web_context,
+	                                                "related-view",
+	                                                related_view,
+	                                                "settings",
+	                                                settings,
+	                                                "user-content-manager",
+	                                                browser->window->content_manager,
+	                                                NULL));
 
-	webkit_find_controller_search_previous(findController);
+	gtk_widget_set_name(GTK_WIDGET(browser->webView), "browser__webView");
 
-	return TRUE;
-}
+	gtk_box_pack_start(
+	    GTK_BOX(browser->box), GTK_WIDGET(browser->webView), TRUE, TRUE, BADWOLF_BOX_PADDING);
+	gtk_box_reorder_child(GTK_BOX(browser->box), GTK_WIDGET(browser->webView), 1);
 
-static gboolean
-SearchEntryCb_search__changed(GtkSearchEntry *search, gpointer user_data)
-{
-	struct Client *browser               = (struct Client *)user_data;
-	WebKitFindController *findController = webkit_web_view_get_find_controller(browser->webView);
-	const gchar *search_text             = gtk_entry_get_text(GTK_ENTRY(search));
+	/* signals for WebView widget */
+	g_signal_connect(browser->webView,
+	                 "web-process-terminated",
+	                 G_CALLBACK(WebViewCb_web_process_terminated),
+	                 browser);
+	g_signal_connect(browser->webView, "notify::uri", G_CALLBACK(WebViewCb_notify__uri), browser);
+	g_signal_connect(browser->webView, "notify::title", G_CALLBACK(WebViewCb_notify__title), browser);
+	g_signal_connect(browser->webView,
+	                 "notify::is-playing-audio",
+	                 G_CALLBACK(WebViewCb_notify__is__playing__audio),
+	                 browser);
+	g_signal_connect(browser->webView,
+	                 "mouse-target-changed",
+	                 G_CALLBACK(WebViewCb_mouse_target_changed),
+	                 browser);
+	g_signal_connect(browser->webView,
+	                 "notify::estimated-load-progress",
+	                 G_CALLBACK(WebViewCb_notify__estimated_load_progress),
+	                 browser);
+	g_signal_connect(browser->webView, "create", G_CALLBACK(WebViewCb_create), browser);
+	g_signal_connect(browser->webView, "close", G_CALLBACK(WebViewCb_close), browser);
 
-	webkit_find_controller_search(findController, search_text, 0, 0);
+	g_signal_connect(
+	    browser->webView, "key-press-event", G_CALLBACK(WebViewCb_key_press_event), browser);
+	g_signal_connect(browser->webView, "scroll-event", G_CALLBACK(WebViewCb_scroll_event), browser);
+	g_signal_connect(
+	    browser->webView, "permission-request", G_CALLBACK(WebViewCb_permission_request), NULL);
+	g_signal_connect(browser->webView, "decide-policy", G_CALLBACK(WebViewCb_decide_policy), browser);
+	g_signal_connect(browser->webView,
+	                 "load-failed-with-tls-errors",
+	                 G_CALLBACK(WebViewCb_load_failed_with_tls_errors),
+	                 browser);
+	g_signal_connect(browser->webView, "load-changed", G_CALLBACK(WebViewCb_load_changed), browser);
 
-	return TRUE;
+	badwolf_find_web_view(browser);
 }
 
-static gboolean
-SearchEntryCb_stop__search(GtkSearchEntry *UNUSED(search), gpointer user_data)
+/* browser_new: Common code of new_browser and new_lazy_browser,
+ * when lazy is TRUE no WebView (nor WebKitWebContext) is created.
+ */
+static struct Client *
+browser_new(struct Window *window,
+            const gchar *target_url,
+            struct Client *old_browser,
+            const gchar *container,
+            gboolean lazy)
 {
-	struct Client *browser               = (struct Client *)user_data;
-	WebKitFindController *findController = webkit_web_view_get_find_controller(browser->webView);
+	struct Client *browser = malloc(sizeof(struct Client));
+	gchar *uri;
 
-	webkit_find_controller_search_finish(findController);
+	if(browser == NULL) return NULL;
 
-	return TRUE;
-}
+	uri = badwolf_ensure_uri_scheme(target_url, (old_browser == NULL));
 
-static gboolean
-widgetCb_drop_button3_event(GtkWidget *UNUSED(widget), GdkEvent *event, gpointer UNUSED(user_data))
-{
-	// Button3 being right-click on right-handed mode, left-click on left-handed mode
-	return ((GdkEventButton *)event)->button == 3;
-}
+	browser->window      = window;
+	browser->container   = NULL;
+	browser->web_context = NULL;
+	browser->hibernation = NULL;
+	browser->last_active = g_get_monotonic_time();
 
-struct Client *
-new_browser(struct Window *window, const gchar *target_url, struct Client *old_browser)
-{
-	struct Client *browser = malloc(sizeof(struct Client));
-	target_url             = badwolf_ensure_uri_scheme(target_url, (old_browser == NULL));
-	char *badwolf_l10n     = NULL;
+	browser->session_snapshot = NULL;
+	browser->crash_count      = 0;
+	browser->restore_count    = 0;
+	browser->restore_source   = 0;
+	browser->last_crash       = 0;
+	browser->session_id       = 0;
+	browser->completion_uri   = NULL;
 
-	WebKitWebContext *web_context = NULL;
+	browser->tab_box     = NULL;
+	browser->tab_label   = NULL;
+	browser->tab_playing = NULL;
 
-	if(browser == NULL) return NULL;
+	browser->dirty       = 0;
+	browser->tick_id     = 0;
+	browser->status_link = NULL;
+
+	browser->load_started    = 0;
+	browser->load_redirected = 0;
+	browser->load_committed  = 0;
 
-	browser->window     = window;
-	browser->context_id = old_browser == NULL ? context_id_counter++ : old_browser->context_id;
-	browser->box        = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+	browser->site_policy = 0;
+
+	browser->search_timeout = 0;
+	browser->search_id      = 0;
+	browser->search_count   = 0;
+	browser->search_current = 0;
+
+	browser->box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
 	gtk_widget_set_name(browser->box, "browser__box");
 
 	browser->toolbar = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
@@ -698,31 +1100,26 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 	browser->statuslabel = gtk_label_new(NULL);
 	gtk_widget_set_name(browser->statuslabel, "browser__statuslabel");
 
-	if(old_browser == NULL)
+	if(old_browser != NULL)
 	{
-		WebKitWebsiteDataManager *website_data_manager = webkit_website_data_manager_new_ephemeral();
-		webkit_website_data_manager_set_itp_enabled(website_data_manager, TRUE);
-
-		web_context = webkit_web_context_new_with_website_data_manager(website_data_manager);
-		g_object_unref(website_data_manager);
-		webkit_web_context_set_sandbox_enabled(web_context, TRUE);
-		webkit_web_context_set_web_extensions_directory(web_context, web_extensions_directory);
-
-		g_signal_connect(G_OBJECT(web_context),
-		                 "download-started",
-		                 G_CALLBACK(web_contextCb_download_started),
-		                 browser);
-
-		/* flawfinder: ignore. Consider that g_strsplit is safe enough */
-		badwolf_l10n = getenv("BADWOLF_L10N");
+		browser->context_id  = old_browser->context_id;
+		browser->container   = g_strdup(old_browser->container);
+		browser->web_context = g_object_ref(old_browser->web_context);
+	}
+	else
+	{
+		if(container != NULL)
+			browser->web_context = badwolf_web_context_get(window, container, &browser->context_id);
 
-		if(badwolf_l10n != NULL)
+		if(browser->web_context != NULL)
 		{
-			gchar **languages = g_strsplit(badwolf_l10n, ":", -1);
-			webkit_web_context_set_spell_checking_languages(web_context, (const gchar *const *)languages);
-			g_strfreev(languages);
-
-			webkit_web_context_set_spell_checking_enabled(web_context, TRUE);
+			browser->container = g_strdup(container);
+		}
+		else
+		{
+			// Lazy tabs get their own context once materialized, see badwolf_tab_wake()
+			browser->context_id = badwolf_context_id_new();
+			if(!lazy) browser->web_context = badwolf_web_context_new(window);
 		}
 	}
 
@@ -733,24 +1130,6 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(browser->auto_load_images),
 	                             webkit_settings_get_auto_load_images(settings));
 
-	browser->webView = WEBKIT_WEB_VIEW(g_object_new(WEBKIT_TYPE_WEB_VIEW,
-	                                                "web-context",
-	                                                web_context,
-	                                                "related-view",
-	                                                old_browser == NULL ? NULL : old_browser->webView,
-	                                                "settings",
-	                                                settings,
-	                                                "user-content-manager",
-	                                                window->content_manager,
-	                                                NULL));
-
-	gtk_widget_set_name(GTK_WIDGET(browser->webView), "browser__webView");
-	if(old_browser == NULL)
-	{
-		g_object_unref(web_context);
-	}
-	g_object_unref(settings);
-
 	gtk_box_pack_start(
 	    GTK_BOX(browser->toolbar), GTK_WIDGET(browser->back), FALSE, FALSE, BADWOLF_TOOLBAR_PADDING);
 	gtk_box_pack_start(GTK_BOX(browser->toolbar),
@@ -785,8 +1164,11 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 
 	gtk_box_pack_start(
 	    GTK_BOX(browser->box), GTK_WIDGET(browser->toolbar), FALSE, FALSE, BADWOLF_BOX_PADDING);
-	gtk_box_pack_start(
-	    GTK_BOX(browser->box), GTK_WIDGET(browser->webView), TRUE, TRUE, BADWOLF_BOX_PADDING);
+	if(lazy)
+		badwolf_tab_hibernate_lazy(browser, uri);
+	else
+		badwolf_new_web_view(browser, old_browser == NULL ? NULL : old_browser->webView, settings);
+	g_object_unref(settings);
 
 	gtk_box_pack_start(
 	    GTK_BOX(browser->box), GTK_WIDGET(browser->statusbar), FALSE, FALSE, BADWOLF_BOX_PADDING);
@@ -796,6 +1178,7 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 	                   FALSE,
 	                   FALSE,
 	                   BADWOLF_STATUSBAR_PADDING);
+	badwolf_find_attach(browser);
 	gtk_box_pack_start(GTK_BOX(browser->statusbar),
 	                   GTK_WIDGET(browser->statuslabel),
 	                   FALSE,
@@ -807,9 +1190,13 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 	gtk_label_set_single_line_mode(GTK_LABEL(browser->statuslabel), TRUE);
 	gtk_label_set_ellipsize(GTK_LABEL(browser->statuslabel), BADWOLF_STATUSLABEL_ELLIPSIZE);
 
-	gtk_entry_set_text(GTK_ENTRY(browser->location), target_url);
+	gtk_entry_set_text(GTK_ENTRY(browser->location), uri);
 	gtk_entry_set_input_purpose(GTK_ENTRY(browser->location), GTK_INPUT_PURPOSE_URL);
 
+	GtkEntryCompletion *location_completion = location_completion_new(browser);
+	gtk_entry_set_completion(GTK_ENTRY(browser->location), location_completion);
+	g_object_unref(location_completion);
+
 	gtk_entry_set_placeholder_text(GTK_ENTRY(browser->search), _("search in current page"));
 
 	/* signals for back/forward buttons */
@@ -848,6 +1235,7 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 
 	/* signals for location entry widget */
 	g_signal_connect(browser->location, "activate", G_CALLBACK(locationCb_activate), browser);
+	g_signal_connect(browser->location, "changed", G_CALLBACK(locationCb_changed), NULL);
 
 	/* signals for print button */
 	g_signal_connect(print, "clicked", G_CALLBACK(printCb_clicked), browser);
@@ -855,56 +1243,43 @@ new_browser(struct Window *window, const gchar *target_url, struct Client *old_b
 	g_signal_connect(print, "button-press-event", G_CALLBACK(widgetCb_drop_button3_event), NULL);
 	g_signal_connect(print, "button-release-event", G_CALLBACK(widgetCb_drop_button3_event), NULL);
 
-	/* signals for WebView widget */
-	g_signal_connect(browser->webView,
-	                 "web-process-terminated",
-	                 G_CALLBACK(WebViewCb_web_process_terminated),
-	                 browser);
-	g_signal_connect(browser->webView, "notify::uri", G_CALLBACK(WebViewCb_notify__uri), browser);
-	g_signal_connect(browser->webView, "notify::title", G_CALLBACK(WebViewCb_notify__title), browser);
-	g_signal_connect(browser->webView,
-	                 "notify::is-playing-audio",
-	                 G_CALLBACK(WebViewCb_notify__is__playing__audio),
-	                 browser);
-	g_signal_connect(browser->webView,
-	                 "mouse-target-changed",
-	                 G_CALLBACK(WebViewCb_mouse_target_changed),
-	                 browser);
-	g_signal_connect(browser->webView,
-	                 "notify::estimated-load-progress",
-	                 G_CALLBACK(WebViewCb_notify__estimated_load_progress),
-	                 browser);
-	g_signal_connect(browser->webView, "create", G_CALLBACK(WebViewCb_create), browser);
-	g_signal_connect(browser->webView, "close", G_CALLBACK(WebViewCb_close), browser);
-
-	g_signal_connect(
-	    browser->webView, "key-press-event", G_CALLBACK(WebViewCb_key_press_event), browser);
-	g_signal_connect(browser->webView, "scroll-event", G_CALLBACK(WebViewCb_scroll_event), browser);
-	g_signal_connect(
-	    browser->webView, "permission-request", G_CALLBACK(WebViewCb_permission_request), NULL);
-	g_signal_connect(browser->webView, "decide-policy", G_CALLBACK(WebViewCb_decide_policy), browser);
-	g_signal_connect(browser->webView,
-	                 "load-failed-with-tls-errors",
-	                 G_CALLBACK(WebViewCb_load_failed_with_tls_errors),
-	                 browser);
-	g_signal_connect(browser->webView, "load-changed", G_CALLBACK(WebViewCb_load_changed), browser);
-
-	/* signals for search widget */
-	g_signal_connect(browser->search, "next-match", G_CALLBACK(SearchEntryCb_next__match), browser);
-	g_signal_connect(
-	    browser->search, "previous-match", G_CALLBACK(SearchEntryCb_previous__match), browser);
-	g_signal_connect(
-	    browser->search, "search-changed", G_CALLBACK(SearchEntryCb_search__changed), browser);
-	g_signal_connect(browser->search, "stop-search", G_CALLBACK(SearchEntryCb_stop__search), browser);
-
 	/* signals for box container */
 	g_signal_connect(browser->box, "key-press-event", G_CALLBACK(boxCb_key_press_event), browser);
+	g_signal_connect(browser->box, "destroy", G_CALLBACK(boxCb_destroy), browser);
+	g_signal_connect(browser->box, "map", G_CALLBACK(boxCb_map), browser);
+	g_object_set_data(G_OBJECT(browser->box), "badwolf-client", browser);
 
-	if(old_browser == NULL) webkit_web_view_load_uri(browser->webView, target_url);
+	if(old_browser == NULL && !lazy) badwolf_load_uri(browser, uri);
+	g_free(uri);
 
 	return browser;
 }
 
+struct Client *
+new_browser(struct Window *window, const gchar *target_url, struct Client *old_browser)
+{
+	return browser_new(window, target_url, old_browser, badwolf_default_container(), FALSE);
+}
+
+/* new_container_browser: Same as new_browser(window, target_url, NULL) but with the tab
+ * sharing the WebKitWebContext of the container named container, NULL for a new context.
+ */
+struct Client *
+new_container_browser(struct Window *window, const gchar *target_url, const gchar *container)
+{
+	return browser_new(window, target_url, NULL, container, FALSE);
+}
+
+/* new_lazy_browser: Same as new_browser(window, target_url, NULL) but the WebView,
+ * its WebKitWebContext and the load of target_url are deferred until the tab is selected
+ * or gets materialized in the background, see badwolf_lazy_schedule().
+ */
+struct Client *
+new_lazy_browser(struct Window *window, const gchar *target_url)
+{
+	return browser_new(window, target_url, NULL, badwolf_default_container(), TRUE);
+}
+
 /* badwolf_new_tab: Inserts struct Client *browser in GtkNotebook *notebook 
  * and optionally switches selected tab to it.
  *
@@ -926,9 +1301,14 @@ badwolf_new_tab(GtkNotebook *notebook, struct Client *browser, bool auto_switch)
 	if(gtk_notebook_insert_page(notebook, browser->box, NULL, (current_page + 1)) == -1) return -1;
 
 	gtk_notebook_set_tab_reorderable(notebook, browser->box, TRUE);
-	gtk_notebook_set_tab_label(notebook, browser->box, badwolf_new_tab_box(title, browser));
+	gtk_notebook_set_tab_label(notebook, browser->box, browser_new_tab_box(title, browser));
 	gtk_notebook_set_menu_label_text(GTK_NOTEBOOK(notebook), browser->box, title);
 
+	if(browser->hibernation != NULL) webView_tab_label_change(browser, NULL);
+
+	badwolf_session_tab_opened(browser);
+	browser_set_completion_uri(browser, gtk_entry_get_text(GTK_ENTRY(browser->location)));
+
 	gtk_widget_queue_draw(GTK_WIDGET(notebook));
 
 	if(auto_switch)
@@ -939,6 +1319,17 @@ badwolf_new_tab(GtkNotebook *notebook, struct Client *browser, bool auto_switch)
 	return 0;
 }
 
+/* badwolf_close_tab: Closes the tab of browser, asking the page first when it isn't hibernated
+ */
+void
+badwolf_close_tab(struct Client *browser)
+{
+	if(browser->webView != NULL)
+		webkit_web_view_try_close(browser->webView);
+	else
+		WebViewCb_close(NULL, browser);
+}
+
 static void
 new_tabCb_clicked(GtkButton *UNUSED(new_tab), gpointer user_data)
 {
@@ -953,7 +1344,7 @@ closeCb_clicked(GtkButton *UNUSED(close), gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
 
-	webkit_web_view_try_close(browser->webView);
+	badwolf_close_tab(browser);
 }
 
 static void
@@ -962,95 +1353,110 @@ notebookCb_switch__page(GtkNotebook *notebook,
                         guint UNUSED(page_num),
                         gpointer user_data)
 {
-	struct Window *window = (struct Window *)user_data;
-	GtkWidget *label      = gtk_notebook_get_tab_label(notebook, page);
+	struct Window *window  = (struct Window *)user_data;
+	struct Client *browser = badwolf_page_get_client(page);
+	GtkWidget *label;
+
+	if(browser != NULL)
+	{
+		browser->last_active = g_get_monotonic_time();
+		badwolf_tab_wake(browser);
+		badwolf_session_tab_selected(browser);
+	}
+
+	label = gtk_notebook_get_tab_label(notebook, page);
 
 	// TODO: Maybe find a better way to store the title
 	gtk_window_set_title(GTK_WINDOW(window->main_window), gtk_widget_get_tooltip_text(label));
 }
 
-void
-content_managerCb_ready(GObject *UNUSED(store), GAsyncResult *result, gpointer user_data)
+static void
+notebookCb_page__reordered(GtkNotebook *UNUSED(notebook),
+                           GtkWidget *child,
+                           guint UNUSED(page_num),
+                           gpointer UNUSED(user_data))
 {
-	struct Window *window = (struct Window *)user_data;
-	GError *err           = NULL;
+	struct Client *browser = badwolf_page_get_client(child);
 
-	WebKitUserContentFilter *filter =
-	    webkit_user_content_filter_store_load_finish(window->content_store, result, &err);
+	if(browser != NULL) badwolf_session_tab_moved(browser);
+}
 
-	if(filter == NULL)
-	{
-		if(err == NULL)
-		{
-			fprintf(stderr, _("badwolf: failed to load content-filter, err: [%d] %s\n"), -1, "unknown");
-		}
-		else
-		{
-			fprintf(stderr,
-			        _("badwolf: failed to load content-filter, err: [%d] %s\n"),
-			        err->code,
-			        err->message);
-		}
-	}
-	else
-	{
-		fprintf(stderr, _("badwolf: content-filter loaded, adding to content-manager…\n"));
-		webkit_user_content_manager_add_filter(window->content_manager, filter);
-	}
+static void
+historyCb_complete(const struct HistoryEntry *entry, gpointer UNUSED(user_data))
+{
+	completion_add(completion, entry->uri, entry->title, entry->visits, entry->frecency);
+}
+
+/* historyCb_seed: Gives the next entries of the history to the completion,
+ * the whole history being too much to go through while starting
+ */
+static gboolean
+historyCb_seed(gpointer UNUSED(user_data))
+{
+	if(history_seed(history,
+	                &history_cursor,
+	                BADWOLF_COMPLETION_HISTORY_STEP,
+	                historyCb_complete,
+	                NULL))
+		return G_SOURCE_CONTINUE;
+
+	history_seed_id = 0;
+	return G_SOURCE_REMOVE;
 }
 
 static void
-storeCb_finish(WebKitUserContentFilterStore *UNUSED(store),
-               GAsyncResult *result,
-               gpointer user_data)
+bookmarksCb_complete(const gchar *uri, const gchar *title, gpointer UNUSED(user_data))
 {
-	struct Window *window = (struct Window *)user_data;
-	GError *err           = NULL;
+	completion_bookmark(completion, uri, title);
+}
 
-	WebKitUserContentFilter *filter =
-	    webkit_user_content_filter_store_save_finish(window->content_store, result, &err);
+static void
+bookmarksCb_loaded(GObject *UNUSED(source_object), GAsyncResult *result, gpointer UNUSED(user_data))
+{
+	GError *err                 = NULL;
+	struct Bookmarks *bookmarks = bookmarks_load_finish(result, &err);
 
-	if(filter == NULL)
-	{
-		if(err == NULL)
-		{
-			fprintf(stderr,
-			        _("badwolf: failed to compile content-filters.json, err: [%d] %s\n"),
-			        -1,
-			        "unknown");
-		}
-		else
-		{
-			fprintf(stderr,
-			        _("badwolf: failed to compile content-filters.json, err: [%d] %s\n"),
-			        err->code,
-			        err->message);
-		}
-	}
-	else
+	if(bookmarks == NULL)
 	{
-		webkit_user_content_filter_store_load(
-		    window->content_store, "a", NULL, content_managerCb_ready, window);
+		if(!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			fprintf(stderr, _("badwolf: Warning: Failed loading the bookmarks: %s\n"), err->message);
+		g_error_free(err);
+		return;
 	}
+
+	TRACE_BEGIN(__func__);
+
+	// Sorted once by the next query, instead of moving up each bookmark
+	completion->sorted = FALSE;
+	bookmarks_foreach(bookmarks, bookmarksCb_complete, NULL);
+	bookmarks_free(bookmarks);
+
+	TRACE_END(__func__);
 }
 
 int
 main(int argc, char *argv[])
 {
 	struct Window *window = &(struct Window){NULL, NULL, NULL, NULL, NULL, NULL};
+	guint restored;
 	GApplication *application;
 	setlocale(LC_ALL, "");
 	bindtextdomain(PACKAGE, DATADIR "/locale");
 	bind_textdomain_codeset(PACKAGE, "UTF-8");
 	textdomain(PACKAGE);
 
+	trace_init();
+	TRACE_BEGIN("startup");
+
 	application = g_application_new("me.hacktivis.badwolf",
 	                                G_APPLICATION_HANDLES_COMMAND_LINE |
 	                                    G_APPLICATION_SEND_ENVIRONMENT | G_APPLICATION_NON_UNIQUE);
 	g_application_register(application, NULL, NULL);
 	//g_application_activate(application);
 
+	TRACE_BEGIN("gtk_init");
 	gtk_init(&argc, &argv);
+	TRACE_END("gtk_init");
 
 	fprintf(stderr, _("Running Badwolf version: %s\n"), version);
 	fprintf(stderr,
@@ -1064,11 +1470,68 @@ main(int argc, char *argv[])
 	        webkit_get_minor_version(),
 	        webkit_get_micro_version());
 
-	web_extensions_directory =
-	    g_build_filename(g_get_user_data_dir(), "badwolf", "webkit-web-extension", NULL);
-	fprintf(stderr, _("webkit-web-extension directory set to: %s\n"), web_extensions_directory);
+	TRACE_BEGIN("badwolf_web_contexts_init");
+	badwolf_web_contexts_init();
+	TRACE_END("badwolf_web_contexts_init");
+
+	completion       = completion_new();
+	completion_model = gtk_list_store_new(LOCATION_COMPLETION_COLUMNS, G_TYPE_STRING, G_TYPE_STRING);
+
+	if(BADWOLF_HISTORY)
+	{
+		gchar *history_dir = g_build_filename(g_get_user_data_dir(), "badwolf", NULL);
+
+		TRACE_BEGIN("history_open");
+		history = history_open(history_dir);
+		// The most visited first, the rest once idle
+		if(history != NULL && historyCb_seed(NULL))
+			history_seed_id = g_idle_add(historyCb_seed, NULL);
+		TRACE_END("history_open");
+
+		g_free(history_dir);
+	}
+
+	// Parsed in a worker thread, completing from them once done
+	gchar *bookmarks_path =
+	    g_build_filename(g_get_user_data_dir(), "badwolf", "bookmarks.xbel", NULL);
+	bookmarks_load_async(bookmarks_path, bookmarksCb_loaded, NULL);
+	g_free(bookmarks_path);
+
+	// Fields without a policy get back to these
+	WebKitSettings *settings = webkit_settings_new_with_settings(BADWOLF_WEBKIT_SETTINGS);
+	site_policy_defaults.javascript = webkit_settings_get_enable_javascript_markup(settings);
+	site_policy_defaults.images     = webkit_settings_get_auto_load_images(settings);
+	site_policy_defaults.autoplay =
+	    !webkit_settings_get_media_playback_requires_user_gesture(settings);
+	site_policy_defaults.zoom = 1;
+	g_object_unref(settings);
+
+	GError *policies_err = NULL;
+	gchar *policies_path =
+	    g_build_filename(g_get_user_config_dir(), "badwolf", "site-policies", NULL);
+
+	site_policies = sitepolicy_new(policies_path);
+	if(!sitepolicy_load(site_policies, &policies_err))
+	{
+		if(!g_error_matches(policies_err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			fprintf(stderr,
+			        _("badwolf: Warning: Failed loading the site policies: %s\n"),
+			        policies_err->message);
+		g_error_free(policies_err);
+	}
+	g_free(policies_path);
 
-	g_object_ref(bookmarks_completion_model);
+	GError *keywords_err = NULL;
+	gchar *keywords_path = g_build_filename(g_get_user_config_dir(), "badwolf", "keywords", NULL);
+	if(!badwolf_uri_keywords_load(keywords_path, &keywords_err))
+	{
+		if(!g_error_matches(keywords_err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			fprintf(stderr,
+			        _("badwolf: Warning: Failed loading the keywords: %s\n"),
+			        keywords_err->message);
+		g_error_free(keywords_err);
+	}
+	g_free(keywords_path);
 
 	window->main_window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
 	window->notebook    = gtk_notebook_new();
@@ -1076,22 +1539,18 @@ main(int argc, char *argv[])
 	window->downloads_tab   = badwolf_downloads_tab_new();
 	window->content_manager = webkit_user_content_manager_new();
 
-	load_userscripts(window->content_manager);
+	badwolf_perf_init(window);
+	badwolf_find_init(window);
 
-	gchar *contentFilterPath =
-	    g_build_filename(g_get_user_config_dir(), g_get_prgname(), "content-filters.json", NULL);
-	GFile *contentFilterFile = g_file_new_for_path(contentFilterPath);
-	fprintf(stderr, _("content-filters file set to: %s\n"), contentFilterPath);
+	TRACE_BEGIN("load_userscripts");
+	load_userscripts(window);
+	TRACE_END("load_userscripts");
 
-	gchar *filtersPath = g_build_filename(g_get_user_cache_dir(), g_get_prgname(), "filters", NULL);
-	window->content_store = webkit_user_content_filter_store_new(filtersPath);
+	TRACE_BEGIN("badwolf_content_filters_init");
+	badwolf_content_filters_init(window);
+	TRACE_END("badwolf_content_filters_init");
 
-	webkit_user_content_filter_store_save_from_file(window->content_store,
-	                                                "a",
-	                                                contentFilterFile,
-	                                                NULL,
-	                                                (GAsyncReadyCallback)storeCb_finish,
-	                                                window);
+	TRACE_BEGIN("interface");
 
 	gtk_window_set_default_size(
 	    GTK_WINDOW(window->main_window), BADWOLF_DEFAULT_WIDTH, BADWOLF_DEFAULT_HEIGHT);
@@ -1143,21 +1602,54 @@ main(int argc, char *argv[])
 	g_signal_connect(window->main_window, "destroy", G_CALLBACK(gtk_main_quit), NULL);
 	g_signal_connect(window->new_tab, "clicked", G_CALLBACK(new_tabCb_clicked), window);
 	g_signal_connect(window->notebook, "switch-page", G_CALLBACK(notebookCb_switch__page), window);
+	g_signal_connect(
+	    window->notebook, "page-reordered", G_CALLBACK(notebookCb_page__reordered), window);
+
+	if(BADWOLF_TAB_HIBERNATE_TIMEOUT > 0)
+		g_timeout_add_seconds(BADWOLF_TAB_HIBERNATE_CHECK_INTERVAL, hibernateCb_timeout, window);
+	badwolf_memory_monitor_init(window);
 
 	gtk_widget_show(window->new_tab);
 	gtk_widget_show_all(window->main_window);
+	TRACE_END("interface");
+
+	TRACE_BEGIN("badwolf_session_restore");
+	restored = badwolf_session_restore(window);
+	TRACE_END("badwolf_session_restore");
+
+	badwolf_downloads_restore(window);
 
-	if(argc == 1)
+	TRACE_BEGIN("tabs");
+
+	if(argc == 1 && restored == 0)
 		badwolf_new_tab(GTK_NOTEBOOK(window->notebook), new_browser(window, NULL, NULL), FALSE);
 	else
 		for(int i = 1; i < argc; ++i)
-			badwolf_new_tab(GTK_NOTEBOOK(window->notebook), new_browser(window, argv[i], NULL), FALSE);
+		{
+			// Relative paths can't be told from hostnames without checking the filesystem
+			gchar *arg = g_file_test(argv[i], G_FILE_TEST_EXISTS)
+			                 ? g_canonicalize_filename(argv[i], NULL)
+			                 : g_strdup(argv[i]);
+
+			badwolf_new_tab(GTK_NOTEBOOK(window->notebook), new_lazy_browser(window, arg), FALSE);
+			g_free(arg);
+		}
+
+	// Restored sessions keep their selected tab, other tabs being opened next to it
+	if(restored == 0) gtk_notebook_set_current_page(GTK_NOTEBOOK(window->notebook), 1);
+	TRACE_END("tabs");
 
-	gtk_notebook_set_current_page(GTK_NOTEBOOK(window->notebook), 1);
+	TRACE_END("startup");
 
 	gtk_main();
 
-	g_object_unref(bookmarks_completion_model);
+	if(history_seed_id != 0) g_source_remove(history_seed_id);
+	if(history != NULL) history_close(history);
+	sitepolicy_free(site_policies);
+	g_object_unref(completion_model);
+	completion_free(completion);
+
+	trace_dump();
 
 #if 0
 	/* TRANSLATOR Ignore this entry. Done for forcing Unicode in xgettext. */
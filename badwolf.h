@@ -33,6 +33,16 @@ struct Window
 	WebKitUserContentFilterStore *content_store;
 };
 
+/* enum badwolf_dirty: Parts of a tab waiting to be updated, see browserCb_tick()
+ */
+enum badwolf_dirty
+{
+	BADWOLF_DIRTY_URI      = 1 << 0,
+	BADWOLF_DIRTY_TITLE    = 1 << 1,
+	BADWOLF_DIRTY_PROGRESS = 1 << 2,
+	BADWOLF_DIRTY_STATUS   = 1 << 3,
+};
+
 struct Client
 {
 	GtkWidget *box;
@@ -45,18 +55,67 @@ struct Client
 	GtkWidget *location;
 
 	uint64_t context_id;
+	gchar *container; /* Name of the shared context, NULL when it has its own, see contexts.h */
+	WebKitWebContext *web_context;
 	WebKitWebView *webView;
 	struct Window *window;
 
+	/* Set when webView got discarded, see hibernate.h */
+	struct Hibernation *hibernation;
+	gint64 last_active;
+
+	/* Crash recovery, see badwolf_tab_crashed() */
+	WebKitWebViewSessionState *session_snapshot;
+	guint crash_count;
+	guint restore_count;
+	guint restore_source;
+	gint64 last_crash;
+
+	guint32 session_id; /* 0 when not in the session journal, see session.h */
+
+	gchar *completion_uri; /* location counted as an open tab, see completion.h */
+
+	/* Built once by badwolf_new_tab_box(), then updated by webView_tab_label_change() */
+	GtkWidget *tab_box;
+	GtkWidget *tab_label;
+	GtkWidget *tab_playing;
+
+	/* WebView changes get applied once per frame, see browser_schedule_update() */
+	guint dirty; /* enum badwolf_dirty */
+	guint tick_id;
+	gchar *status_link; /* hovered link, NULL when there is none */
+
+	/* Monotonic times of the current load, 0 when not reached, see perf.h */
+	gint64 load_started;
+	gint64 load_redirected;
+	gint64 load_committed;
+
 	GtkWidget *statusbar;
 	GtkWidget *statuslabel;
 	GtkWidget *search;
+
+	/* Find in page, see find.h */
+	GtkWidget *search_matches; /* "n of m" */
+	GtkWidget *search_case;
+	GtkWidget *search_words;
+	GtkWidget *search_regex; /* NULL when WebKitGTK is too old for it */
+	guint search_timeout;
+	guint search_id;      /* of the regex search in the page, 0 when there is none */
+	guint search_count;   /* counted matches, G_MAXUINT when over BADWOLF_FIND_MAX_MATCHES */
+	guint search_current; /* starting at 1, 0 when unknown */
+
+	guint site_policy; /* enum sitepolicy_field applied to the current page, see sitepolicy.h */
 };
 
-GtkWidget *badwolf_new_tab_box(const gchar *title, struct Client *browser);
 void webView_tab_label_change(struct Client *browser, const gchar *title);
 struct Client *
 new_browser(struct Window *window, const gchar *target_url, struct Client *old_browser);
+struct Client *new_lazy_browser(struct Window *window, const gchar *target_url);
+struct Client *
+new_container_browser(struct Window *window, const gchar *target_url, const gchar *container);
+void badwolf_new_web_view(struct Client *browser, WebKitWebView *related_view, WebKitSettings *settings);
 int badwolf_new_tab(GtkNotebook *notebook, struct Client *browser, bool auto_switch);
+void badwolf_close_tab(struct Client *browser);
+void badwolf_load_uri(struct Client *browser, const gchar *uri);
 gint badwolf_get_tab_position(GtkContainer *notebook, GtkWidget *child);
 #endif /* BADWOLF_H_INCLUDED */
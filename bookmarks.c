@@ -0,0 +1,252 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "bookmarks.h"
+
+#include <errno.h>
+#include <glib/gstdio.h> /* g_fopen() */
+#include <stdio.h>       /* fread(), fclose() */
+#include <string.h>      /* strcmp(), strlen(), strerror() */
+
+/* struct BookmarksParser: State of the XBEL parsing, only the current bookmark being kept
+ */
+struct BookmarksParser
+{
+	GString *strings; /* see struct Bookmarks */
+	guint count;
+	gchar *href; /* of the current bookmark, NULL outside of one */
+	GString *title;
+	gboolean in_title;
+};
+
+static void
+bookmarks_start_element(GMarkupParseContext *context,
+                        const gchar *element_name,
+                        const gchar **attribute_names,
+                        const gchar **attribute_values,
+                        gpointer user_data,
+                        GError **err)
+{
+	struct BookmarksParser *parser = user_data;
+
+	(void)context;
+	(void)err;
+
+	if(strcmp(element_name, "bookmark") == 0)
+	{
+		g_free(parser->href);
+		parser->href = NULL;
+		g_string_truncate(parser->title, 0);
+
+		for(guint i = 0; attribute_names[i] != NULL && parser->href == NULL; i++)
+			if(strcmp(attribute_names[i], "href") == 0)
+				parser->href = g_strdup(attribute_values[i]);
+	}
+	// Folders also have titles
+	else if(strcmp(element_name, "title") == 0 && parser->href != NULL)
+		parser->in_title = TRUE;
+}
+
+static void
+bookmarks_end_element(GMarkupParseContext *context,
+                      const gchar *element_name,
+                      gpointer user_data,
+                      GError **err)
+{
+	struct BookmarksParser *parser = user_data;
+
+	(void)context;
+	(void)err;
+
+	if(strcmp(element_name, "title") == 0)
+		parser->in_title = FALSE;
+	else if(strcmp(element_name, "bookmark") == 0 && parser->href != NULL)
+	{
+		if(parser->href[0] != '\0')
+		{
+			g_strstrip(parser->title->str);
+
+			g_string_append_len(parser->strings, parser->href, (gssize)strlen(parser->href) + 1);
+			g_string_append_len(
+			    parser->strings, parser->title->str, (gssize)strlen(parser->title->str) + 1);
+			parser->count++;
+		}
+
+		g_free(parser->href);
+		parser->href = NULL;
+	}
+}
+
+static void
+bookmarks_text(GMarkupParseContext *context,
+               const gchar *text,
+               gsize text_len,
+               gpointer user_data,
+               GError **err)
+{
+	struct BookmarksParser *parser = user_data;
+
+	(void)context;
+	(void)err;
+
+	// Can be called several times for the same element
+	if(parser->in_title) g_string_append_len(parser->title, text, (gssize)text_len);
+}
+
+static const GMarkupParser bookmarks_markup_parser = {
+    bookmarks_start_element, bookmarks_end_element, bookmarks_text, NULL, NULL};
+
+static GMarkupParseContext *
+bookmarks_context_new(struct BookmarksParser *parser)
+{
+	parser->strings  = g_string_new(NULL);
+	parser->count    = 0;
+	parser->href     = NULL;
+	parser->title    = g_string_new(NULL);
+	parser->in_title = FALSE;
+
+	return g_markup_parse_context_new(&bookmarks_markup_parser, 0, parser, NULL);
+}
+
+/* bookmarks_context_free: Returns the parsed bookmarks when ok, NULL otherwise
+ */
+static struct Bookmarks *
+bookmarks_context_free(GMarkupParseContext *context, struct BookmarksParser *parser, gboolean ok)
+{
+	struct Bookmarks *bookmarks;
+
+	g_markup_parse_context_free(context);
+	g_string_free(parser->title, TRUE);
+	g_free(parser->href);
+
+	if(!ok)
+	{
+		g_string_free(parser->strings, TRUE);
+		return NULL;
+	}
+
+	bookmarks        = g_malloc(sizeof(struct Bookmarks));
+	bookmarks->len   = parser->strings->len;
+	bookmarks->count = parser->count;
+	// GString grows by doubling, only what's used is kept
+	bookmarks->strings = g_realloc(g_string_free(parser->strings, FALSE), bookmarks->len + 1);
+
+	return bookmarks;
+}
+
+void
+bookmarks_free(struct Bookmarks *bookmarks)
+{
+	g_free(bookmarks->strings);
+	g_free(bookmarks);
+}
+
+/* bookmarks_parse: Bookmarks of the XBEL document text, NULL with err set on failure
+ */
+struct Bookmarks *
+bookmarks_parse(const gchar *text, gssize len, GError **err)
+{
+	struct BookmarksParser parser;
+	GMarkupParseContext *context = bookmarks_context_new(&parser);
+	gboolean ok                  = g_markup_parse_context_parse(context, text, len, err);
+
+	if(ok) ok = g_markup_parse_context_end_parse(context, err);
+
+	return bookmarks_context_free(context, &parser, ok);
+}
+
+/* bookmarks_parse_file: Same as bookmarks_parse() but for the file at path,
+ * which is read in chunks, memory use only depending on the amount of bookmarks
+ */
+struct Bookmarks *
+bookmarks_parse_file(const gchar *path, GError **err)
+{
+	struct BookmarksParser parser;
+	GMarkupParseContext *context;
+	FILE *file = g_fopen(path, "rb");
+	gchar *chunk;
+	gsize len;
+	gboolean ok = TRUE;
+
+	if(file == NULL)
+	{
+		int errsv = errno;
+
+		g_set_error(err, G_FILE_ERROR, g_file_error_from_errno(errsv), "%s", strerror(errsv));
+		return NULL;
+	}
+
+	context = bookmarks_context_new(&parser);
+	chunk   = g_malloc(BOOKMARKS_CHUNK);
+
+	while(ok && (len = fread(chunk, 1, BOOKMARKS_CHUNK, file)) > 0)
+		ok = g_markup_parse_context_parse(context, chunk, (gssize)len, err);
+
+	if(ok && ferror(file))
+	{
+		g_set_error(err, G_FILE_ERROR, G_FILE_ERROR_IO, "%s", strerror(errno));
+		ok = FALSE;
+	}
+
+	if(ok) ok = g_markup_parse_context_end_parse(context, err);
+
+	g_free(chunk);
+	fclose(file);
+
+	return bookmarks_context_free(context, &parser, ok);
+}
+
+/* bookmarks_foreach: Calls func for each bookmark, in the order of the file
+ */
+void
+bookmarks_foreach(struct Bookmarks *bookmarks, BookmarksFunc func, gpointer user_data)
+{
+	const gchar *uri = bookmarks->strings;
+
+	for(guint i = 0; i < bookmarks->count; i++)
+	{
+		const gchar *title = uri + strlen(uri) + 1;
+
+		func(uri, title, user_data);
+
+		uri = title + strlen(title) + 1;
+	}
+}
+
+static void
+bookmarksCb_load(GTask *task,
+                 gpointer source_object,
+                 gpointer task_data,
+                 GCancellable *cancellable)
+{
+	GError *err                 = NULL;
+	struct Bookmarks *bookmarks = bookmarks_parse_file(task_data, &err);
+
+	(void)source_object;
+	(void)cancellable;
+
+	if(bookmarks == NULL)
+		g_task_return_error(task, err);
+	else
+		g_task_return_pointer(task, bookmarks, (GDestroyNotify)bookmarks_free);
+}
+
+/* bookmarks_load_async: Parses the XBEL file at path in a worker thread,
+ * callback getting the result with bookmarks_load_finish()
+ */
+void
+bookmarks_load_async(const gchar *path, GAsyncReadyCallback callback, gpointer user_data)
+{
+	GTask *task = g_task_new(NULL, NULL, callback, user_data);
+
+	g_task_set_task_data(task, g_strdup(path), g_free);
+	g_task_run_in_thread(task, bookmarksCb_load);
+	g_object_unref(task);
+}
+
+struct Bookmarks *
+bookmarks_load_finish(GAsyncResult *result, GError **err)
+{
+	return g_task_propagate_pointer(G_TASK(result), err);
+}
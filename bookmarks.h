@@ -0,0 +1,30 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef BOOKMARKS_H_INCLUDED
+#define BOOKMARKS_H_INCLUDED
+#include <gio/gio.h>
+
+/* BOOKMARKS_CHUNK: Bytes of the XBEL file read (and parsed) at once
+ */
+#define BOOKMARKS_CHUNK (64 * 1024)
+
+/* struct Bookmarks: The bookmarks of an XBEL file, in a single buffer,
+ * see bookmarks_foreach().
+ */
+struct Bookmarks
+{
+	gchar *strings; /* URI then title of each bookmark, NUL-terminated */
+	gsize len;
+	guint count;
+};
+
+typedef void (*BookmarksFunc)(const gchar *uri, const gchar *title, gpointer user_data);
+
+void bookmarks_free(struct Bookmarks *bookmarks);
+struct Bookmarks *bookmarks_parse(const gchar *text, gssize len, GError **err);
+struct Bookmarks *bookmarks_parse_file(const gchar *path, GError **err);
+void bookmarks_foreach(struct Bookmarks *bookmarks, BookmarksFunc func, gpointer user_data);
+void bookmarks_load_async(const gchar *path, GAsyncReadyCallback callback, gpointer user_data);
+struct Bookmarks *bookmarks_load_finish(GAsyncResult *result, GError **err);
+#endif /* BOOKMARKS_H_INCLUDED */
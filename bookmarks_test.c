@@ -0,0 +1,191 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "bookmarks.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>  /* g_unlink() */
+#include <stdio.h>        /* fprintf() */
+#include <sys/resource.h> /* getrusage() */
+
+static void
+bookmarks_join(const gchar *uri, const gchar *title, gpointer user_data)
+{
+	g_string_append_printf((GString *)user_data, "%s|%s\n", uri, title);
+}
+
+static void
+bookmarks_parse_test(void)
+{
+	struct
+	{
+		const gchar *xbel;
+		const gchar *expect; /* NULL when it's invalid */
+	} cases[] = {
+	    //
+	    {"<xbel/>", ""},
+	    {"<?xml version=\"1.0\"?>\n"
+	     "<!DOCTYPE xbel PUBLIC "
+	     "\"+//IDN python.org//DTD XML Bookmark Exchange Language 1.0//EN//XML\" "
+	     "\"http://pyxml.sourceforge.net/topics/dtds/xbel.dtd\">\n"
+	     "<xbel version=\"1.0\">\n"
+	     "  <title>Bookmarks</title>\n"
+	     "  <bookmark href=\"https://example.org/\"><title>Example</title></bookmark>\n"
+	     "  <folder>\n"
+	     "    <title>Folder</title>\n"
+	     "    <bookmark id=\"b1\" href=\"https://example.org/a?b=1&amp;c=2\">\n"
+	     "      <title> A &lt;&amp;&gt; B </title>\n"
+	     "      <desc>Not the title</desc>\n"
+	     "    </bookmark>\n"
+	     "    <separator/>\n"
+	     "    <bookmark href=\"https://example.net/\"/>\n"
+	     "    <bookmark><title>No href</title></bookmark>\n"
+	     "  </folder>\n"
+	     "</xbel>\n",
+	     "https://example.org/|Example\n"
+	     "https://example.org/a?b=1&c=2|A <&> B\n"
+	     "https://example.net/|\n"},
+	    {"<xbel><bookmark href=\"https://example.org/\"><title>Unclosed</title></xbel>", NULL},
+	    {"<xbel><bookmark href=\"https://example.org/&unknown;\"/></xbel>", NULL} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		GError *err                 = NULL;
+		struct Bookmarks *bookmarks = bookmarks_parse(cases[i].xbel, -1, &err);
+		GString *got;
+
+		g_info("bookmarks_parse(\"%s\")", cases[i].xbel);
+
+		if(cases[i].expect == NULL)
+		{
+			g_assert_null(bookmarks);
+			g_assert_nonnull(err);
+			g_clear_error(&err);
+			continue;
+		}
+
+		g_assert_no_error(err);
+
+		got = g_string_new(NULL);
+		bookmarks_foreach(bookmarks, bookmarks_join, got);
+
+		if(g_strcmp0(got->str, cases[i].expect) != 0)
+		{
+			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got->str);
+		}
+
+		g_string_free(got, TRUE);
+		bookmarks_free(bookmarks);
+	}
+}
+
+static void
+bookmarks_parse_file_test(void)
+{
+	gchar *path     = g_build_filename(g_get_tmp_dir(), "badwolf-bookmarks_test.xbel", NULL);
+	GString *xbel   = g_string_new("<xbel>");
+	GString *expect = g_string_new(NULL);
+	struct Bookmarks *bookmarks;
+	GError *err = NULL;
+	GString *got;
+
+	// Spanning several chunks
+	for(guint i = 0; xbel->len < 3 * BOOKMARKS_CHUNK; i++)
+	{
+		g_string_append_printf(xbel,
+		                       "<bookmark href=\"https://example.org/%u\">"
+		                       "<title>Page %u</title></bookmark>",
+		                       i,
+		                       i);
+		g_string_append_printf(expect, "https://example.org/%u|Page %u\n", i, i);
+	}
+	g_string_append(xbel, "</xbel>");
+
+	g_unlink(path);
+	g_assert_null(bookmarks_parse_file(path, &err));
+	g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_clear_error(&err);
+
+	g_assert_true(g_file_set_contents(path, xbel->str, (gssize)xbel->len, NULL));
+
+	bookmarks = bookmarks_parse_file(path, &err);
+	g_assert_no_error(err);
+
+	got = g_string_new(NULL);
+	bookmarks_foreach(bookmarks, bookmarks_join, got);
+	g_assert_cmpstr(got->str, ==, expect->str);
+
+	g_string_free(got, TRUE);
+	bookmarks_free(bookmarks);
+	g_unlink(path);
+	g_string_free(expect, TRUE);
+	g_string_free(xbel, TRUE);
+	g_free(path);
+}
+
+static void
+bookmarks_parse_file_perf(void)
+{
+	gchar *path = g_build_filename(g_get_tmp_dir(), "badwolf-bookmarks_perf.xbel", NULL);
+	FILE *file  = fopen(path, "w"); // flawfinder: ignore
+	struct Bookmarks *bookmarks;
+	struct rusage before, after;
+	GError *err = NULL;
+	gdouble elapsed;
+
+	g_assert_nonnull(file);
+
+	fprintf(file, "<?xml version=\"1.0\"?>\n<xbel version=\"1.0\">\n");
+	for(guint folder = 0; folder < 500; folder++)
+	{
+		fprintf(file, "<folder><title>Folder %u</title>\n", folder);
+		for(guint i = 0; i < 100; i++)
+			fprintf(file,
+			        "<bookmark href=\"https://site%u.example/path/to/page-%u?q=%u\" "
+			        "added=\"2023-01-01\">"
+			        "<title>Some page about things %u</title>"
+			        "<desc>A description which doesn't get kept</desc></bookmark>\n",
+			        folder,
+			        i,
+			        folder * 100 + i,
+			        i);
+		fprintf(file, "</folder>\n");
+	}
+	fprintf(file, "</xbel>\n");
+	g_assert_cmpint(fclose(file), ==, 0);
+
+	getrusage(RUSAGE_SELF, &before);
+
+	g_test_timer_start();
+	bookmarks = bookmarks_parse_file(path, &err);
+	elapsed   = g_test_timer_elapsed();
+
+	getrusage(RUSAGE_SELF, &after);
+
+	g_assert_no_error(err);
+	g_assert_cmpuint(bookmarks->count, ==, 50000);
+
+	g_test_minimized_result(elapsed, "50000 bookmarks loaded in %.3fms", elapsed * 1000);
+	g_test_message("index: %" G_GSIZE_FORMAT " KiB, peak memory: %ld KiB (+%ld KiB)",
+	               bookmarks->len / 1024,
+	               after.ru_maxrss,
+	               after.ru_maxrss - before.ru_maxrss);
+
+	bookmarks_free(bookmarks);
+	g_unlink(path);
+	g_free(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/bookmarks_parse/test", bookmarks_parse_test);
+	g_test_add_func("/bookmarks_parse_file/test", bookmarks_parse_file_test);
+	if(g_test_perf()) g_test_add_func("/bookmarks_parse_file/perf", bookmarks_parse_file_perf);
+
+	return g_test_run();
+}
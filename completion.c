@@ -0,0 +1,402 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "completion.h"
+
+#include <string.h> /* strlen(), strncmp() */
+
+#define COMPLETION_EPOCH 1577836800 /* 2020-01-01, so weights stay in range for decades */
+#define COMPLETION_TOKENS_MAX 8
+
+static void
+completion_entry_free(gpointer data)
+{
+	struct CompletionEntry *entry = data;
+
+	g_free(entry->uri);
+	g_free(entry->title);
+	g_free(entry->key);
+	g_free(entry);
+}
+
+struct Completion *
+completion_new(void)
+{
+	struct Completion *completion = g_malloc(sizeof(struct Completion));
+
+	completion->entries = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, completion_entry_free);
+	completion->slots   = g_array_new(FALSE, FALSE, sizeof(struct CompletionSlot));
+	completion->sorted  = FALSE;
+
+	return completion;
+}
+
+void
+completion_free(struct Completion *completion)
+{
+	g_array_free(completion->slots, TRUE);
+	g_hash_table_destroy(completion->entries);
+	g_free(completion);
+}
+
+/* completion_weight: 2^((time - COMPLETION_EPOCH) / COMPLETION_HALF_LIFE), with 2^f taken as 1+f.
+ * Growing with time instead of decaying, the ratio between two frecencies never changes
+ * so they're only computed once per visit.
+ */
+gdouble
+completion_weight(gint64 time)
+{
+	gint64 age      = time - COMPLETION_EPOCH;
+	gint64 halvings = age / COMPLETION_HALF_LIFE;
+	gint64 rest     = age % COMPLETION_HALF_LIFE;
+	gdouble weight  = 1;
+
+	if(rest < 0)
+	{
+		rest += COMPLETION_HALF_LIFE;
+		halvings--;
+	}
+
+	for(gint64 i = 0; i < MIN(halvings, 1000); i++)
+		weight *= 2;
+	for(gint64 i = 0; i > MAX(halvings, -1000); i--)
+		weight /= 2;
+
+	return weight * (1 + (gdouble)rest / COMPLETION_HALF_LIFE);
+}
+
+/* completion_mask: Bitset of the characters in text, letters and digits each get their own bit
+ * others sharing the rest, used to skip entries which can't match before looking at their text
+ */
+guint64
+completion_mask(const gchar *text, gsize len)
+{
+	guint64 mask = 0;
+
+	for(gsize i = 0; i < len; i++)
+	{
+		guchar c = (guchar)text[i];
+
+		if(c >= 'a' && c <= 'z')
+			mask |= G_GUINT64_CONSTANT(1) << (c - 'a');
+		else if(c >= '0' && c <= '9')
+			mask |= G_GUINT64_CONSTANT(1) << (26 + c - '0');
+		else if(c != ' ')
+			mask |= G_GUINT64_CONSTANT(1) << (36 + c % 28);
+	}
+
+	return mask;
+}
+
+static gchar *
+completion_key(const gchar *uri, const gchar *title)
+{
+	const gchar *location = uri;
+	const gchar *sep      = strstr(uri, "://");
+	gchar *key, *lower;
+
+	if(sep != NULL) location = sep + 3;
+	if(g_ascii_strncasecmp(location, "www.", 4) == 0) location += 4;
+
+	key   = g_strconcat(location, " ", title != NULL ? title : "", NULL);
+	lower = g_utf8_strdown(key, -1);
+	g_free(key);
+
+	return lower;
+}
+
+static struct CompletionSlot *
+completion_slot(struct Completion *completion, guint index)
+{
+	return &g_array_index(completion->slots, struct CompletionSlot, index);
+}
+
+static void
+completion_entry_set_key(struct Completion *completion, struct CompletionEntry *entry)
+{
+	g_free(entry->key);
+	entry->key     = completion_key(entry->uri, entry->title);
+	entry->key_len = strlen(entry->key);
+
+	completion_slot(completion, entry->index)->mask = completion_mask(entry->key, entry->key_len);
+}
+
+/* completion_raise: Moves entry up after its frecency increased, to keep the slots sorted
+ */
+static void
+completion_raise(struct Completion *completion, struct CompletionEntry *entry)
+{
+	struct CompletionSlot slot = *completion_slot(completion, entry->index);
+	guint i                    = entry->index;
+
+	slot.frecency = entry->frecency;
+
+	if(completion->sorted)
+	{
+		for(; i > 0 && completion_slot(completion, i - 1)->frecency < slot.frecency; i--)
+		{
+			*completion_slot(completion, i) = *completion_slot(completion, i - 1);
+			completion_slot(completion, i)->entry->index = i;
+		}
+	}
+
+	*completion_slot(completion, i) = slot;
+	entry->index                    = i;
+}
+
+static struct CompletionEntry *
+completion_get(struct Completion *completion, const gchar *uri, const gchar *title)
+{
+	struct CompletionEntry *entry = g_hash_table_lookup(completion->entries, uri);
+	struct CompletionSlot slot    = {0, 0, NULL};
+
+	if(entry != NULL)
+	{
+		if(title != NULL && title[0] != '\0' && g_strcmp0(title, entry->title) != 0)
+		{
+			g_free(entry->title);
+			entry->title = g_strdup(title);
+			completion_entry_set_key(completion, entry);
+		}
+
+		return entry;
+	}
+
+	entry        = g_malloc0(sizeof(struct CompletionEntry));
+	entry->uri   = g_strdup(uri);
+	entry->title = g_strdup(title);
+	entry->index = completion->slots->len;
+
+	slot.entry = entry;
+	g_array_append_val(completion->slots, slot);
+	completion_entry_set_key(completion, entry);
+
+	g_hash_table_insert(completion->entries, entry->uri, entry);
+
+	return entry;
+}
+
+/* completion_visit: Counts a visit of uri at time (in seconds since the UNIX epoch)
+ */
+struct CompletionEntry *
+completion_visit(struct Completion *completion, const gchar *uri, const gchar *title, gint64 time)
+{
+	struct CompletionEntry *entry = completion_get(completion, uri, title);
+
+	entry->visits++;
+	entry->frecency += completion_weight(time);
+	completion_raise(completion, entry);
+
+	return entry;
+}
+
+/* completion_add: Adds visits counted elsewhere (like in the history), with their frecency
+ */
+struct CompletionEntry *
+completion_add(struct Completion *completion,
+               const gchar *uri,
+               const gchar *title,
+               guint visits,
+               gdouble frecency)
+{
+	struct CompletionEntry *entry = completion_get(completion, uri, title);
+
+	entry->visits += visits;
+	entry->frecency += frecency;
+	completion_raise(completion, entry);
+
+	return entry;
+}
+
+struct CompletionEntry *
+completion_bookmark(struct Completion *completion, const gchar *uri, const gchar *title)
+{
+	struct CompletionEntry *entry = completion_get(completion, uri, title);
+
+	if(entry->bookmark) return entry;
+
+	entry->bookmark = TRUE;
+	entry->frecency +=
+	    COMPLETION_BOOKMARK_VISITS * completion_weight(g_get_real_time() / G_USEC_PER_SEC);
+	completion_raise(completion, entry);
+
+	return entry;
+}
+
+void
+completion_set_title(struct Completion *completion, const gchar *uri, const gchar *title)
+{
+	if(g_hash_table_contains(completion->entries, uri)) completion_get(completion, uri, title);
+}
+
+void
+completion_tab_opened(struct Completion *completion, const gchar *uri)
+{
+	struct CompletionEntry *entry = completion_get(completion, uri, NULL);
+
+	// Not visited yet, still wanted amongst the results
+	if(entry->frecency == 0)
+	{
+		entry->frecency = completion_weight(g_get_real_time() / G_USEC_PER_SEC);
+		completion_raise(completion, entry);
+	}
+
+	entry->tabs++;
+}
+
+void
+completion_tab_closed(struct Completion *completion, const gchar *uri)
+{
+	struct CompletionEntry *entry = g_hash_table_lookup(completion->entries, uri);
+
+	if(entry != NULL && entry->tabs > 0) entry->tabs--;
+}
+
+/* completion_match: Quality of the match of token (lowercase) in entry, 0 when it doesn't match:
+ * - COMPLETION_MATCH_MAX when the location starts with it
+ * - half of it when it starts a word
+ * - a quarter of it anywhere else
+ * - up to 1 for its characters appearing in order, the closer the better
+ */
+gdouble
+completion_match(const struct CompletionEntry *entry, const gchar *token, gsize len)
+{
+	const gchar *key = entry->key;
+	const gchar *end = key + entry->key_len;
+	const gchar *found;
+	gboolean substring = FALSE;
+	gsize start = 0, j = 0;
+
+	if(len > entry->key_len) return 0;
+	if(strncmp(key, token, len) == 0) return COMPLETION_MATCH_MAX;
+
+	for(found = key + 1; found + len <= end; found++)
+	{
+		found = g_strstr_len(found, (gssize)(end - found), token);
+		if(found == NULL) break;
+
+		if(!g_ascii_isalnum(found[-1])) return COMPLETION_MATCH_MAX / 2;
+		substring = TRUE;
+	}
+
+	if(substring) return COMPLETION_MATCH_MAX / 4;
+
+	for(gsize i = 0; i < entry->key_len && j < len; i++)
+	{
+		if(key[i] != token[j]) continue;
+
+		if(j == 0) start = i;
+		j++;
+
+		if(j == len) return (gdouble)len / (gdouble)(i - start + 1);
+	}
+
+	return 0;
+}
+
+static gint
+completion_frecency_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct CompletionSlot *slot_a = a;
+	const struct CompletionSlot *slot_b = b;
+
+	if(slot_a->frecency > slot_b->frecency) return -1;
+	if(slot_a->frecency < slot_b->frecency) return 1;
+
+	return 0;
+}
+
+static void
+completion_sort(struct Completion *completion)
+{
+	g_array_sort(completion->slots, completion_frecency_cmp);
+
+	for(guint i = 0; i < completion->slots->len; i++)
+		completion_slot(completion, i)->entry->index = i;
+
+	completion->sorted = TRUE;
+}
+
+/* completion_query: Best (at most max) entries matching all the words of query,
+ * scored by their match quality times their frecency.
+ *
+ * Entries are looked at by decreasing frecency, stopping once even a perfect match
+ * couldn't get amongst the results. Returned entries belong to completion.
+ */
+GPtrArray *
+completion_query(struct Completion *completion, const gchar *query, guint max)
+{
+	GPtrArray *results = g_ptr_array_sized_new(max);
+	gchar *lower       = g_utf8_strdown(query, -1);
+	gchar **words      = g_strsplit_set(lower, " \t", -1);
+	const gchar *tokens[COMPLETION_TOKENS_MAX];
+	gsize lengths[COMPLETION_TOKENS_MAX];
+	guint n_tokens = 0;
+	guint64 mask   = 0;
+
+	for(gchar **word = words; *word != NULL && n_tokens < COMPLETION_TOKENS_MAX; word++)
+	{
+		const gchar *token = *word;
+		const gchar *sep   = strstr(token, "://");
+
+		if(token[0] == '\0') continue;
+
+		// Same as the keys
+		if(n_tokens == 0)
+		{
+			if(sep != NULL) token = sep + 3;
+			if(strncmp(token, "www.", 4) == 0) token += 4;
+			if(token[0] == '\0') continue;
+		}
+
+		tokens[n_tokens]  = token;
+		lengths[n_tokens] = strlen(token);
+		mask |= completion_mask(token, lengths[n_tokens]);
+		n_tokens++;
+	}
+
+	if(n_tokens == 0 || max == 0) goto clean;
+
+	if(!completion->sorted) completion_sort(completion);
+
+	for(guint i = 0; i < completion->slots->len; i++)
+	{
+		struct CompletionSlot *slot = completion_slot(completion, i);
+		struct CompletionEntry *entry;
+		gdouble quality = COMPLETION_MATCH_MAX;
+		guint pos;
+
+		if(results->len == max &&
+		   COMPLETION_MATCH_MAX * slot->frecency <=
+		       ((struct CompletionEntry *)g_ptr_array_index(results, max - 1))->score)
+			break;
+
+		if((slot->mask & mask) != mask) continue;
+
+		entry = slot->entry;
+
+		for(guint t = 0; t < n_tokens && quality > 0; t++)
+			quality = MIN(quality, completion_match(entry, tokens[t], lengths[t]));
+
+		if(quality == 0) continue;
+
+		entry->score = quality * entry->frecency;
+
+		// Insertion in the (short) sorted results
+		for(pos = results->len; pos > 0; pos--)
+			if(((struct CompletionEntry *)g_ptr_array_index(results, pos - 1))->score >=
+			   entry->score)
+				break;
+
+		if(pos == max) continue;
+		if(results->len == max) g_ptr_array_remove_index(results, max - 1);
+		g_ptr_array_insert(results, (gint)pos, entry);
+	}
+
+clean:
+	g_strfreev(words);
+	g_free(lower);
+
+	return results;
+}
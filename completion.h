@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef COMPLETION_H_INCLUDED
+#define COMPLETION_H_INCLUDED
+#include <glib.h>
+
+/* COMPLETION_HALF_LIFE: Seconds after which a visit counts half as much in the frecency
+ * COMPLETION_BOOKMARK_VISITS: Visits a bookmark is worth
+ * COMPLETION_MATCH_MAX: Best match quality, see completion_match()
+ */
+#define COMPLETION_HALF_LIFE (30 * 24 * 3600)
+#define COMPLETION_BOOKMARK_VISITS 5
+#define COMPLETION_MATCH_MAX 8.0
+
+struct CompletionEntry
+{
+	gchar *uri;
+	gchar *title;
+	gchar *key;       /* lowercase URI without scheme nor "www.", a space, lowercase title */
+	gsize key_len;
+	gdouble frecency; /* visits weighted by their age, only comparable between entries */
+	guint visits;
+	gboolean bookmark;
+	guint tabs;    /* amount of open tabs at this URI */
+	guint index;   /* position in struct Completion slots */
+	gdouble score; /* of the latest completion_query() */
+};
+
+/* struct CompletionSlot: What queries look at first, contiguous to be scanned quickly
+ */
+struct CompletionSlot
+{
+	guint64 mask; /* characters present in the key, see completion_mask() */
+	gdouble frecency;
+	struct CompletionEntry *entry;
+};
+
+/* struct Completion: In-memory index of the locations known for completion (history,
+ * bookmarks and open tabs), see completion_query().
+ */
+struct Completion
+{
+	GHashTable *entries; /* URI → struct CompletionEntry */
+	GArray *slots;       /* struct CompletionSlot, by decreasing frecency when sorted */
+	gboolean sorted;
+};
+
+struct Completion *completion_new(void);
+void completion_free(struct Completion *completion);
+gdouble completion_weight(gint64 time);
+guint64 completion_mask(const gchar *text, gsize len);
+gdouble completion_match(const struct CompletionEntry *entry, const gchar *token, gsize len);
+struct CompletionEntry *
+completion_visit(struct Completion *completion, const gchar *uri, const gchar *title, gint64 time);
+struct CompletionEntry *completion_add(struct Completion *completion,
+                                       const gchar *uri,
+                                       const gchar *title,
+                                       guint visits,
+                                       gdouble frecency);
+struct CompletionEntry *
+completion_bookmark(struct Completion *completion, const gchar *uri, const gchar *title);
+void completion_set_title(struct Completion *completion, const gchar *uri, const gchar *title);
+void completion_tab_opened(struct Completion *completion, const gchar *uri);
+void completion_tab_closed(struct Completion *completion, const gchar *uri);
+GPtrArray *completion_query(struct Completion *completion, const gchar *query, guint max);
+#endif /* COMPLETION_H_INCLUDED */
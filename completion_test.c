@@ -0,0 +1,227 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "completion.h"
+
+#include <glib.h>
+#include <string.h> /* strlen() */
+
+#define NOW 1700000000
+
+static void
+completion_weight_test(void)
+{
+	const gint64 epoch = 1577836800;
+	struct
+	{
+		gint64 time;
+		gdouble expect;
+	} cases[] = {
+	    //
+	    {epoch, 1},
+	    {epoch + COMPLETION_HALF_LIFE, 2},
+	    {epoch + 3 * COMPLETION_HALF_LIFE, 8},
+	    {epoch + COMPLETION_HALF_LIFE / 2, 1.5},
+	    {epoch - COMPLETION_HALF_LIFE, 0.5},
+	    {epoch - COMPLETION_HALF_LIFE / 2, 0.75} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		gdouble got = completion_weight(cases[i].time);
+
+		g_info("completion_weight(%" G_GINT64_FORMAT ")", cases[i].time);
+
+		if(got != cases[i].expect)
+		{
+			g_error("expected: %g, got: %g", cases[i].expect, got);
+		}
+	}
+}
+
+static void
+completion_match_test(void)
+{
+	struct Completion *completion = completion_new();
+	struct CompletionEntry *entry =
+	    completion_visit(completion, "https://www.example.org/foo-bar", "Hello World", NOW);
+	struct
+	{
+		const gchar *token;
+		gdouble expect;
+	} cases[] = {
+	    //
+	    {"exa", COMPLETION_MATCH_MAX},
+	    {"example.org/", COMPLETION_MATCH_MAX},
+	    {"org", COMPLETION_MATCH_MAX / 2},
+	    {"bar", COMPLETION_MATCH_MAX / 2},
+	    {"hello", COMPLETION_MATCH_MAX / 2},
+	    {"ample", COMPLETION_MATCH_MAX / 4},
+	    {"orld", COMPLETION_MATCH_MAX / 4},
+	    {"xmpl", 0.8},
+	    {"zzz", 0},
+	    {"example.org/foo-bar hello world!", 0} //
+	};
+
+	g_assert_cmpstr(entry->key, ==, "example.org/foo-bar hello world");
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		gdouble got = completion_match(entry, cases[i].token, strlen(cases[i].token));
+
+		g_info("completion_match(\"%s\")", cases[i].token);
+
+		if(got != cases[i].expect)
+		{
+			g_error("expected: %g, got: %g", cases[i].expect, got);
+		}
+	}
+
+	completion_free(completion);
+}
+
+static void
+completion_query_test(void)
+{
+	struct Completion *completion = completion_new();
+	struct
+	{
+		const gchar *query;
+		guint max;
+		const gchar *expect;
+	} cases[] = {
+	    //
+	    {"git", 10, "https://git.example/ https://github.com/ https://example.org/gitlab "},
+	    {"git", 2, "https://git.example/ https://github.com/ "},
+	    {"https://GIT", 10, "https://git.example/ https://github.com/ https://example.org/gitlab "},
+	    {"gh", 10, "https://github.com/ "},
+	    {"git example", 10, "https://git.example/ https://example.org/gitlab "},
+	    {"code", 10, "https://github.com/ "},
+	    {"   ", 10, ""},
+	    {"nothing", 10, ""} //
+	};
+
+	for(int i = 0; i < 3; i++)
+		completion_visit(completion, "https://git.example/", NULL, NOW);
+	completion_visit(completion, "https://github.com/", "Where code lives", NOW);
+	completion_visit(completion, "https://example.org/gitlab", NULL, NOW - 365 * 24 * 3600);
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		GPtrArray *results = completion_query(completion, cases[i].query, cases[i].max);
+		GString *got       = g_string_new(NULL);
+
+		g_info("completion_query(\"%s\", %u)", cases[i].query, cases[i].max);
+
+		for(guint r = 0; r < results->len; r++)
+			g_string_append_printf(
+			    got, "%s ", ((struct CompletionEntry *)g_ptr_array_index(results, r))->uri);
+
+		if(g_strcmp0(got->str, cases[i].expect) != 0)
+		{
+			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got->str);
+		}
+
+		g_string_free(got, TRUE);
+		g_ptr_array_free(results, TRUE);
+	}
+
+	// Visits keep the list sorted, a word-start match can then beat a prefix one
+	for(int i = 0; i < 10; i++)
+		completion_visit(completion, "https://example.org/gitlab", NULL, NOW);
+
+	GPtrArray *results = completion_query(completion, "git", 1);
+	g_assert_cmpuint(results->len, ==, 1);
+	g_assert_cmpstr(((struct CompletionEntry *)g_ptr_array_index(results, 0))->uri,
+	                ==,
+	                "https://example.org/gitlab");
+	g_ptr_array_free(results, TRUE);
+
+	// Open tabs can be completed before being visited
+	completion_tab_opened(completion, "https://tab.example/");
+	results = completion_query(completion, "tab", 10);
+	g_assert_cmpuint(results->len, >=, 1);
+	g_assert_cmpstr(
+	    ((struct CompletionEntry *)g_ptr_array_index(results, 0))->uri, ==, "https://tab.example/");
+	g_assert_cmpuint(((struct CompletionEntry *)g_ptr_array_index(results, 0))->tabs, ==, 1);
+	g_ptr_array_free(results, TRUE);
+
+	completion_free(completion);
+}
+
+/* completion_query_perf: Queries over 200k entries, made of random words,
+ * visited at random times during the past year.
+ */
+static void
+completion_query_perf(void)
+{
+	const gchar *words[] = {"git",
+	                        "wiki",
+	                        "news",
+	                        "docs",
+	                        "mail",
+	                        "forum",
+	                        "shop",
+	                        "video",
+	                        "blog",
+	                        "search",
+	                        "issue",
+	                        "page",
+	                        "code",
+	                        "map"};
+	const gchar *queries[] = {"g", "git", "wiki page", "news 12", "gtbl", "xqz", "https://docs"};
+	const guint n_words    = G_N_ELEMENTS(words);
+	struct Completion *completion = completion_new();
+	gdouble elapsed;
+
+	g_test_timer_start();
+	for(guint i = 0; i < 200000; i++)
+	{
+		gchar *uri = g_strdup_printf("https://%s%u.example/%s/%u",
+		                             words[g_test_rand_int_range(0, (gint32)n_words)],
+		                             (guint)g_test_rand_int_range(0, 1000),
+		                             words[g_test_rand_int_range(0, (gint32)n_words)],
+		                             i);
+		gchar *title = g_strdup_printf("%s %s %u",
+		                               words[g_test_rand_int_range(0, (gint32)n_words)],
+		                               words[g_test_rand_int_range(0, (gint32)n_words)],
+		                               i);
+
+		completion_visit(
+		    completion, uri, title, NOW - g_test_rand_int_range(0, 365 * 24 * 3600));
+
+		g_free(title);
+		g_free(uri);
+	}
+	g_test_message("200000 entries indexed in %.3fms", g_test_timer_elapsed() * 1000);
+
+	// First query sorts the entries
+	g_ptr_array_free(completion_query(completion, "a", 10), TRUE);
+
+	for(size_t q = 0; q < G_N_ELEMENTS(queries); q++)
+	{
+		g_test_timer_start();
+		for(int i = 0; i < 100; i++)
+			g_ptr_array_free(completion_query(completion, queries[q], 10), TRUE);
+		elapsed = g_test_timer_elapsed() / 100;
+
+		g_test_minimized_result(
+		    elapsed, "completion_query(\"%s\"): %.3fms", queries[q], elapsed * 1000);
+	}
+
+	completion_free(completion);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/completion_weight/test", completion_weight_test);
+	g_test_add_func("/completion_match/test", completion_match_test);
+	g_test_add_func("/completion_query/test", completion_query_test);
+	if(g_test_perf()) g_test_add_func("/completion_query/perf", completion_query_perf);
+
+	return g_test_run();
+}
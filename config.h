@@ -111,6 +111,140 @@
  */
 #define BADWOLF_DOWNLOAD_FILE_PATH_ELLIPSIZE PANGO_ELLIPSIZE_MIDDLE
 
+/* BADWOLF_DOWNLOAD_UPDATE_INTERVAL: Milliseconds between two updates of the progress of a download
+ * BADWOLF_DOWNLOAD_RATE_SMOOTHING: Weight (0 to 1) of the latest interval in the throughput
+ * shown, lower is smoother but slower to follow changes
+ */
+#define BADWOLF_DOWNLOAD_UPDATE_INTERVAL 500
+#define BADWOLF_DOWNLOAD_RATE_SMOOTHING 0.2
+
+/* BADWOLF_DOWNLOAD_ASK: Ask where to save downloads with a (non-modal) file chooser,
+ * instead of saving them right away into the download directory, see badwolf(1).
+ * Needs WebKitGTK 2.40 or later.
+ * BADWOLF_DOWNLOAD_MAX_RENAMES: Maximum n of "name (n).ext" tried when name.ext already exists
+ */
+#define BADWOLF_DOWNLOAD_ASK FALSE
+#define BADWOLF_DOWNLOAD_MAX_RENAMES 999
+
+/* BADWOLF_DOWNLOADS_INDEX: Record finished downloads in the downloads index, see badwolf(1)
+ * BADWOLF_DOWNLOADS_FINISHED_ROWS: Finished downloads kept in the list, the oldest ones
+ * being removed (but still in the index)
+ * BADWOLF_DOWNLOADS_SEARCH_RESULTS: Previous downloads listed from the index
+ */
+#define BADWOLF_DOWNLOADS_INDEX TRUE
+#define BADWOLF_DOWNLOADS_FINISHED_ROWS 50
+#define BADWOLF_DOWNLOADS_SEARCH_RESULTS 50
+
+/* BADWOLF_DOWNLOADS_MAX_ACTIVE: Downloads transferring at the same time, others being queued
+ * BADWOLF_DOWNLOADS_MAX_PER_HOST: Same but for downloads from the same host
+ */
+#define BADWOLF_DOWNLOADS_MAX_ACTIVE 4
+#define BADWOLF_DOWNLOADS_MAX_PER_HOST 2
+
+/* BADWOLF_TAB_HIBERNATE_TIMEOUT: Seconds after which a background tab gets hibernated,
+ * discarding its WebView (and web process) until the tab is selected again.
+ * Set to 0 to only hibernate via the keybinding.
+ */
+#define BADWOLF_TAB_HIBERNATE_TIMEOUT 1800
+
+// BADWOLF_TAB_HIBERNATE_CHECK_INTERVAL: Seconds between checks for tabs to hibernate
+#define BADWOLF_TAB_HIBERNATE_CHECK_INTERVAL 60
+
+/* BADWOLF_TAB_LAZY_LOADING_MAX: Tabs opened from the command-line are created without a WebView,
+ * which gets created when the tab is selected or in the background while less than this amount
+ * of tabs are loading.
+ * Set to 0 to only create them when selected.
+ */
+#define BADWOLF_TAB_LAZY_LOADING_MAX 2
+
+/* BADWOLF_CONTEXT_POOL_MAX: Maximum amount of shared contexts (containers) alive at once,
+ * tabs of any container past this limit get an isolated context like by default.
+ * See BADWOLF_CONTAINER in badwolf(1).
+ */
+#define BADWOLF_CONTEXT_POOL_MAX 8
+
+/* BADWOLF_MEMORY_*: Default memory pressure settings of the web processes,
+ * can be overriden at runtime with BADWOLF_MEMORY_PRESSURE, see badwolf(1).
+ * - LIMIT: In MiB, 0 lets WebKit pick one based on the system memory
+ * - CONSERVATIVE_THRESHOLD / STRICT_THRESHOLD: fractions of LIMIT after which caches get released
+ * - KILL_THRESHOLD: fraction of LIMIT after which the web process gets killed, 0 to never kill
+ * - POLL_INTERVAL: In seconds
+ *
+ * See https://webkitgtk.org/reference/webkit2gtk/stable/struct.MemoryPressureSettings.html
+ */
+#define BADWOLF_MEMORY_LIMIT 0
+#define BADWOLF_MEMORY_CONSERVATIVE_THRESHOLD 0.33
+#define BADWOLF_MEMORY_STRICT_THRESHOLD 0.5
+#define BADWOLF_MEMORY_KILL_THRESHOLD 0
+#define BADWOLF_MEMORY_POLL_INTERVAL 30
+
+/* BADWOLF_TAB_RECLAIM_IDLE: On a low-memory warning from the system, background tabs idle for
+ * at least this amount of seconds get hibernated, on a critical one all background tabs are.
+ */
+#define BADWOLF_TAB_RECLAIM_IDLE 300
+
+/* BADWOLF_TAB_CRASH_*: Restoring tabs after their web process crashed or got killed
+ * - BACKOFF: Delay (in milliseconds) before the first restore, doubled on each successive crash
+ * - BACKOFF_MAX: Maximum delay (in milliseconds) before a restore
+ * - MAX: Amount of successive crashes after which the tab isn't restored anymore
+ * - RESET: Seconds a page has to stay alive for its crashes to not be considered successive
+ */
+#define BADWOLF_TAB_CRASH_BACKOFF 500
+#define BADWOLF_TAB_CRASH_BACKOFF_MAX 60000
+#define BADWOLF_TAB_CRASH_MAX 5
+#define BADWOLF_TAB_CRASH_RESET 60
+
+/* BADWOLF_SESSION_*: Session journal, enabled by setting BADWOLF_SESSION, see badwolf(1)
+ * - FLUSH_INTERVAL: Seconds during which events get batched before being written
+ * - COMPACT_SIZE: Bytes appended to the journal after which it gets rewritten
+ *   with only what's needed to restore the current tabs
+ */
+#define BADWOLF_SESSION_FLUSH_INTERVAL 2
+#define BADWOLF_SESSION_COMPACT_SIZE (4 * 1024 * 1024)
+
+/* BADWOLF_USERSCRIPT_RELOAD_DELAY: Milliseconds a userscript has to stay unchanged
+ * before getting reloaded, editors tending to save files in several steps
+ */
+#define BADWOLF_USERSCRIPT_RELOAD_DELAY 250
+
+/* BADWOLF_TRACE_EVENTS: Events kept per thread when tracing, older ones being overwritten,
+ * see BADWOLF_TRACE in badwolf(1)
+ */
+#define BADWOLF_TRACE_EVENTS 65536
+
+/* BADWOLF_PERF_HOSTS: Hosts with their own page-load timings at badwolf:perf,
+ * the following ones being counted together
+ */
+#define BADWOLF_PERF_HOSTS 1000
+
+/* BADWOLF_HISTORY: Whether visited pages get stored in the history, see badwolf(1)
+ */
+#define BADWOLF_HISTORY TRUE
+
+/* BADWOLF_COMPLETION_RESULTS: Locations proposed while typing in the location entry
+ */
+#define BADWOLF_COMPLETION_RESULTS 10
+
+/* BADWOLF_COMPLETION_HISTORY_STEP: History entries the completion gets at once on startup,
+ * the most visited ones first, the rest following while idle
+ */
+#define BADWOLF_COMPLETION_HISTORY_STEP 1000
+
+/* BADWOLF_SEARCH_URI: Where text typed in the location entry which isn't an address gets searched,
+ * %s being replaced by the text, keywords being in ${XDG_CONFIG_HOME}/badwolf/keywords
+ */
+#define BADWOLF_SEARCH_URI "https://duckduckgo.com/html/?q=%s"
+
+/* BADWOLF_FIND_DELAY: Milliseconds the search entry has to stay unchanged before searching,
+ * BADWOLF_FIND_SHORT_DELAY being used for one or two characters as they match most of a page
+ */
+#define BADWOLF_FIND_DELAY 150
+#define BADWOLF_FIND_SHORT_DELAY 500
+
+/* BADWOLF_FIND_MAX_MATCHES: Matches counted when searching in a page, more being shown as "1000+"
+ */
+#define BADWOLF_FIND_MAX_MATCHES 1000
+
 // BADWOLF_LOCATION_INLINE_SELECTION: show selected completion as a selection in location entry
 #define BADWOLF_LOCATION_INLINE_SELECTION TRUE
 
@@ -0,0 +1,228 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "contexts.h"
+
+#include "config.h"
+#include "downloads.h"
+#include "perf.h"
+
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <stdio.h>      /* fprintf() */
+#include <stdlib.h>     /* getenv() */
+
+struct PooledContext
+{
+	gchar *name;
+	uint64_t context_id;
+	WebKitWebContext *web_context; /* weak reference, owned by the tabs using it */
+};
+
+static gchar *web_extensions_directory;
+static gchar **spell_checking_languages = NULL;
+static const gchar *default_container   = NULL;
+static uint64_t context_id_counter      = 0;
+static GHashTable *pool                 = NULL;
+
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+static WebKitMemoryPressureSettings *memory_pressure_settings = NULL;
+
+/* memory_pressure_settings_new: Parses BADWOLF_MEMORY_PRESSURE, with each field
+ * defaulting to the matching BADWOLF_MEMORY_* value from config.h
+ */
+static WebKitMemoryPressureSettings *
+memory_pressure_settings_new(const char *env)
+{
+	WebKitMemoryPressureSettings *settings = webkit_memory_pressure_settings_new();
+	gchar **fields                         = g_strsplit(env != NULL ? env : "", ":", 5);
+	guint n_fields                         = g_strv_length(fields);
+	guint64 limit                          = BADWOLF_MEMORY_LIMIT;
+	gdouble values[4]                      = {
+	    BADWOLF_MEMORY_CONSERVATIVE_THRESHOLD,
+	    BADWOLF_MEMORY_STRICT_THRESHOLD,
+	    BADWOLF_MEMORY_KILL_THRESHOLD,
+	    BADWOLF_MEMORY_POLL_INTERVAL,
+	};
+
+	if(n_fields > 0 && fields[0][0] != '\0') limit = g_ascii_strtoull(fields[0], NULL, 10);
+	for(guint i = 1; i < n_fields; i++)
+		if(fields[i][0] != '\0') values[i - 1] = g_ascii_strtod(fields[i], NULL);
+
+	g_strfreev(fields);
+
+	if(limit > 0 && limit <= G_MAXUINT)
+		webkit_memory_pressure_settings_set_memory_limit(settings, (guint)limit);
+
+	// Same constraints as WebKit, checked here to print something more useful than a critical
+	if(values[0] > 0 && values[0] < values[1] && values[1] < 1)
+	{
+		webkit_memory_pressure_settings_set_conservative_threshold(settings, values[0]);
+		webkit_memory_pressure_settings_set_strict_threshold(settings, values[1]);
+	}
+	else
+		fprintf(stderr,
+		        _("badwolf: Warning: Memory thresholds must be 0 < conservative < strict < 1, "
+		          "got %g and %g, using WebKit defaults\n"),
+		        values[0],
+		        values[1]);
+
+	if(values[2] == 0 || values[2] > 1)
+		webkit_memory_pressure_settings_set_kill_threshold(settings, values[2]);
+	else
+		fprintf(stderr,
+		        _("badwolf: Warning: Memory kill threshold must be 0 or > 1, got %g, "
+		          "using WebKit default\n"),
+		        values[2]);
+
+	if(values[3] > 0) webkit_memory_pressure_settings_set_poll_interval(settings, values[3]);
+
+	fprintf(stderr,
+	        _("badwolf: Memory pressure settings: limit %u MiB, thresholds %g/%g, kill at %g, "
+	          "polled every %gs\n"),
+	        webkit_memory_pressure_settings_get_memory_limit(settings),
+	        webkit_memory_pressure_settings_get_conservative_threshold(settings),
+	        webkit_memory_pressure_settings_get_strict_threshold(settings),
+	        webkit_memory_pressure_settings_get_kill_threshold(settings),
+	        webkit_memory_pressure_settings_get_poll_interval(settings));
+
+	return settings;
+}
+#endif
+
+/* badwolf_web_contexts_init: Reads the environment and settings shared by every context,
+ * must be called once before creating any context.
+ */
+void
+badwolf_web_contexts_init(void)
+{
+	/* flawfinder: ignore. Consider that g_strsplit is safe enough */
+	char *badwolf_l10n = getenv("BADWOLF_L10N");
+
+	if(badwolf_l10n != NULL) spell_checking_languages = g_strsplit(badwolf_l10n, ":", -1);
+
+	/* flawfinder: ignore. Only used as a hash table key */
+	default_container = getenv("BADWOLF_CONTAINER");
+	if(default_container != NULL && default_container[0] == '\0') default_container = NULL;
+
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+	/* flawfinder: ignore. Only parsed with g_strsplit and g_ascii_strto* */
+	memory_pressure_settings = memory_pressure_settings_new(getenv("BADWOLF_MEMORY_PRESSURE"));
+	webkit_website_data_manager_set_memory_pressure_settings(memory_pressure_settings);
+#endif
+
+	web_extensions_directory =
+	    g_build_filename(g_get_user_data_dir(), "badwolf", "webkit-web-extension", NULL);
+	fprintf(stderr, _("webkit-web-extension directory set to: %s\n"), web_extensions_directory);
+
+	pool = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+/* badwolf_default_container: Name of the container new tabs go in, NULL when they each get
+ * their own context (the default).
+ */
+const gchar *
+badwolf_default_container(void)
+{
+	return default_container;
+}
+
+uint64_t
+badwolf_context_id_new(void)
+{
+	return context_id_counter++;
+}
+
+/* badwolf_web_context_new: Creates a new isolated (ephemeral) WebKitWebContext
+ */
+WebKitWebContext *
+badwolf_web_context_new(struct Window *window)
+{
+	WebKitWebsiteDataManager *website_data_manager = webkit_website_data_manager_new_ephemeral();
+	webkit_website_data_manager_set_itp_enabled(website_data_manager, TRUE);
+
+#if WEBKIT_CHECK_VERSION(2, 34, 0)
+	WebKitWebContext *web_context = g_object_new(WEBKIT_TYPE_WEB_CONTEXT,
+	                                             "website-data-manager",
+	                                             website_data_manager,
+	                                             "memory-pressure-settings",
+	                                             memory_pressure_settings,
+	                                             NULL);
+#else
+	WebKitWebContext *web_context =
+	    webkit_web_context_new_with_website_data_manager(website_data_manager);
+#endif
+	g_object_unref(website_data_manager);
+	webkit_web_context_set_sandbox_enabled(web_context, TRUE);
+	webkit_web_context_set_web_extensions_directory(web_context, web_extensions_directory);
+
+	webkit_web_context_register_uri_scheme(
+	    web_context, "badwolf", badwolf_perf_schemeCb_request, NULL, NULL);
+	// Can't be loaded by web pages
+	webkit_security_manager_register_uri_scheme_as_local(
+	    webkit_web_context_get_security_manager(web_context), "badwolf");
+
+	g_signal_connect(G_OBJECT(web_context),
+	                 "download-started",
+	                 G_CALLBACK(web_contextCb_download_started),
+	                 window);
+
+	if(spell_checking_languages != NULL)
+	{
+		webkit_web_context_set_spell_checking_languages(
+		    web_context, (const gchar *const *)spell_checking_languages);
+		webkit_web_context_set_spell_checking_enabled(web_context, TRUE);
+	}
+
+	return web_context;
+}
+
+static void
+pooled_contextCb_finalized(gpointer user_data, GObject *UNUSED(web_context))
+{
+	struct PooledContext *pooled = (struct PooledContext *)user_data;
+
+	g_hash_table_remove(pool, pooled->name);
+
+	g_free(pooled->name);
+	g_free(pooled);
+}
+
+/* badwolf_web_context_get: Gets a new reference to the context shared by the tabs of container,
+ * creating it when needed.
+ *
+ * Returns NULL when BADWOLF_CONTEXT_POOL_MAX contexts are already alive,
+ * the caller is then expected to fallback to badwolf_web_context_new().
+ */
+WebKitWebContext *
+badwolf_web_context_get(struct Window *window, const gchar *container, uint64_t *context_id)
+{
+	struct PooledContext *pooled = g_hash_table_lookup(pool, container);
+
+	if(pooled != NULL)
+	{
+		*context_id = pooled->context_id;
+		return g_object_ref(pooled->web_context);
+	}
+
+	if(g_hash_table_size(pool) >= BADWOLF_CONTEXT_POOL_MAX)
+	{
+		fprintf(stderr,
+		        _("badwolf: Notice: %d shared contexts already alive, container \"%s\" gets an "
+		          "isolated one\n"),
+		        BADWOLF_CONTEXT_POOL_MAX,
+		        container);
+		return NULL;
+	}
+
+	pooled              = g_malloc(sizeof(struct PooledContext));
+	pooled->name        = g_strdup(container);
+	pooled->context_id  = badwolf_context_id_new();
+	pooled->web_context = badwolf_web_context_new(window);
+
+	g_object_weak_ref(G_OBJECT(pooled->web_context), pooled_contextCb_finalized, pooled);
+	g_hash_table_insert(pool, pooled->name, pooled);
+
+	*context_id = pooled->context_id;
+	return pooled->web_context;
+}
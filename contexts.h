@@ -0,0 +1,14 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef CONTEXTS_H_INCLUDED
+#define CONTEXTS_H_INCLUDED
+#include "badwolf.h"
+
+void badwolf_web_contexts_init(void);
+const gchar *badwolf_default_container(void);
+uint64_t badwolf_context_id_new(void);
+WebKitWebContext *badwolf_web_context_new(struct Window *window);
+WebKitWebContext *
+badwolf_web_context_get(struct Window *window, const gchar *container, uint64_t *context_id);
+#endif /* CONTEXTS_H_INCLUDED */
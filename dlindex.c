@@ -0,0 +1,199 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "dlindex.h"
+
+#include <errno.h>
+#include <glib/gstdio.h> /* g_fopen() */
+#include <stdio.h>       /* fputs(), fclose() */
+#include <string.h>      /* memchr(), strerror() */
+
+#define DLINDEX_FIELDS 6
+
+/* dlindex_escape: Keeps fields on a single line, with URI-style escapes
+ */
+static void
+dlindex_escape(GString *line, const gchar *field)
+{
+	for(const gchar *c = field != NULL ? field : ""; *c != '\0'; c++)
+	{
+		if(*c == '\t' || *c == '\n' || *c == '\r' || *c == '%')
+			g_string_append_printf(line, "%%%02X", (guint)(guchar)*c);
+		else
+			g_string_append_c(line, *c);
+	}
+}
+
+gchar *
+dlindex_format(const struct DownloadRecord *record)
+{
+	GString *line = g_string_new(NULL);
+
+	g_string_append_printf(line, "%" G_GINT64_FORMAT "\t", record->time);
+	dlindex_escape(line, record->status);
+	g_string_append_printf(line, "\t%" G_GUINT64_FORMAT "\t%.3f\t", record->size, record->duration);
+	dlindex_escape(line, record->uri);
+	g_string_append_c(line, '\t');
+	dlindex_escape(line, record->destination);
+	g_string_append_c(line, '\n');
+
+	return g_string_free(line, FALSE);
+}
+
+/* dlindex_parse: Parses a line (without its newline) into record,
+ * which has to be freed with dlindex_record_free() on success
+ */
+gboolean
+dlindex_parse(const gchar *line, gsize length, struct DownloadRecord *record)
+{
+	gchar *copy = g_strndup(line, length);
+	gchar **fields;
+
+	fields = g_strsplit(copy, "\t", DLINDEX_FIELDS);
+	g_free(copy);
+
+	if(g_strv_length(fields) != DLINDEX_FIELDS)
+	{
+		g_strfreev(fields);
+		return FALSE;
+	}
+
+	record->time        = g_ascii_strtoll(fields[0], NULL, 10);
+	record->status      = g_uri_unescape_string(fields[1], NULL);
+	record->size        = g_ascii_strtoull(fields[2], NULL, 10);
+	record->duration    = g_ascii_strtod(fields[3], NULL);
+	record->uri         = g_uri_unescape_string(fields[4], NULL);
+	record->destination = g_uri_unescape_string(fields[5], NULL);
+
+	g_strfreev(fields);
+
+	if(record->status == NULL || record->uri == NULL || record->destination == NULL)
+	{
+		g_free(record->status);
+		g_free(record->uri);
+		g_free(record->destination);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void
+dlindex_record_free(struct DownloadRecord *record)
+{
+	g_free(record->status);
+	g_free(record->uri);
+	g_free(record->destination);
+	g_free(record);
+}
+
+gboolean
+dlindex_append(const gchar *path, const struct DownloadRecord *record, GError **error)
+{
+	gchar *line = dlindex_format(record);
+	gboolean ok;
+	FILE *file;
+
+	file = g_fopen(path, "a"); // flawfinder: ignore
+	if(file == NULL)
+	{
+		int saved_errno = errno;
+
+		g_set_error(error,
+		            G_FILE_ERROR,
+		            g_file_error_from_errno(saved_errno),
+		            "%s: %s",
+		            path,
+		            strerror(saved_errno));
+		g_free(line);
+		return FALSE;
+	}
+
+	// A single write, so lines don't get interleaved
+	ok = fputs(line, file) != EOF;
+	ok = fclose(file) == 0 && ok;
+
+	if(!ok) g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_IO, "%s: %s", path, strerror(errno));
+
+	g_free(line);
+
+	return ok;
+}
+
+/* dlindex_contains: ASCII case-insensitive search of needle (lowercase) in haystack
+ */
+static gboolean
+dlindex_contains(const gchar *haystack, gsize length, const gchar *needle, gsize needle_len)
+{
+	if(needle_len > length) return FALSE;
+
+	for(gsize i = 0; i <= length - needle_len; i++)
+	{
+		gsize j = 0;
+
+		while(j < needle_len && g_ascii_tolower(haystack[i + j]) == needle[j])
+			j++;
+
+		if(j == needle_len) return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* dlindex_search: Newest records (at most max) with query in one of their fields,
+ * only the matching lines get parsed
+ */
+GPtrArray *
+dlindex_search(const gchar *path, const gchar *query, guint max, GError **error)
+{
+	GPtrArray *results = g_ptr_array_new_with_free_func((GDestroyNotify)dlindex_record_free);
+	gchar *needle      = g_ascii_strdown(query, -1);
+	gsize needle_len   = strlen(needle);
+	GMappedFile *mapped;
+	const gchar *contents;
+	gsize end;
+
+	mapped = g_mapped_file_new(path, FALSE, error);
+	if(mapped == NULL)
+	{
+		g_free(needle);
+		g_ptr_array_free(results, TRUE);
+		return NULL;
+	}
+
+	contents = g_mapped_file_get_contents(mapped);
+	end      = g_mapped_file_get_length(mapped);
+
+	// Read backwards, latest downloads being at the end
+	while(end > 0 && results->len < max)
+	{
+		gsize start = end - 1;
+		gsize length;
+
+		// Skip the newline ending the line
+		if(contents[start] == '\n') end = start;
+
+		while(start > 0 && contents[start - 1] != '\n')
+			start--;
+
+		length = end - start;
+
+		if(length > 0 && dlindex_contains(contents + start, length, needle, needle_len))
+		{
+			struct DownloadRecord *record = g_malloc0(sizeof(struct DownloadRecord));
+
+			if(dlindex_parse(contents + start, length, record))
+				g_ptr_array_add(results, record);
+			else
+				g_free(record);
+		}
+
+		end = start;
+	}
+
+	g_mapped_file_unref(mapped);
+	g_free(needle);
+
+	return results;
+}
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DLINDEX_H_INCLUDED
+#define DLINDEX_H_INCLUDED
+#include <glib.h>
+
+/* Downloads index: append-only file with one line per download,
+ * made of tab-separated fields in the order of struct DownloadRecord.
+ */
+struct DownloadRecord
+{
+	gint64 time;        /* UNIX timestamp of the end of the download */
+	gchar *status;      /* "finished", "failed" or "cancelled" */
+	guint64 size;       /* bytes received */
+	gdouble duration;   /* seconds */
+	gchar *uri;
+	gchar *destination; /* URI, empty when none got chosen */
+};
+
+gchar *dlindex_format(const struct DownloadRecord *record);
+gboolean dlindex_parse(const gchar *line, gsize length, struct DownloadRecord *record);
+void dlindex_record_free(struct DownloadRecord *record);
+gboolean dlindex_append(const gchar *path, const struct DownloadRecord *record, GError **error);
+GPtrArray *dlindex_search(const gchar *path, const gchar *query, guint max, GError **error);
+#endif /* DLINDEX_H_INCLUDED */
@@ -0,0 +1,134 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "dlindex.h"
+
+#include <glib.h>
+#include <glib/gstdio.h> /* g_unlink() */
+#include <string.h>      /* strlen() */
+
+static void
+dlindex_format_test(void)
+{
+	struct
+	{
+		struct DownloadRecord record;
+		const gchar *expect;
+	} cases[] = {
+	    //
+	    {{1, "finished", 42, 0.5, "https://example.org/a.txt", "file:///tmp/a.txt"},
+	     "1\tfinished\t42\t0.500\thttps://example.org/a.txt\tfile:///tmp/a.txt\n"},
+	    {{2, "failed", 0, 0, "https://example.org/100%25", ""},
+	     "2\tfailed\t0\t0.000\thttps://example.org/100%2525\t\n"},
+	    {{3, "cancelled", 1, 1, "https://example.org/", "file:///tmp/a\tb\nc"},
+	     "3\tcancelled\t1\t1.000\thttps://example.org/\tfile:///tmp/a%09b%0Ac\n"} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		gchar *got = dlindex_format(&cases[i].record);
+		struct DownloadRecord parsed;
+
+		g_info("dlindex_format(%s)", cases[i].record.uri);
+
+		if(g_strcmp0(got, cases[i].expect) != 0)
+		{
+			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got);
+		}
+
+		// Round-trip, without the newline
+		g_assert_true(dlindex_parse(got, strlen(got) - 1, &parsed));
+		g_assert_cmpint(parsed.time, ==, cases[i].record.time);
+		g_assert_cmpstr(parsed.status, ==, cases[i].record.status);
+		g_assert_cmpuint(parsed.size, ==, cases[i].record.size);
+		g_assert_cmpfloat(parsed.duration, ==, cases[i].record.duration);
+		g_assert_cmpstr(parsed.uri, ==, cases[i].record.uri);
+		g_assert_cmpstr(parsed.destination, ==, cases[i].record.destination);
+
+		g_free(parsed.status);
+		g_free(parsed.uri);
+		g_free(parsed.destination);
+		g_free(got);
+	}
+
+	g_assert_false(dlindex_parse("1\tfinished\t42", 14, &(struct DownloadRecord){0}));
+}
+
+static void
+dlindex_search_test(void)
+{
+	gchar *path = g_build_filename(g_get_tmp_dir(), "badwolf-dlindex_test.index", NULL);
+	struct DownloadRecord records[] = {
+	    //
+	    {1, "finished", 1, 1, "https://example.org/One.txt", "file:///tmp/One.txt"},
+	    {2, "failed", 2, 2, "https://example.net/two.txt", ""},
+	    {3, "finished", 3, 3, "https://example.org/three.txt", "file:///tmp/three.txt"} //
+	};
+	struct
+	{
+		const gchar *query;
+		guint max;
+		gint64 expect[3];
+	} cases[] = {
+	    //
+	    {"", 10, {3, 2, 1}},
+	    {"", 2, {3, 2, 0}},
+	    {"example.org", 10, {3, 1, 0}},
+	    {"ONE", 10, {1, 0, 0}},
+	    {"failed", 10, {2, 0, 0}},
+	    {"nothing", 10, {0, 0, 0}} //
+	};
+	GError *err = NULL;
+
+	g_unlink(path);
+
+	g_assert_null(dlindex_search(path, "", 10, &err));
+	g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_clear_error(&err);
+
+	for(size_t i = 0; i < sizeof(records) / sizeof(records[0]); i++)
+		g_assert_true(dlindex_append(path, &records[i], NULL));
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		GPtrArray *got = dlindex_search(path, cases[i].query, cases[i].max, &err);
+		guint n        = 0;
+
+		g_info("dlindex_search(\"%s\", %u)", cases[i].query, cases[i].max);
+
+		g_assert_no_error(err);
+
+		for(; n < 3 && cases[i].expect[n] != 0; n++)
+		{
+			struct DownloadRecord *record;
+
+			if(n >= got->len) g_error("expected: %u results, got: %u", n + 1, got->len);
+
+			record = g_ptr_array_index(got, n);
+			if(record->time != cases[i].expect[n])
+			{
+				g_error("expected: %" G_GINT64_FORMAT ", got: %" G_GINT64_FORMAT,
+				        cases[i].expect[n],
+				        record->time);
+			}
+		}
+
+		g_assert_cmpuint(got->len, ==, n);
+		g_ptr_array_free(got, TRUE);
+	}
+
+	g_unlink(path);
+	g_free(path);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/dlindex_format/test", dlindex_format_test);
+	g_test_add_func("/dlindex_search/test", dlindex_search_test);
+
+	return g_test_run();
+}
@@ -0,0 +1,237 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "dlqueue.h"
+
+#include <string.h> /* strchr(), strncmp(), strpbrk() */
+
+static struct DlQueueItem *
+dlqueue_item_new(const gchar *uri, enum dlqueue_state state, gpointer data)
+{
+	struct DlQueueItem *item = g_malloc(sizeof(struct DlQueueItem));
+	GUri *guri               = g_uri_parse(uri, G_URI_FLAGS_NONE, NULL);
+
+	item->uri   = g_strdup(uri);
+	item->host  = g_strdup(guri != NULL && g_uri_get_host(guri) != NULL ? g_uri_get_host(guri) : "");
+	item->state = state;
+	item->data  = data;
+
+	if(guri != NULL) g_uri_unref(guri);
+
+	return item;
+}
+
+void
+dlqueue_item_free(struct DlQueueItem *item)
+{
+	g_free(item->uri);
+	g_free(item->host);
+	g_free(item);
+}
+
+struct DlQueue *
+dlqueue_new(guint max_active, guint max_per_host, DlQueueStartFunc start, gpointer user_data)
+{
+	struct DlQueue *queue = g_malloc(sizeof(struct DlQueue));
+
+	queue->max_active   = max_active;
+	queue->max_per_host = max_per_host;
+	queue->start        = start;
+	queue->user_data    = user_data;
+	queue->active       = 0;
+	queue->hosts        = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	g_queue_init(&queue->items);
+
+	return queue;
+}
+
+void
+dlqueue_free(struct DlQueue *queue)
+{
+	g_queue_clear_full(&queue->items, (GDestroyNotify)dlqueue_item_free);
+	g_hash_table_destroy(queue->hosts);
+	g_free(queue);
+}
+
+static guint
+dlqueue_host_active(struct DlQueue *queue, const gchar *host)
+{
+	return GPOINTER_TO_UINT(g_hash_table_lookup(queue->hosts, host));
+}
+
+static void
+dlqueue_set_active(struct DlQueue *queue, struct DlQueueItem *item, gboolean active)
+{
+	guint count = dlqueue_host_active(queue, item->host);
+
+	if(active)
+	{
+		queue->active++;
+		count++;
+	}
+	else
+	{
+		queue->active--;
+		count--;
+	}
+
+	if(count == 0)
+		g_hash_table_remove(queue->hosts, item->host);
+	else
+		g_hash_table_insert(queue->hosts, g_strdup(item->host), GUINT_TO_POINTER(count));
+}
+
+/* dlqueue_schedule: Starts the waiting items which fit in the limits, in queue order
+ */
+void
+dlqueue_schedule(struct DlQueue *queue)
+{
+	GList *l = queue->items.head;
+
+	while(l != NULL && queue->active < queue->max_active)
+	{
+		struct DlQueueItem *item = l->data;
+
+		// Next one first, as the start function may remove the item
+		l = l->next;
+
+		if(item->state != DLQUEUE_WAITING) continue;
+		if(dlqueue_host_active(queue, item->host) >= queue->max_per_host) continue;
+
+		item->state = DLQUEUE_ACTIVE;
+		dlqueue_set_active(queue, item, TRUE);
+
+		queue->start(queue, item, queue->user_data);
+	}
+}
+
+/* dlqueue_push: Queues uri at the end, starting it if the limits allow it (and not paused)
+ */
+struct DlQueueItem *
+dlqueue_push(struct DlQueue *queue, const gchar *uri, gboolean paused, gpointer data)
+{
+	struct DlQueueItem *item =
+	    dlqueue_item_new(uri, paused ? DLQUEUE_PAUSED : DLQUEUE_WAITING, data);
+
+	g_queue_push_tail(&queue->items, item);
+	dlqueue_schedule(queue);
+
+	return item;
+}
+
+/* dlqueue_remove: Removes and frees item, once finished or cancelled
+ */
+void
+dlqueue_remove(struct DlQueue *queue, struct DlQueueItem *item)
+{
+	if(!g_queue_remove(&queue->items, item)) return;
+
+	if(item->state == DLQUEUE_ACTIVE) dlqueue_set_active(queue, item, FALSE);
+	dlqueue_item_free(item);
+
+	dlqueue_schedule(queue);
+}
+
+/* dlqueue_bump: Moves item to the front of the queue, so it's the next one to start
+ */
+void
+dlqueue_bump(struct DlQueue *queue, struct DlQueueItem *item)
+{
+	GList *link = g_queue_find(&queue->items, item);
+
+	if(link == NULL) return;
+
+	g_queue_unlink(&queue->items, link);
+	g_queue_push_head_link(&queue->items, link);
+
+	dlqueue_schedule(queue);
+}
+
+/* dlqueue_pause: Keeps item from being started, freeing its slot when it was active.
+ * Returns the previous state, an active item having to be stopped by the caller.
+ */
+enum dlqueue_state
+dlqueue_pause(struct DlQueue *queue, struct DlQueueItem *item)
+{
+	enum dlqueue_state previous = item->state;
+
+	if(previous == DLQUEUE_PAUSED) return previous;
+
+	item->state = DLQUEUE_PAUSED;
+
+	if(previous == DLQUEUE_ACTIVE)
+	{
+		dlqueue_set_active(queue, item, FALSE);
+		dlqueue_schedule(queue);
+	}
+
+	return previous;
+}
+
+/* dlqueue_resume: Puts a paused item back to waiting, at its place in the queue
+ */
+void
+dlqueue_resume(struct DlQueue *queue, struct DlQueueItem *item)
+{
+	if(item->state != DLQUEUE_PAUSED) return;
+
+	item->state = DLQUEUE_WAITING;
+
+	dlqueue_schedule(queue);
+}
+
+/* dlqueue_serialize: Lines of the items in queue order, "paused" or "waiting",
+ * a tab and the URI, active items being waiting ones once restored.
+ */
+gchar *
+dlqueue_serialize(struct DlQueue *queue)
+{
+	GString *contents = g_string_new(NULL);
+
+	for(GList *l = queue->items.head; l != NULL; l = l->next)
+	{
+		struct DlQueueItem *item = l->data;
+
+		// URIs can't contain tabs nor newlines, nothing to escape
+		if(strpbrk(item->uri, "\t\n") != NULL) continue;
+
+		g_string_append_printf(contents,
+		                       "%s\t%s\n",
+		                       item->state == DLQUEUE_PAUSED ? "paused" : "waiting",
+		                       item->uri);
+	}
+
+	return g_string_free(contents, FALSE);
+}
+
+/* dlqueue_parse: Reverse of dlqueue_serialize(), gives struct DlQueueItem without data,
+ * invalid lines being skipped
+ */
+GPtrArray *
+dlqueue_parse(const gchar *contents)
+{
+	GPtrArray *items = g_ptr_array_new_with_free_func((GDestroyNotify)dlqueue_item_free);
+	gchar **lines    = g_strsplit(contents, "\n", -1);
+
+	for(gchar **line = lines; *line != NULL; line++)
+	{
+		const gchar *uri = strchr(*line, '\t');
+		enum dlqueue_state state;
+
+		if(uri == NULL || uri[1] == '\0') continue;
+
+		if(strncmp(*line, "paused\t", 7) == 0)
+			state = DLQUEUE_PAUSED;
+		else if(strncmp(*line, "waiting\t", 8) == 0)
+			state = DLQUEUE_WAITING;
+		else
+			continue;
+
+		g_ptr_array_add(items, dlqueue_item_new(uri + 1, state, NULL));
+	}
+
+	g_strfreev(lines);
+
+	return items;
+}
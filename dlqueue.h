@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DLQUEUE_H_INCLUDED
+#define DLQUEUE_H_INCLUDED
+#include <glib.h>
+
+enum dlqueue_state
+{
+	DLQUEUE_WAITING,
+	DLQUEUE_ACTIVE,
+	DLQUEUE_PAUSED,
+};
+
+struct DlQueueItem
+{
+	gchar *uri;
+	gchar *host; /* empty when the URI has none */
+	enum dlqueue_state state;
+	gpointer data;
+};
+
+struct DlQueue;
+typedef void (*DlQueueStartFunc)(struct DlQueue *queue, struct DlQueueItem *item, gpointer user_data);
+
+/* struct DlQueue: Downloads scheduler, waiting items get started in queue order
+ * as long as there is less than max_active active items, and less than max_per_host
+ * for their host, see dlqueue_schedule().
+ */
+struct DlQueue
+{
+	guint max_active;
+	guint max_per_host;
+	DlQueueStartFunc start;
+	gpointer user_data;
+
+	guint active;
+	GHashTable *hosts; /* host → active items (as pointer) */
+	GQueue items;      /* struct DlQueueItem, in queue order */
+};
+
+struct DlQueue *
+dlqueue_new(guint max_active, guint max_per_host, DlQueueStartFunc start, gpointer user_data);
+void dlqueue_free(struct DlQueue *queue);
+void dlqueue_item_free(struct DlQueueItem *item);
+void dlqueue_schedule(struct DlQueue *queue);
+struct DlQueueItem *
+dlqueue_push(struct DlQueue *queue, const gchar *uri, gboolean paused, gpointer data);
+void dlqueue_remove(struct DlQueue *queue, struct DlQueueItem *item);
+void dlqueue_bump(struct DlQueue *queue, struct DlQueueItem *item);
+enum dlqueue_state dlqueue_pause(struct DlQueue *queue, struct DlQueueItem *item);
+void dlqueue_resume(struct DlQueue *queue, struct DlQueueItem *item);
+gchar *dlqueue_serialize(struct DlQueue *queue);
+GPtrArray *dlqueue_parse(const gchar *contents);
+#endif /* DLQUEUE_H_INCLUDED */
@@ -0,0 +1,117 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "dlqueue.h"
+
+#include <glib.h>
+
+static void
+started_append(struct DlQueue *queue, struct DlQueueItem *item, gpointer user_data)
+{
+	GString *started = user_data;
+
+	(void)queue;
+
+	g_string_append_printf(started, "%s ", (const gchar *)item->data);
+}
+
+static void
+dlqueue_schedule_test(void)
+{
+	GString *started      = g_string_new(NULL);
+	struct DlQueue *queue = dlqueue_new(3, 2, started_append, started);
+	struct DlQueueItem *a1, *a2, *a3, *b1, *c1, *c2;
+
+	a1 = dlqueue_push(queue, "https://a.example/1", FALSE, "a1");
+	a2 = dlqueue_push(queue, "https://a.example/2", FALSE, "a2");
+	a3 = dlqueue_push(queue, "https://a.example/3", FALSE, "a3");
+	b1 = dlqueue_push(queue, "https://b.example/1", FALSE, "b1");
+	c1 = dlqueue_push(queue, "https://c.example/1", FALSE, "c1");
+	c2 = dlqueue_push(queue, "https://c.example/2", FALSE, "c2");
+
+	// Per-host limit skips a3, global limit stops before c1
+	g_assert_cmpstr(started->str, ==, "a1 a2 b1 ");
+	g_assert_cmpuint(queue->active, ==, 3);
+	g_assert_cmpint(a3->state, ==, DLQUEUE_WAITING);
+
+	// Bumped item goes first, FIFO otherwise
+	dlqueue_bump(queue, c2);
+	dlqueue_remove(queue, b1);
+	g_assert_cmpstr(started->str, ==, "a1 a2 b1 c2 ");
+
+	// Pausing an active item frees its slot
+	g_assert_cmpint(dlqueue_pause(queue, a1), ==, DLQUEUE_ACTIVE);
+	g_assert_cmpstr(started->str, ==, "a1 a2 b1 c2 a3 ");
+
+	// Paused items aren't started and resume at their place in the queue
+	g_assert_cmpint(dlqueue_pause(queue, c1), ==, DLQUEUE_WAITING);
+	dlqueue_remove(queue, a2);
+	g_assert_cmpstr(started->str, ==, "a1 a2 b1 c2 a3 ");
+	dlqueue_resume(queue, a1);
+	g_assert_cmpstr(started->str, ==, "a1 a2 b1 c2 a3 a1 ");
+	g_assert_cmpuint(queue->active, ==, 3);
+
+	dlqueue_remove(queue, a1);
+	dlqueue_remove(queue, a3);
+	dlqueue_remove(queue, c2);
+	g_assert_cmpuint(queue->active, ==, 0);
+	g_assert_cmpuint(g_hash_table_size(queue->hosts), ==, 0);
+
+	dlqueue_resume(queue, c1);
+	g_assert_cmpstr(started->str, ==, "a1 a2 b1 c2 a3 a1 c1 ");
+
+	dlqueue_free(queue);
+	g_string_free(started, TRUE);
+}
+
+static void
+dlqueue_serialize_test(void)
+{
+	GString *started      = g_string_new(NULL);
+	struct DlQueue *queue = dlqueue_new(1, 1, started_append, started);
+	GPtrArray *items;
+	gchar *contents;
+
+	dlqueue_push(queue, "https://a.example/1", FALSE, "a1");
+	dlqueue_push(queue, "https://a.example/2", FALSE, "a2");
+	dlqueue_push(queue, "https://b.example/1", TRUE, "b1");
+	dlqueue_push(queue, "https://b.example/2\tinvalid", FALSE, "b2");
+
+	contents = dlqueue_serialize(queue);
+	g_assert_cmpstr(contents,
+	                ==,
+	                "waiting\thttps://a.example/1\n"
+	                "waiting\thttps://a.example/2\n"
+	                "paused\thttps://b.example/1\n");
+
+	items = dlqueue_parse(contents);
+	g_assert_cmpuint(items->len, ==, 3);
+	g_assert_cmpstr(((struct DlQueueItem *)g_ptr_array_index(items, 1))->uri,
+	                ==,
+	                "https://a.example/2");
+	g_assert_cmpstr(((struct DlQueueItem *)g_ptr_array_index(items, 2))->host, ==, "b.example");
+	g_assert_cmpint(
+	    ((struct DlQueueItem *)g_ptr_array_index(items, 2))->state, ==, DLQUEUE_PAUSED);
+	g_ptr_array_free(items, TRUE);
+
+	items = dlqueue_parse("garbage\nwaiting\t\npaused\tabout:blank");
+	g_assert_cmpuint(items->len, ==, 1);
+	g_assert_cmpstr(((struct DlQueueItem *)g_ptr_array_index(items, 0))->host, ==, "");
+	g_ptr_array_free(items, TRUE);
+
+	g_free(contents);
+	dlqueue_free(queue);
+	g_string_free(started, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/dlqueue_schedule/test", dlqueue_schedule_test);
+	g_test_add_func("/dlqueue_serialize/test", dlqueue_serialize_test);
+
+	return g_test_run();
+}
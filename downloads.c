@@ -6,15 +6,269 @@
 
 #include "badwolf.h"
 #include "config.h"
+#include "contexts.h"
+#include "dlindex.h"
+#include "session.h"
+#include "trace.h"
 
-#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <assert.h>
+#include <errno.h>
+#include <glib/gi18n.h>  /* _() and other internationalization/localization helpers */
+#include <fcntl.h>       /* O_CREAT, O_EXCL */
+#include <glib/gstdio.h> /* g_mkdir_with_parents(), g_open(), g_unlink() */
+#include <stdio.h>       /* fprintf() */
+#include <stdlib.h>      /* malloc() */
+#include <string.h>      /* strrchr(), strlen(), strspn() */
+#include <unistd.h>      /* close() */
+
+static GQueue finished_rows        = G_QUEUE_INIT; /* finished downloads rows, oldest first */
+static GtkWidget *history_list     = NULL;
+static struct DlQueue *queue       = NULL;
+static struct Download *restarting = NULL; /* see download_restart() */
+static gchar *queue_path           = NULL; /* NULL when the queue isn't saved */
+
+static void download_finish(struct Download *download);
+static void download_attach(struct Download *download, WebKitDownload *webkit_download);
+static void download_decide_destination(struct Download *download, const gchar *suggested_filename);
+
+/* download_queue_save: Saves the queue next to the session journal, so it survives restarts
+ */
+static void
+download_queue_save(void)
+{
+	gchar *contents;
+	GError *err = NULL;
+
+	if(queue_path == NULL) return;
+
+	contents = dlqueue_serialize(queue);
+
+	if(!g_file_set_contents(queue_path, contents, -1, &err))
+	{
+		fprintf(stderr, _("badwolf: Failed to save the downloads queue: %s\n"), err->message);
+		g_error_free(err);
+	}
+
+	g_free(contents);
+}
 
 static void
 download_stop_iconCb_clicked(GtkButton *UNUSED(stop_icon), gpointer user_data)
 {
-	WebKitDownload *webkit_download = (WebKitDownload *)user_data;
+	struct Download *download = (struct Download *)user_data;
+
+	if(download->webkit_download != NULL)
+	{
+		webkit_download_cancel(download->webkit_download);
+		return;
+	}
+
+	// Paused, nothing to cancel in WebKit
+	download->failed    = TRUE;
+	download->cancelled = TRUE;
+	gtk_label_set_text(GTK_LABEL(download->status), _("Download cancelled"));
+	download_finish(download);
+}
+
+/* download_detach: Stops following webkit_download, which is dropped
+ */
+static void
+download_detach(struct Download *download)
+{
+	if(download->update_source != 0) g_source_remove(download->update_source);
+	download->update_source = 0;
+
+	g_signal_handlers_disconnect_by_data(download->webkit_download, download);
+	g_clear_object(&download->webkit_download);
+}
+
+static void
+download_pause_icon_set(struct Download *download, gboolean paused)
+{
+	gtk_button_set_image(GTK_BUTTON(download->pause_icon),
+	                     gtk_image_new_from_icon_name(paused ? "media-playback-start-symbolic"
+	                                                         : "media-playback-pause-symbolic",
+	                                                  GTK_ICON_SIZE_SMALL_TOOLBAR));
+	gtk_widget_set_tooltip_text(download->pause_icon, paused ? _("Resume") : _("Pause"));
+}
+
+/* download_pause_iconCb_clicked: Pauses or resumes the download.
+ * WebKit can't suspend a transfer, so active downloads get cancelled and restart from the
+ * beginning once resumed. Downloads waiting for their turn are simply kept waiting.
+ */
+static void
+download_pause_iconCb_clicked(GtkButton *UNUSED(pause_icon), gpointer user_data)
+{
+	struct Download *download = (struct Download *)user_data;
+
+	if(download->item->state == DLQUEUE_PAUSED)
+	{
+		download_pause_icon_set(download, FALSE);
+		gtk_label_set_text(GTK_LABEL(download->status), _("Queued"));
+		dlqueue_resume(queue, download->item);
+	}
+	else
+	{
+		WebKitDownload *webkit_download = download->webkit_download;
+
+		download_pause_icon_set(download, TRUE);
+		gtk_label_set_text(GTK_LABEL(download->status), _("Paused"));
+
+		if(dlqueue_pause(queue, download->item) == DLQUEUE_ACTIVE && webkit_download != NULL &&
+		   download->suggested_filename == NULL)
+		{
+			const gchar *placeholder =
+			    g_object_get_data(G_OBJECT(webkit_download), "badwolf-placeholder");
+
+			g_object_ref(webkit_download);
+			if(placeholder != NULL) g_unlink(placeholder);
+			download_detach(download);
+			webkit_download_cancel(webkit_download);
+			g_object_unref(webkit_download);
+
+			gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(download->progress), 0);
+			gtk_image_set_from_icon_name(
+			    GTK_IMAGE(download->icon), "network-idle-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
+		}
+	}
+
+	download_queue_save();
+}
+
+static void
+download_bump_iconCb_clicked(GtkButton *UNUSED(bump_icon), gpointer user_data)
+{
+	struct Download *download = (struct Download *)user_data;
+
+	dlqueue_bump(queue, download->item);
+	download_queue_save();
+}
+
+/* download_restart: Downloads the URI again, attached back to download by
+ * web_contextCb_download_started() which gets called from webkit_web_context_download_uri(),
+ * so each restart gets its own WebKitDownload even when several share an URI
+ */
+static void
+download_restart(struct Download *download)
+{
+	WebKitDownload *webkit_download;
+
+	restarting      = download;
+	webkit_download = webkit_web_context_download_uri(download->web_context, download->item->uri);
+	restarting      = NULL;
+
+	// In case download-started didn't get emitted yet, it then gets ignored
+	if(download->webkit_download == NULL) download_attach(download, webkit_download);
+
+	g_object_unref(webkit_download);
+}
+
+/* download_queueCb_start: The download got its turn, see struct DlQueue
+ */
+static void
+download_queueCb_start(struct DlQueue *UNUSED(queue),
+                       struct DlQueueItem *item,
+                       gpointer UNUSED(user_data))
+{
+	struct Download *download = (struct Download *)item->data;
+
+	TRACE_BEGIN(__func__);
+
+	// Can be called from dlqueue_push(), before it returned the item
+	download->item = item;
+
+	gtk_label_set_text(GTK_LABEL(download->status), _("Download starting…"));
+
+	if(download->webkit_download == NULL)
+		download_restart(download);
+	else if(download->suggested_filename != NULL)
+	{
+		gchar *suggested_filename = download->suggested_filename;
+
+		download->suggested_filename = NULL;
+		download_decide_destination(download, suggested_filename);
+		g_free(suggested_filename);
+	}
+	// Otherwise decide-destination didn't happen yet and won't be held
+
+	TRACE_END(__func__);
+}
+
+static void
+finished_rowCb_destroy(GtkWidget *row, gpointer UNUSED(user_data))
+{
+	g_queue_remove(&finished_rows, row);
+}
+
+static void
+download_clear_iconCb_clicked(GtkButton *UNUSED(clear_icon), gpointer user_data)
+{
+	gtk_widget_destroy(GTK_WIDGET(user_data));
+}
+
+/* download_row_finished: Lets the row of download be removed, the oldest finished rows
+ * getting removed past BADWOLF_DOWNLOADS_FINISHED_ROWS as they're kept in the downloads index
+ */
+static void
+download_row_finished(struct Download *download)
+{
+	GtkWidget *row        = gtk_widget_get_parent(download->container);
+	GtkWidget *clear_icon =
+	    gtk_button_new_from_icon_name("edit-clear-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
+
+	gtk_widget_destroy(download->stop_icon);
+	gtk_widget_destroy(download->pause_icon);
+	gtk_widget_destroy(download->bump_icon);
+
+	gtk_widget_set_tooltip_text(clear_icon, _("Remove from the list"));
+	g_signal_connect(clear_icon, "clicked", G_CALLBACK(download_clear_iconCb_clicked), row);
+	gtk_box_pack_start(GTK_BOX(download->container), clear_icon, FALSE, FALSE, 0);
+	gtk_box_reorder_child(GTK_BOX(download->container), clear_icon, 2);
+	gtk_widget_show(clear_icon);
+
+	g_queue_push_tail(&finished_rows, row);
+	g_signal_connect(row, "destroy", G_CALLBACK(finished_rowCb_destroy), NULL);
+
+	while(g_queue_get_length(&finished_rows) > BADWOLF_DOWNLOADS_FINISHED_ROWS)
+		gtk_widget_destroy(g_queue_peek_head(&finished_rows));
+}
+
+static gchar *
+downloads_index_path(void)
+{
+	return g_build_filename(g_get_user_data_dir(), "badwolf", "downloads.index", NULL);
+}
+
+static void
+download_index_append(struct Download *download)
+{
+	WebKitDownload *webkit_download = download->webkit_download;
+	struct DownloadRecord record    = {0, NULL, 0, 0, download->item->uri, NULL};
+	gchar *path = downloads_index_path();
+	gchar *dir  = g_path_get_dirname(path);
+	GError *err = NULL;
+
+	record.time   = g_get_real_time() / G_USEC_PER_SEC;
+	record.status = download->cancelled ? "cancelled" : download->failed ? "failed" : "finished";
+
+	// Cancelled while paused otherwise
+	if(webkit_download != NULL)
+	{
+		record.size        = webkit_download_get_received_data_length(webkit_download);
+		record.duration    = webkit_download_get_elapsed_time(webkit_download);
+		record.destination = (gchar *)webkit_download_get_destination(webkit_download);
+	}
+
+	if(g_mkdir_with_parents(dir, 0700) != 0 || !dlindex_append(path, &record, &err))
+	{
+		fprintf(stderr,
+		        _("badwolf: Failed to add the download to the index: %s\n"),
+		        err != NULL ? err->message : g_strerror(errno));
+		g_clear_error(&err);
+	}
 
-	webkit_download_cancel(webkit_download);
+	g_free(dir);
+	g_free(path);
 }
 
 void
@@ -33,26 +287,36 @@ download_format_elapsed(char *restrict formatted,
 }
 
 void
-download_new_entry(WebKitDownload *webkit_download, struct Download *download)
+download_new_entry(struct Download *download)
 {
-	download->error     = 0;
 	download->container = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, BADWOLF_DOWNLOAD_PADDING);
 	download->progress  = gtk_progress_bar_new();
 	download->file_path = gtk_label_new(NULL);
-	download->status    = gtk_label_new(_("Download starting…"));
+	download->status    = gtk_label_new(_("Queued"));
 	download->icon =
 	    gtk_image_new_from_icon_name("network-idle-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
 	download->stop_icon = gtk_button_new_from_icon_name("process-stop", GTK_ICON_SIZE_SMALL_TOOLBAR);
+	download->pause_icon = gtk_button_new();
+	download->bump_icon =
+	    gtk_button_new_from_icon_name("go-top-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
 
 	gtk_progress_bar_set_show_text(GTK_PROGRESS_BAR(download->progress), TRUE);
 	gtk_label_set_ellipsize(GTK_LABEL(download->file_path), BADWOLF_DOWNLOAD_FILE_PATH_ELLIPSIZE);
+	download_pause_icon_set(download, FALSE);
+	gtk_widget_set_tooltip_text(download->bump_icon, _("Start next"));
 
 	g_signal_connect(
-	    download->stop_icon, "clicked", G_CALLBACK(download_stop_iconCb_clicked), webkit_download);
+	    download->stop_icon, "clicked", G_CALLBACK(download_stop_iconCb_clicked), download);
+	g_signal_connect(
+	    download->pause_icon, "clicked", G_CALLBACK(download_pause_iconCb_clicked), download);
+	g_signal_connect(
+	    download->bump_icon, "clicked", G_CALLBACK(download_bump_iconCb_clicked), download);
 
 	gtk_box_pack_start(GTK_BOX(download->container), download->icon, FALSE, FALSE, 0);
 	gtk_box_pack_start(GTK_BOX(download->container), download->progress, FALSE, FALSE, 0);
 	gtk_box_pack_start(GTK_BOX(download->container), download->stop_icon, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(download->container), download->pause_icon, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(download->container), download->bump_icon, FALSE, FALSE, 0);
 	gtk_box_pack_start(GTK_BOX(download->container), download->status, FALSE, FALSE, 0);
 	gtk_box_pack_start(GTK_BOX(download->container), download->file_path, FALSE, FALSE, 0);
 
@@ -66,43 +330,234 @@ downloadCb_created_destination(WebKitDownload *UNUSED(webkit_download),
                                gchar *destination,
                                gpointer user_data)
 {
-	char *markup;
 	struct Download *download = (struct Download *)user_data;
+	gchar *display            = webkit_uri_for_display(destination);
+	char *markup;
+
+	TRACE_BEGIN(__func__);
 
-	markup = g_markup_printf_escaped(
-	    "<a href=\"%s\">%s</a>", destination, webkit_uri_for_display(destination));
+	markup = g_markup_printf_escaped("<a href=\"%s\">%s</a>", destination, display);
 
 	gtk_label_set_markup(GTK_LABEL(download->file_path), markup);
 	g_free(markup);
+	g_free(display);
+
+	TRACE_END(__func__);
 }
 
-gboolean
-downloadCb_decide_destination(WebKitDownload *webkit_download,
-                              gchar *suggested_filename,
-                              gpointer user_data)
+/* download_directory: Directory downloads are saved into, see BADWOLF_DOWNLOAD_DIR in badwolf(1)
+ */
+static const gchar *
+download_directory(void)
+{
+	const gchar *dir = g_getenv("BADWOLF_DOWNLOAD_DIR");
+
+	if(dir != NULL && *dir != '\0') return dir;
+
+	dir = g_get_user_special_dir(G_USER_DIRECTORY_DOWNLOAD);
+	if(dir != NULL) return dir;
+
+	return g_get_home_dir();
+}
+
+/* download_path_new: Creates an empty file for filename in dir, adding " (n)" before
+ * the extension until it gets a name not already taken, returns its path or NULL
+ */
+static gchar *
+download_path_new(const gchar *dir, const gchar *filename, GError **error)
 {
-	struct Client *browser = (struct Client *)user_data;
-	gint chooser_response;
-	GtkWindow *parent_window = GTK_WINDOW(browser->window->main_window);
+	gchar *name      = g_path_get_basename(filename);
+	const gchar *ext = strrchr(name, '.');
+	gchar *path      = NULL;
+	int saved_errno  = 0;
+	gsize base_len;
+
+	// Neither hidden files nor names like ".." or "/" pointing outside of dir
+	if(name[0] == '.' || name[0] == G_DIR_SEPARATOR)
+	{
+		gboolean dots = strspn(name, "./") == strlen(name);
+		gchar *safe   = g_strconcat("download", dots ? "" : name, NULL);
+
+		g_free(name);
+		name = safe;
+		ext  = strrchr(name, '.');
+	}
+
+	if(ext == NULL) ext = name + strlen(name);
+	// Keep compressed tarballs extension whole: "foo (1).tar.gz"
+	else if(ext - name > 4 && g_ascii_strncasecmp(ext - 4, ".tar", 4) == 0)
+		ext -= 4;
 
+	base_len = (gsize)(ext - name);
+
+	for(guint n = 0; n <= BADWOLF_DOWNLOAD_MAX_RENAMES; n++)
+	{
+		int fd;
+
+		if(n == 0)
+			path = g_build_filename(dir, name, NULL);
+		else
+		{
+			gchar *renamed = g_strdup_printf("%.*s (%u)%s", (int)base_len, name, n, ext);
+			path           = g_build_filename(dir, renamed, NULL);
+			g_free(renamed);
+		}
+
+		// Exclusive creation, so concurrent downloads can't pick the same name
+		fd = g_open(path, O_WRONLY | O_CREAT | O_EXCL, 0644); // flawfinder: ignore
+		if(fd >= 0)
+		{
+			close(fd);
+			g_free(name);
+			return path;
+		}
+
+		saved_errno = errno;
+		if(saved_errno != EEXIST) break;
+
+		g_free(path);
+		path = NULL;
+	}
+
+	g_set_error(error,
+	            G_FILE_ERROR,
+	            g_file_error_from_errno(saved_errno),
+	            "%s: %s",
+	            path != NULL ? path : name,
+	            g_strerror(saved_errno));
+	g_free(path);
+	g_free(name);
+
+	return NULL;
+}
+
+/* download_set_destination: Saves the download into dir, without asking
+ */
+static void
+download_set_destination(WebKitDownload *webkit_download,
+                         const gchar *dir,
+                         const gchar *suggested_filename)
+{
+	GError *err = NULL;
+	gchar *path = download_path_new(dir, suggested_filename, &err);
+	gchar *uri;
+
+	if(path == NULL)
+	{
+		fprintf(stderr, _("badwolf: Failed to create the download file: %s\n"), err->message);
+		g_error_free(err);
+		webkit_download_cancel(webkit_download);
+		return;
+	}
+
+	// Replaces the empty file reserving the name, removed by downloadCb_failed
+	webkit_download_set_allow_overwrite(webkit_download, TRUE);
+	g_object_set_data_full(G_OBJECT(webkit_download), "badwolf-placeholder", g_strdup(path), g_free);
+
+	uri = g_filename_to_uri(path, NULL, NULL);
+	webkit_download_set_destination(webkit_download, uri);
+
+	g_free(uri);
+	g_free(path);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+static void
+file_dialogCb_response(GtkNativeDialog *file_dialog, gint response_id, gpointer user_data)
+{
+	WebKitDownload *webkit_download = (WebKitDownload *)user_data;
+
+	TRACE_BEGIN(__func__);
+
+	if(response_id == GTK_RESPONSE_ACCEPT)
+	{
+		gchar *uri = gtk_file_chooser_get_uri(GTK_FILE_CHOOSER(file_dialog));
+
+		webkit_download_set_destination(webkit_download, uri);
+		g_free(uri);
+	}
+	else
+		webkit_download_cancel(webkit_download);
+
+	g_object_unref(file_dialog);
+	g_object_unref(webkit_download);
+
+	TRACE_END(__func__);
+}
+
+/* download_ask_destination: Non-modal file chooser, WebKit holds the download
+ * until webkit_download_set_destination() or webkit_download_cancel() gets called
+ */
+static void
+download_ask_destination(WebKitDownload *webkit_download,
+                         const gchar *dir,
+                         const gchar *suggested_filename,
+                         GtkWindow *parent_window)
+{
 	GtkFileChooserNative *file_dialog =
 	    gtk_file_chooser_native_new(NULL, parent_window, GTK_FILE_CHOOSER_ACTION_SAVE, NULL, NULL);
 	GtkFileChooser *file_chooser = GTK_FILE_CHOOSER(file_dialog);
 
+	gtk_native_dialog_set_modal(GTK_NATIVE_DIALOG(file_dialog), FALSE);
+	gtk_file_chooser_set_current_folder(file_chooser, dir);
 	gtk_file_chooser_set_current_name(file_chooser, suggested_filename);
 	gtk_file_chooser_set_do_overwrite_confirmation(file_chooser, TRUE);
 	webkit_download_set_allow_overwrite(webkit_download, TRUE);
 
-	chooser_response = gtk_native_dialog_run(GTK_NATIVE_DIALOG(file_dialog));
+	g_signal_connect(
+	    file_dialog, "response", G_CALLBACK(file_dialogCb_response), g_object_ref(webkit_download));
+	gtk_native_dialog_show(GTK_NATIVE_DIALOG(file_dialog));
+}
+#endif
 
-	if(chooser_response == GTK_RESPONSE_ACCEPT)
-		webkit_download_set_destination(webkit_download, gtk_file_chooser_get_uri(file_chooser));
-	else
-		webkit_download_cancel(webkit_download);
+/* download_decide_destination: Asks for the destination or saves into the download directory
+ */
+static void
+download_decide_destination(struct Download *download, const gchar *suggested_filename)
+{
+	const gchar *dir = download_directory();
 
-	g_object_unref(file_dialog);
+	if(g_mkdir_with_parents(dir, 0755) != 0)
+		fprintf(stderr, _("badwolf: Failed to create %s: %s\n"), dir, g_strerror(errno));
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+	if(BADWOLF_DOWNLOAD_ASK)
+	{
+		download_ask_destination(download->webkit_download,
+		                         dir,
+		                         suggested_filename,
+		                         GTK_WINDOW(download->window->main_window));
+		return;
+	}
+#endif
+
+	download_set_destination(download->webkit_download, dir, suggested_filename);
+}
+
+gboolean
+downloadCb_decide_destination(WebKitDownload *UNUSED(webkit_download),
+                              gchar *suggested_filename,
+                              gpointer user_data)
+{
+	struct Download *download = (struct Download *)user_data;
+
+	TRACE_BEGIN(__func__);
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+	// Held by WebKit until it gets its turn, see download_queueCb_start()
+	if(download->item->state != DLQUEUE_ACTIVE)
+	{
+		download->suggested_filename = g_strdup(suggested_filename);
+
+		TRACE_END(__func__);
+		return TRUE;
+	}
+#endif
+
+	download_decide_destination(download, suggested_filename);
 
-	return FALSE; /* Let it propagate */
+	TRACE_END(__func__);
+	return TRUE;
 }
 
 void
@@ -113,11 +568,20 @@ downloadCb_failed(WebKitDownload *webkit_download, GError *error, gpointer user_
 	char formatted[BUFSIZ];
 	int total = (int)webkit_download_get_elapsed_time(webkit_download);
 	char *format;
+	const gchar *placeholder;
+
+	TRACE_BEGIN(__func__);
+
+	download->failed = TRUE;
 
-	download->error = error;
+	placeholder = g_object_get_data(G_OBJECT(webkit_download), "badwolf-placeholder");
+	if(placeholder != NULL) g_unlink(placeholder);
 
 	if(g_error_matches(error, WEBKIT_DOWNLOAD_ERROR, WEBKIT_DOWNLOAD_ERROR_CANCELLED_BY_USER))
-		format = _("%02i:%02i:%02i Download cancelled");
+	{
+		download->cancelled = TRUE;
+		format              = _("%02i:%02i:%02i Download cancelled");
+	}
 	else
 		format = _("%02i:%02i:%02i Download error");
 
@@ -127,8 +591,32 @@ downloadCb_failed(WebKitDownload *webkit_download, GError *error, gpointer user_
 
 	gtk_image_set_from_icon_name(
 	    GTK_IMAGE(download->icon), "network-error-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
+
+	TRACE_END(__func__);
 }
 
+/* download_finish: Takes download out of the queue and frees it,
+ * the row stays in the downloads tab, on its own
+ */
+static void
+download_finish(struct Download *download)
+{
+	// TODO: Send notification
+
+	if(BADWOLF_DOWNLOADS_INDEX) download_index_append(download);
+
+	download_row_finished(download);
+	dlqueue_remove(queue, download->item);
+	download_queue_save();
+
+	if(download->webkit_download != NULL) download_detach(download);
+	if(download->web_context != NULL) g_object_unref(download->web_context);
+	g_free(download->suggested_filename);
+	free(download);
+}
+
+/* downloadCb_finished: Emitted last, after downloadCb_failed() when it failed
+ */
 void
 downloadCb_finished(WebKitDownload *webkit_download, gpointer user_data)
 {
@@ -137,47 +625,279 @@ downloadCb_finished(WebKitDownload *webkit_download, gpointer user_data)
 	char formatted[BUFSIZ];
 	int total = (int)webkit_download_get_elapsed_time(webkit_download);
 
-	gchar *format_size = g_format_size(webkit_download_get_received_data_length(webkit_download));
+	TRACE_BEGIN(__func__);
 
-	download_format_elapsed(
-	    formatted, sizeof(formatted), _("%02i:%02i:%02i Download finished"), total);
+	if(!download->failed)
+	{
+		gchar *format_size = g_format_size(webkit_download_get_received_data_length(webkit_download));
 
-	gtk_widget_destroy(download->stop_icon);
+		download_format_elapsed(
+		    formatted, sizeof(formatted), _("%02i:%02i:%02i Download finished"), total);
 
-	if(download->error == 0)
-	{
 		gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(download->progress), 1);
 		gtk_progress_bar_set_text(GTK_PROGRESS_BAR(download->progress), format_size);
 		gtk_label_set_text(GTK_LABEL(download->status), formatted);
 		gtk_image_set_from_icon_name(
 		    GTK_IMAGE(download->icon), "network-idle-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
+
+		g_free(format_size);
 	}
 
-	// TODO: Send notification
+	download_finish(download);
+
+	TRACE_END(__func__);
 }
 
 void
-downloadCb_received_data(WebKitDownload *webkit_download,
+downloadCb_received_data(WebKitDownload *UNUSED(webkit_download),
                          guint64 UNUSED(data_lenght),
                          gpointer user_data)
 {
 	struct Download *download = (struct Download *)user_data;
+
+	TRACE_INSTANT(__func__);
+
+	// Only shown by downloadCb_update(), chunks can come thousands of times per second
+	download->receiving = TRUE;
+}
+
+/* downloadCb_update: Shows the progress of a download, with its throughput being smoothed
+ * by an exponentially weighted moving average to get a stable estimate of the time left
+ */
+static gboolean
+downloadCb_update(gpointer user_data)
+{
+	struct Download *download       = (struct Download *)user_data;
+	WebKitDownload *webkit_download = download->webkit_download;
+	WebKitURIResponse *response     = webkit_download_get_response(webkit_download);
+	guint64 received                = webkit_download_get_received_data_length(webkit_download);
+	guint64 expected                = 0;
+	gint64 now                      = g_get_monotonic_time();
+	gdouble rate;
 	/* flawfinder: ignore. proper buffer limits are used */
 	char formatted[BUFSIZ];
-	int total = (int)webkit_download_get_elapsed_time(webkit_download);
+	GString *status;
+	gchar *format_size;
 
-	gchar *format_size = g_format_size(webkit_download_get_received_data_length(webkit_download));
+	if(!download->receiving) return G_SOURCE_CONTINUE;
 
-	download_format_elapsed(formatted, sizeof(formatted), _("%02i:%02i:%02i Downloading…"), total);
+	TRACE_BEGIN(__func__);
 
-	gtk_image_set_from_icon_name(
-	    GTK_IMAGE(download->icon), "network-receive-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
-	gtk_label_set_text(GTK_LABEL(download->status), formatted);
+	if(response != NULL) expected = webkit_uri_response_get_content_length(response);
+
+	if(download->updated != 0 && now > download->updated)
+	{
+		rate = (gdouble)(received - download->received) * G_USEC_PER_SEC /
+		       (gdouble)(now - download->updated);
+
+		if(download->rate == 0)
+			download->rate = rate;
+		else
+			download->rate = BADWOLF_DOWNLOAD_RATE_SMOOTHING * rate +
+			                 (1 - BADWOLF_DOWNLOAD_RATE_SMOOTHING) * download->rate;
+	}
+	else
+	{
+		// First update, the throughput being only known from the next one
+		gtk_image_set_from_icon_name(
+		    GTK_IMAGE(download->icon), "network-receive-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
+	}
+
+	download->received = received;
+	download->updated  = now;
+
+	download_format_elapsed(formatted,
+	                        sizeof(formatted),
+	                        _("%02i:%02i:%02i Downloading…"),
+	                        (int)webkit_download_get_elapsed_time(webkit_download));
+	status = g_string_new(formatted);
+
+	if(download->rate >= 1)
+	{
+		gchar *format_rate = g_format_size((guint64)download->rate);
+
+		g_string_append_c(status, ' ');
+		g_string_append_printf(status, _("%s/s"), format_rate);
+		g_free(format_rate);
+
+		if(expected > received)
+		{
+			download_format_elapsed(formatted,
+			                        sizeof(formatted),
+			                        _(", %02i:%02i:%02i left"),
+			                        (int)((gdouble)(expected - received) / download->rate));
+			g_string_append(status, formatted);
+		}
+	}
+
+	format_size = g_format_size(received);
+
+	gtk_label_set_text(GTK_LABEL(download->status), status->str);
 	gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(download->progress),
 	                              webkit_download_get_estimated_progress(webkit_download));
 	gtk_progress_bar_set_text(GTK_PROGRESS_BAR(download->progress), format_size);
 
 	g_free(format_size);
+	g_string_free(status, TRUE);
+
+	TRACE_END(__func__);
+	return G_SOURCE_CONTINUE;
+}
+
+/* download_new: Row of a download of uri, not attached to a WebKitDownload yet
+ */
+static struct Download *
+download_new(struct Window *window, const gchar *uri)
+{
+	struct Download *download = malloc(sizeof(struct Download));
+	gchar *display;
+
+	if(download == NULL) return NULL;
+
+	download->window             = window;
+	download->webkit_download    = NULL;
+	download->web_context        = NULL;
+	download->item               = NULL;
+	download->suggested_filename = NULL;
+	download->failed             = FALSE;
+	download->cancelled          = FALSE;
+	download->update_source      = 0;
+
+	download_new_entry(download);
+
+	display = webkit_uri_for_display(uri);
+	gtk_label_set_text(GTK_LABEL(download->file_path), display != NULL ? display : uri);
+	g_free(display);
+
+	return download;
+}
+
+static void
+download_attach(struct Download *download, WebKitDownload *webkit_download)
+{
+	g_object_set_data(G_OBJECT(webkit_download), "badwolf-download", download);
+
+	download->webkit_download = g_object_ref(webkit_download);
+	download->receiving       = FALSE;
+	download->received        = 0;
+	download->updated         = 0;
+	download->rate            = 0;
+	download->update_source =
+	    g_timeout_add(BADWOLF_DOWNLOAD_UPDATE_INTERVAL, downloadCb_update, download);
+
+	g_signal_connect(
+	    G_OBJECT(webkit_download), "received-data", G_CALLBACK(downloadCb_received_data), download);
+	g_signal_connect(G_OBJECT(webkit_download),
+	                 "created-destination",
+	                 G_CALLBACK(downloadCb_created_destination),
+	                 download);
+	g_signal_connect(G_OBJECT(webkit_download), "failed", G_CALLBACK(downloadCb_failed), download);
+	g_signal_connect(
+	    G_OBJECT(webkit_download), "finished", G_CALLBACK(downloadCb_finished), download);
+	g_signal_connect(G_OBJECT(webkit_download),
+	                 "decide-destination",
+	                 G_CALLBACK(downloadCb_decide_destination),
+	                 download);
+}
+
+void
+web_contextCb_download_started(WebKitWebContext *web_context,
+                               WebKitDownload *webkit_download,
+                               gpointer user_data)
+{
+	struct Window *window = (struct Window *)user_data;
+	struct Download *download;
+	const gchar *uri;
+
+	assert(webkit_download);
+
+	// Restarted by download_restart()
+	if(restarting != NULL)
+	{
+		download_attach(restarting, webkit_download);
+		return;
+	}
+
+	// Already attached by download_restart()
+	if(g_object_get_data(G_OBJECT(webkit_download), "badwolf-download") != NULL) return;
+
+	uri = webkit_uri_request_get_uri(webkit_download_get_request(webkit_download));
+
+	download = download_new(window, uri);
+	if(download == NULL) return;
+
+	download->web_context = g_object_ref(web_context);
+	download_attach(download, webkit_download);
+
+	download->item = dlqueue_push(queue, uri, FALSE, download);
+	download_queue_save();
+}
+
+static void
+main_windowCb_destroy(GtkWidget *UNUSED(widget), gpointer UNUSED(user_data))
+{
+	// Downloads cancelled on exit are kept in the saved queue
+	g_clear_pointer(&queue_path, g_free);
+}
+
+/* badwolf_downloads_restore: Queues back the downloads which weren't finished at the end of
+ * the previous run of the session, see BADWOLF_SESSION in badwolf(1)
+ */
+void
+badwolf_downloads_restore(struct Window *window)
+{
+	const gchar *session_path = badwolf_session_path();
+	WebKitWebContext *web_context;
+	gchar *contents;
+	GPtrArray *items;
+	GError *err = NULL;
+
+	if(session_path == NULL) return;
+
+	queue_path = g_strconcat(session_path, ".downloads", NULL);
+	g_signal_connect(window->main_window, "destroy", G_CALLBACK(main_windowCb_destroy), NULL);
+
+	if(!g_file_get_contents(queue_path, &contents, NULL, &err))
+	{
+		if(!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			fprintf(stderr, _("badwolf: Failed to read the downloads queue: %s\n"), err->message);
+		g_error_free(err);
+		return;
+	}
+
+	items = dlqueue_parse(contents);
+	g_free(contents);
+
+	if(items->len == 0)
+	{
+		g_ptr_array_free(items, TRUE);
+		return;
+	}
+
+	// The contexts of the tabs they came from are gone, cookies and all
+	web_context = badwolf_web_context_new(window);
+
+	for(guint i = 0; i < items->len; i++)
+	{
+		struct DlQueueItem *item  = g_ptr_array_index(items, i);
+		struct Download *download = download_new(window, item->uri);
+
+		if(download == NULL) continue;
+
+		download->web_context = g_object_ref(web_context);
+		if(item->state == DLQUEUE_PAUSED)
+		{
+			download_pause_icon_set(download, TRUE);
+			gtk_label_set_text(GTK_LABEL(download->status), _("Paused"));
+		}
+
+		download->item = dlqueue_push(queue, item->uri, item->state == DLQUEUE_PAUSED, download);
+	}
+
+	fprintf(stderr, _("badwolf: Restored %u queued downloads\n"), items->len);
+
+	g_object_unref(web_context);
+	g_ptr_array_free(items, TRUE);
 }
 
 GtkWidget *
@@ -186,15 +906,103 @@ badwolf_downloads_tab_new()
 	return gtk_list_box_new();
 }
 
+static GtkWidget *
+history_row_new(const struct DownloadRecord *record)
+{
+	GDateTime *date   = g_date_time_new_from_unix_local(record->time);
+	gchar *time       = g_date_time_format(date, "%F %T");
+	gchar *size       = g_format_size(record->size);
+	const gchar *link = record->destination[0] != '\0' ? record->destination : record->uri;
+	gchar *display    = webkit_uri_for_display(link);
+	GtkWidget *label  = gtk_label_new(NULL);
+	gchar *markup;
+
+	markup = g_markup_printf_escaped("%s %s, %s <a href=\"%s\">%s</a>",
+	                                 time,
+	                                 record->status,
+	                                 size,
+	                                 link,
+	                                 display != NULL ? display : link);
+
+	gtk_label_set_markup(GTK_LABEL(label), markup);
+	gtk_label_set_ellipsize(GTK_LABEL(label), BADWOLF_DOWNLOAD_FILE_PATH_ELLIPSIZE);
+	gtk_widget_set_halign(label, GTK_ALIGN_START);
+	gtk_widget_set_tooltip_text(label, record->uri);
+
+	g_free(markup);
+	g_free(display);
+	g_free(size);
+	g_free(time);
+	g_date_time_unref(date);
+
+	return label;
+}
+
+/* downloads_history_search: Lists the latest downloads of the index matching query
+ */
+static void
+downloads_history_search(const gchar *query)
+{
+	gchar *path = downloads_index_path();
+	GError *err = NULL;
+	GPtrArray *records;
+
+	gtk_container_foreach(GTK_CONTAINER(history_list), (GtkCallback)gtk_widget_destroy, NULL);
+
+	records = dlindex_search(path, query, BADWOLF_DOWNLOADS_SEARCH_RESULTS, &err);
+	if(records == NULL)
+	{
+		if(!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			fprintf(stderr, _("badwolf: Failed to search the downloads index: %s\n"), err->message);
+		g_error_free(err);
+		g_free(path);
+		return;
+	}
+
+	for(guint i = 0; i < records->len; i++)
+		gtk_list_box_insert(
+		    GTK_LIST_BOX(history_list), history_row_new(g_ptr_array_index(records, i)), -1);
+
+	gtk_widget_show_all(history_list);
+
+	g_ptr_array_free(records, TRUE);
+	g_free(path);
+}
+
+static void
+history_searchCb_search__changed(GtkSearchEntry *search, gpointer UNUSED(user_data))
+{
+	downloads_history_search(gtk_entry_get_text(GTK_ENTRY(search)));
+}
+
 void
 badwolf_downloads_tab_attach(struct Window *window)
 {
+	GtkWidget *page            = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
+	GtkWidget *search          = gtk_search_entry_new();
+	GtkWidget *lists           = gtk_box_new(GTK_ORIENTATION_VERTICAL, BADWOLF_DOWNLOAD_PADDING);
 	GtkWidget *scrolled_window = gtk_scrolled_window_new(NULL, NULL);
 	gtk_widget_set_name(scrolled_window, "browser__scrollwin_downloads");
-	gtk_container_add(GTK_CONTAINER(scrolled_window), window->downloads_tab);
-	gtk_notebook_insert_page(GTK_NOTEBOOK(window->notebook), scrolled_window, NULL, 0);
 
-	gtk_notebook_set_tab_reorderable(GTK_NOTEBOOK(window->notebook), scrolled_window, TRUE);
+	queue = dlqueue_new(
+	    BADWOLF_DOWNLOADS_MAX_ACTIVE, BADWOLF_DOWNLOADS_MAX_PER_HOST, download_queueCb_start, NULL);
+
+	history_list = gtk_list_box_new();
+	gtk_list_box_set_selection_mode(GTK_LIST_BOX(history_list), GTK_SELECTION_NONE);
+
+	gtk_entry_set_placeholder_text(GTK_ENTRY(search), _("Search previous downloads"));
+	g_signal_connect(search, "search-changed", G_CALLBACK(history_searchCb_search__changed), NULL);
+
+	gtk_box_pack_start(GTK_BOX(lists), window->downloads_tab, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(lists), history_list, FALSE, FALSE, 0);
+	gtk_container_add(GTK_CONTAINER(scrolled_window), lists);
+	if(BADWOLF_DOWNLOADS_INDEX) gtk_box_pack_start(GTK_BOX(page), search, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(page), scrolled_window, TRUE, TRUE, 0);
+	gtk_notebook_insert_page(GTK_NOTEBOOK(window->notebook), page, NULL, 0);
+
+	if(BADWOLF_DOWNLOADS_INDEX) downloads_history_search("");
+
+	gtk_notebook_set_tab_reorderable(GTK_NOTEBOOK(window->notebook), page, TRUE);
 
 	GtkWidget *tab_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
 	gtk_widget_set_name(tab_box, "browser__tabbox");
@@ -218,9 +1026,9 @@ badwolf_downloads_tab_attach(struct Window *window)
 	gtk_box_pack_start(GTK_BOX(tab_box), label, TRUE, TRUE, 0);
 
 	gtk_widget_set_tooltip_text(tab_box, _("Badwolf Downloads"));
-	gtk_notebook_set_tab_label(GTK_NOTEBOOK(window->notebook), scrolled_window, tab_box);
+	gtk_notebook_set_tab_label(GTK_NOTEBOOK(window->notebook), page, tab_box);
 	gtk_notebook_set_menu_label_text(
-	    GTK_NOTEBOOK(window->notebook), scrolled_window, _("Badwolf Downloads"));
+	    GTK_NOTEBOOK(window->notebook), page, _("Badwolf Downloads"));
 
 	gtk_widget_show_all(tab_box);
 }
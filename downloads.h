@@ -2,23 +2,38 @@
 // SPDX-License-Identifier: BSD-3-Clause
 
 #include "badwolf.h"
+#include "dlqueue.h"
 
 #include <gtk/gtk.h>
 
 struct Download
 {
 	struct Window *window;
+	WebKitDownload *webkit_download; /* reference held until it finished, NULL while paused */
+	WebKitWebContext *web_context;   /* where it gets restarted from once resumed */
+	struct DlQueueItem *item;
+	gchar *suggested_filename; /* non-NULL while waiting for its turn in the queue */
 
 	GtkWidget *container;
 	GtkWidget *icon;
 	GtkWidget *stop_icon;
+	GtkWidget *pause_icon;
+	GtkWidget *bump_icon;
 	GtkWidget *file_path;
 	GtkWidget *progress;
 	GtkWidget *status;
-	GError *error;
+	gboolean failed;
+	gboolean cancelled;
+
+	/* Progress, updated every BADWOLF_DOWNLOAD_UPDATE_INTERVAL, see downloadCb_update() */
+	guint update_source;
+	gboolean receiving;
+	guint64 received; /* bytes received up to the previous update */
+	gint64 updated;   /* monotonic time of the previous update */
+	gdouble rate;     /* bytes per second, moving average */
 };
 
-void download_new_entry(WebKitDownload *webkit_download, struct Download *download);
+void download_new_entry(struct Download *download);
 void
 downloadCb_created_destination(WebKitDownload *download, gchar *destination, gpointer user_data);
 gboolean downloadCb_decide_destination(WebKitDownload *download,
@@ -27,5 +42,9 @@ gboolean downloadCb_decide_destination(WebKitDownload *download,
 void downloadCb_failed(WebKitDownload *webkit_download, GError *error, gpointer user_data);
 void downloadCb_finished(WebKitDownload *download, gpointer user_data);
 void downloadCb_received_data(WebKitDownload *download, guint64 data_lenght, gpointer user_data);
+void web_contextCb_download_started(WebKitWebContext *web_context,
+                                    WebKitDownload *download,
+                                    gpointer user_data);
 GtkWidget *badwolf_downloads_tab_new();
 void badwolf_downloads_tab_attach(struct Window *window);
+void badwolf_downloads_restore(struct Window *window);
@@ -0,0 +1,180 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+/* badwolf-filterc: Compiles Adblock Plus filter lists into WebKit content-filter lists
+ */
+
+#include "abp.h"
+
+#include <errno.h>
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <locale.h>     /* setlocale() */
+#include <stdio.h>      /* fopen(), getline(), fprintf() */
+#include <stdlib.h>     /* free(), strtoul() */
+#include <string.h>     /* strerror() */
+#include <unistd.h>     /* getopt() */
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+	        _("Usage: badwolf-filterc [-m max_rules] [-o output.json] [filters.txt ...]\n"));
+}
+
+static gboolean
+compile_file(struct AbpCompiler *compiler, FILE *file, const char *name)
+{
+	char *line  = NULL;
+	size_t size = 0;
+
+	// Streamed, lists being in the order of the megabytes
+	while(getline(&line, &size, file) != -1)
+		abp_compiler_add(compiler, line);
+
+	free(line);
+
+	if(ferror(file))
+	{
+		fprintf(stderr, _("badwolf-filterc: Error reading %s: %s\n"), name, strerror(errno));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* part_path: Path of the n-th list (starting at 0), "list.json" then "list-2.json", …
+ */
+static gchar *
+part_path(const char *output, guint n)
+{
+	const char *ext = g_str_has_suffix(output, ".json") ? ".json" : "";
+	gsize base_len  = strlen(output) - strlen(ext);
+
+	if(n == 0) return g_strdup(output);
+
+	return g_strdup_printf("%.*s-%u%s", (int)base_len, output, n + 1, ext);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct AbpCompiler *compiler;
+	const char *output = NULL;
+	gulong max_rules   = ABP_MAX_RULES;
+	GPtrArray *parts;
+	GHashTableIter iter;
+	gpointer reason, count;
+	guint rules;
+	int ret = 0;
+	int c;
+
+	setlocale(LC_ALL, "");
+
+	while((c = getopt(argc, argv, "m:o:")) != -1)
+	{
+		switch(c)
+		{
+		case 'm':
+			max_rules = strtoul(optarg, NULL, 10);
+			if(max_rules == 0 || max_rules > G_MAXUINT)
+			{
+				usage();
+				return 1;
+			}
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	compiler = abp_compiler_new();
+
+	if(optind == argc)
+	{
+		if(!compile_file(compiler, stdin, "<stdin>")) ret = 1;
+	}
+	else
+	{
+		for(int i = optind; i < argc; i++)
+		{
+			FILE *file = fopen(argv[i], "r"); // flawfinder: ignore
+
+			if(file == NULL)
+			{
+				fprintf(stderr,
+				        _("badwolf-filterc: Error opening %s: %s\n"),
+				        argv[i],
+				        strerror(errno));
+				ret = 1;
+				continue;
+			}
+
+			if(!compile_file(compiler, file, argv[i])) ret = 1;
+			fclose(file);
+		}
+	}
+
+	parts = abp_compiler_finish(compiler, (guint)max_rules, &rules);
+
+	fprintf(stderr,
+	        _("badwolf-filterc: %u lines: %u comments, %u duplicates, %u merged, %u rules\n"),
+	        compiler->lines,
+	        compiler->comments,
+	        compiler->duplicates,
+	        compiler->merged,
+	        rules);
+
+	g_hash_table_iter_init(&iter, compiler->unsupported);
+	while(g_hash_table_iter_next(&iter, &reason, &count))
+		fprintf(stderr,
+		        _("badwolf-filterc: Dropped %u unsupported filters: %s\n"),
+		        GPOINTER_TO_UINT(count),
+		        (gchar *)reason);
+
+	if(parts == NULL)
+	{
+		fprintf(stderr, _("badwolf-filterc: Too many exceptions to fit in %lu rules\n"), max_rules);
+		abp_compiler_free(compiler);
+		return 1;
+	}
+
+	if(output == NULL && parts->len > 1)
+	{
+		fprintf(stderr,
+		        _("badwolf-filterc: Rules need %u lists, an output file is required (-o)\n"),
+		        parts->len);
+		ret = 1;
+	}
+	else if(output == NULL)
+		fputs(((GString *)g_ptr_array_index(parts, 0))->str, stdout);
+	else
+	{
+		for(guint i = 0; i < parts->len; i++)
+		{
+			GString *part = g_ptr_array_index(parts, i);
+			gchar *path   = part_path(output, i);
+			GError *err   = NULL;
+
+			if(!g_file_set_contents(path, part->str, (gssize)part->len, &err))
+			{
+				fprintf(stderr, _("badwolf-filterc: Error writing %s: %s\n"), path, err->message);
+				g_error_free(err);
+				ret = 1;
+			}
+			else
+				fprintf(stderr, _("badwolf-filterc: Wrote %s\n"), path);
+
+			g_free(path);
+		}
+	}
+
+	g_ptr_array_free(parts, TRUE);
+	abp_compiler_free(compiler);
+
+	return ret;
+}
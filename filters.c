@@ -0,0 +1,279 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "filters.h"
+
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <glob.h>
+#include <stdio.h>      /* fprintf() */
+
+/* struct FilterList: A content-filter file, compiled by WebKit under an identifier derived
+ * from its content, so unchanged files get loaded from the cache instead of being recompiled.
+ */
+struct FilterList
+{
+	struct Window *window;
+	gchar *name;
+	GFile *file;
+	gchar *identifier; /* name-sha256, set once the file got read */
+	GBytes *source;
+	gint64 start;
+};
+
+static struct Window *filters_window = NULL;
+static gchar **cached_identifiers    = NULL;
+static GPtrArray *used_identifiers   = NULL;
+static guint lists_pending           = 0;
+static guint lists_loaded            = 0;
+static gint64 lists_start            = 0;
+
+static void
+filter_list_free(struct FilterList *list)
+{
+	g_free(list->name);
+	g_object_unref(list->file);
+	g_free(list->identifier);
+	if(list->source != NULL) g_bytes_unref(list->source);
+	g_free(list);
+}
+
+/* filters_gc: Removes the compiled filters which don't match any current file
+ */
+static void
+filters_gc(void)
+{
+	for(gchar **id = cached_identifiers; id != NULL && *id != NULL; id++)
+	{
+		if(g_ptr_array_find_with_equal_func(used_identifiers, *id, g_str_equal, NULL)) continue;
+
+		fprintf(stderr, _("badwolf: Removing stale compiled content-filter %s\n"), *id);
+		webkit_user_content_filter_store_remove(filters_window->content_store, *id, NULL, NULL, NULL);
+	}
+
+	fprintf(stderr,
+	        _("badwolf: Notice: %u content-filters ready in %.3fs\n"),
+	        lists_loaded,
+	        (gdouble)(g_get_monotonic_time() - lists_start) / G_USEC_PER_SEC);
+
+	g_strfreev(cached_identifiers);
+	cached_identifiers = NULL;
+	g_ptr_array_free(used_identifiers, TRUE);
+	used_identifiers = NULL;
+}
+
+/* filter_list_done: Called once per started list, list being NULL for the listing itself
+ */
+static void
+filter_list_done(struct FilterList *list)
+{
+	if(list != NULL)
+	{
+		if(list->identifier != NULL)
+			g_ptr_array_add(used_identifiers, g_strdup(list->identifier));
+		filter_list_free(list);
+	}
+
+	if(--lists_pending == 0) filters_gc();
+}
+
+static void
+filter_list_add(struct FilterList *list, WebKitUserContentFilter *filter, GError *err)
+{
+	gdouble elapsed = (gdouble)(g_get_monotonic_time() - list->start) / G_USEC_PER_SEC;
+
+	if(filter == NULL)
+	{
+		fprintf(stderr,
+		        _("badwolf: failed to load content-filter %s, err: [%d] %s\n"),
+		        list->name,
+		        err != NULL ? err->code : -1,
+		        err != NULL ? err->message : "unknown");
+		if(err != NULL) g_error_free(err);
+
+		// Lets filters_gc() remove a broken compiled filter
+		g_free(list->identifier);
+		list->identifier = NULL;
+		return;
+	}
+
+	fprintf(stderr,
+	        _("badwolf: content-filter %s %s in %.3fs, adding to content-manager…\n"),
+	        list->name,
+	        list->source != NULL ? _("compiled") : _("loaded"),
+	        elapsed);
+	webkit_user_content_manager_add_filter(list->window->content_manager, filter);
+	webkit_user_content_filter_unref(filter);
+	lists_loaded++;
+}
+
+static void
+content_managerCb_ready(GObject *UNUSED(store), GAsyncResult *result, gpointer user_data)
+{
+	struct FilterList *list = (struct FilterList *)user_data;
+	GError *err             = NULL;
+
+	WebKitUserContentFilter *filter =
+	    webkit_user_content_filter_store_load_finish(list->window->content_store, result, &err);
+
+	filter_list_add(list, filter, err);
+	filter_list_done(list);
+}
+
+static void
+storeCb_finish(GObject *UNUSED(store), GAsyncResult *result, gpointer user_data)
+{
+	struct FilterList *list = (struct FilterList *)user_data;
+	GError *err             = NULL;
+
+	WebKitUserContentFilter *filter =
+	    webkit_user_content_filter_store_save_finish(list->window->content_store, result, &err);
+
+	filter_list_add(list, filter, err);
+	filter_list_done(list);
+}
+
+/* filter_listCb_read: Reads and hashes the file, in a worker thread
+ */
+static void
+filter_listCb_read(GTask *task,
+                   gpointer UNUSED(source_object),
+                   gpointer task_data,
+                   GCancellable *cancellable)
+{
+	struct FilterList *list = (struct FilterList *)task_data;
+	GError *err             = NULL;
+	gchar *contents;
+	gchar *checksum;
+	gsize length;
+
+	if(!g_file_load_contents(list->file, cancellable, &contents, &length, NULL, &err))
+	{
+		g_task_return_error(task, err);
+		return;
+	}
+
+	checksum         = g_compute_checksum_for_data(G_CHECKSUM_SHA256, (guchar *)contents, length);
+	list->identifier = g_strdup_printf("%s-%s", list->name, checksum);
+	list->source     = g_bytes_new_take(contents, length);
+	g_free(checksum);
+
+	g_task_return_boolean(task, TRUE);
+}
+
+static void
+filter_listCb_ready(GObject *UNUSED(source_object), GAsyncResult *result, gpointer user_data)
+{
+	struct FilterList *list             = (struct FilterList *)user_data;
+	WebKitUserContentFilterStore *store = list->window->content_store;
+	GError *err                         = NULL;
+
+	if(!g_task_propagate_boolean(G_TASK(result), &err))
+	{
+		if(!g_error_matches(err, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			fprintf(stderr,
+			        _("badwolf: failed to read content-filter %s, err: [%d] %s\n"),
+			        list->name,
+			        err->code,
+			        err->message);
+		g_error_free(err);
+		filter_list_done(list);
+		return;
+	}
+
+	if(g_strv_contains((const gchar *const *)cached_identifiers, list->identifier))
+	{
+		g_bytes_unref(list->source);
+		list->source = NULL;
+
+		webkit_user_content_filter_store_load(
+		    store, list->identifier, NULL, content_managerCb_ready, list);
+	}
+	else
+		webkit_user_content_filter_store_save(
+		    store, list->identifier, list->source, NULL, storeCb_finish, list);
+}
+
+static void
+filter_list_load(struct Window *window, const gchar *path)
+{
+	struct FilterList *list = g_malloc(sizeof(struct FilterList));
+	GTask *task;
+
+	list->window     = window;
+	list->name       = g_path_get_basename(path);
+	list->file       = g_file_new_for_path(path);
+	list->identifier = NULL;
+	list->source     = NULL;
+	list->start      = g_get_monotonic_time();
+
+	lists_pending++;
+
+	// Each list is read, hashed and compiled on its own, the ones ready first get added first
+	task = g_task_new(NULL, NULL, filter_listCb_ready, list);
+	g_task_set_task_data(task, list, NULL);
+	g_task_run_in_thread(task, filter_listCb_read);
+	g_object_unref(task);
+}
+
+static void
+storeCb_identifiers(GObject *UNUSED(store), GAsyncResult *result, gpointer user_data)
+{
+	struct Window *window = (struct Window *)user_data;
+	glob_t lists_glob;
+	gchar *contentFilterPath =
+	    g_build_filename(g_get_user_config_dir(), g_get_prgname(), "content-filters.json", NULL);
+	gchar *lists_path = g_build_filename(
+	    g_get_user_config_dir(), g_get_prgname(), "content-filters.d", "*.json", NULL);
+
+	cached_identifiers =
+	    webkit_user_content_filter_store_fetch_identifiers_finish(window->content_store, result);
+	used_identifiers = g_ptr_array_new_with_free_func(g_free);
+	lists_loaded     = 0;
+	lists_start      = g_get_monotonic_time();
+
+	// Keeps filters_gc() from running before every list got started
+	lists_pending++;
+
+	fprintf(stderr, _("content-filters file set to: %s\n"), contentFilterPath);
+	filter_list_load(window, contentFilterPath);
+
+	fprintf(stderr, _("badwolf: Checking for content-filters matching %s\n"), lists_path);
+	switch(glob(lists_path, 0, NULL, &lists_glob))
+	{
+	case 0:
+		for(size_t i = 0; i < lists_glob.gl_pathc; i++)
+			filter_list_load(window, lists_glob.gl_pathv[i]);
+		break;
+	case GLOB_NOMATCH:
+		break;
+	case GLOB_NOSPACE:
+		fprintf(stderr, _("badwolf: Failed to list content-filters: Out of Memory\n"));
+		break;
+	case GLOB_ABORTED:
+		fprintf(stderr, _("badwolf: Failed to list content-filters: Read Error\n"));
+		break;
+	}
+
+	globfree(&lists_glob);
+	g_free(lists_path);
+	g_free(contentFilterPath);
+
+	filter_list_done(NULL);
+}
+
+/* badwolf_content_filters_init: Loads the content-filters into window->content_manager,
+ * compiling them only when they changed since the last time.
+ */
+void
+badwolf_content_filters_init(struct Window *window)
+{
+	gchar *filtersPath = g_build_filename(g_get_user_cache_dir(), g_get_prgname(), "filters", NULL);
+
+	filters_window        = window;
+	window->content_store = webkit_user_content_filter_store_new(filtersPath);
+	g_free(filtersPath);
+
+	webkit_user_content_filter_store_fetch_identifiers(
+	    window->content_store, NULL, storeCb_identifiers, window);
+}
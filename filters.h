@@ -0,0 +1,9 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef FILTERS_H_INCLUDED
+#define FILTERS_H_INCLUDED
+#include "badwolf.h"
+
+void badwolf_content_filters_init(struct Window *window);
+#endif /* FILTERS_H_INCLUDED */
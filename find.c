@@ -0,0 +1,552 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+/* Find in the current page, with WebKitFindController or, in regex mode,
+ * with a script walking the text nodes of the page a slice at a time
+ */
+
+#include "find.h"
+
+#include "config.h"
+#include "hibernate.h" /* badwolf_page_get_client() */
+
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <stdio.h>      /* fprintf() */
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+/* Called with action ("start", "step" or "stop"), id, pattern, flags, max and delta.
+ * Matches are searched for within each text node, 10ms at a time so the page stays responsive,
+ * a slice stopping between two matches of a node (like a huge <pre>) and the next one resuming
+ * from there, the progress being posted to badwolfFind after each slice.
+ */
+static const gchar *find_script =
+    "var f = window.badwolfFind;"
+    "if(!f) {"
+    "  f = window.badwolfFind = {id: 0, matches: [], current: -1, more: false, done: true};"
+    "  f.post = function(error) {"
+    "    window.webkit.messageHandlers.badwolfFind.postMessage({"
+    "      id: f.id, count: f.matches.length, current: f.current + 1,"
+    "      more: f.more || !f.done, error: error || ''});"
+    "  };"
+    "  f.show = function() {"
+    "    var m = f.matches[f.current], range = document.createRange(), sel = getSelection();"
+    "    range.setStart(m.node, m.start);"
+    "    range.setEnd(m.node, m.end);"
+    "    sel.removeAllRanges();"
+    "    sel.addRange(range);"
+    "    if(m.node.parentElement) m.node.parentElement.scrollIntoView({block: 'center'});"
+    "  };"
+    "  f.stop = function() {"
+    "    clearTimeout(f.timer);"
+    "    if(f.current >= 0) getSelection().removeAllRanges();"
+    "    f.matches = []; f.current = -1; f.more = false; f.done = true;"
+    "  };"
+    "  f.start = function(re) {"
+    "    var walker = document.createTreeWalker(document.body || document.documentElement,"
+    "      NodeFilter.SHOW_TEXT, {acceptNode: function(node) {"
+    "        var parent = node.parentNode.nodeName;"
+    "        return parent === 'SCRIPT' || parent === 'STYLE' || parent === 'NOSCRIPT' ?"
+    "          NodeFilter.FILTER_REJECT : NodeFilter.FILTER_ACCEPT;"
+    "      }});"
+    "    var node = null;"
+    "    f.done = false;"
+    "    (function slice() {"
+    "      var deadline = performance.now() + 10, m;"
+    "      while(!f.done && performance.now() < deadline) {"
+    "        if(node === null) {"
+    "          if((node = walker.nextNode()) === null) { f.done = true; break; }"
+    "          re.lastIndex = 0;"
+    "        }"
+    "        if((m = re.exec(node.data)) === null) { node = null; continue; }"
+    "        if(m[0].length === 0) { re.lastIndex++; continue; }"
+    "        if(f.matches.length >= max) { f.more = f.done = true; break; }"
+    "        f.matches.push({node: node, start: m.index, end: m.index + m[0].length});"
+    "      }"
+    "      if(f.current < 0 && f.matches.length > 0) { f.current = 0; f.show(); }"
+    "      f.post();"
+    "      if(!f.done) f.timer = setTimeout(slice, 0);"
+    "    })();"
+    "  };"
+    "}"
+    "if(action === 'start') {"
+    "  f.stop();"
+    "  f.id = id;"
+    "  try { var re = new RegExp(pattern, flags); } catch(e) { f.post(e.message); return; }"
+    "  f.start(re);"
+    "} else if(id === f.id) {"
+    "  if(action === 'stop') f.stop();"
+    "  else if(f.matches.length > 0) {"
+    "    f.current = (f.current + delta + f.matches.length) % f.matches.length;"
+    "    f.show();"
+    "    f.post();"
+    "  }"
+    "}";
+
+static guint find_last_id = 0; /* ids of the regex searches, unique across tabs */
+#endif
+
+static gboolean
+find_toggled(GtkWidget *toggle)
+{
+	return toggle != NULL && gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(toggle));
+}
+
+/* find_matches_show: Shows "n of m" next to the search entry, current being 0 when unknown
+ * and more set when there is more than count matches
+ */
+static void
+find_matches_show(struct Client *browser, guint current, guint count, gboolean more)
+{
+	gchar *text;
+
+	if(count == 0)
+		text = g_strdup(_("no matches"));
+	else if(current == 0 && more)
+		text = g_strdup_printf(_("%u+ matches"), count);
+	else if(current == 0)
+		text = g_strdup_printf(_("%u matches"), count);
+	else if(more)
+		text = g_strdup_printf(_("%u of %u+"), current, count);
+	else
+		text = g_strdup_printf(_("%u of %u"), current, count);
+
+	gtk_label_set_text(GTK_LABEL(browser->search_matches), text);
+	g_free(text);
+}
+
+/* find_native_show: Shows the matches known by WebKitFindController, if counted yet */
+static void
+find_native_show(struct Client *browser)
+{
+	if(browser->search_count == G_MAXUINT)
+		find_matches_show(browser, browser->search_current, BADWOLF_FIND_MAX_MATCHES, TRUE);
+	else if(browser->search_count != 0)
+		find_matches_show(browser, browser->search_current, browser->search_count, FALSE);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+static void
+find_regex_call(struct Client *browser, const gchar *action, const gchar *pattern, gint delta)
+{
+	GVariantDict args;
+
+	g_variant_dict_init(&args, NULL);
+	g_variant_dict_insert(&args, "action", "s", action);
+	g_variant_dict_insert(&args, "id", "u", browser->search_id);
+	g_variant_dict_insert(&args, "pattern", "s", pattern != NULL ? pattern : "");
+	g_variant_dict_insert(&args, "flags", "s", find_toggled(browser->search_case) ? "g" : "gi");
+	g_variant_dict_insert(&args, "max", "u", BADWOLF_FIND_MAX_MATCHES);
+	g_variant_dict_insert(&args, "delta", "i", delta);
+
+	webkit_web_view_call_async_javascript_function(browser->webView,
+	                                               find_script,
+	                                               -1,
+	                                               g_variant_dict_end(&args),
+	                                               FIND_WORLD,
+	                                               NULL,
+	                                               NULL,
+	                                               NULL,
+	                                               NULL);
+}
+#endif
+
+/* find_stop: Cancels the pending and current searches of browser, clearing their matches
+ */
+static void
+find_stop(struct Client *browser)
+{
+	if(browser->search_timeout != 0)
+	{
+		g_source_remove(browser->search_timeout);
+		browser->search_timeout = 0;
+	}
+
+	if(browser->webView != NULL)
+	{
+		webkit_find_controller_search_finish(webkit_web_view_get_find_controller(browser->webView));
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+		if(browser->search_id != 0) find_regex_call(browser, "stop", NULL, 0);
+#endif
+	}
+
+	badwolf_find_reset(browser);
+}
+
+/* find_start: Searches for the text of browser->search, with the current options
+ */
+static void
+find_start(struct Client *browser)
+{
+	const gchar *text = gtk_entry_get_text(GTK_ENTRY(browser->search));
+	WebKitFindController *findController;
+	guint32 options = WEBKIT_FIND_OPTIONS_WRAP_AROUND;
+
+	find_stop(browser);
+
+	if(text[0] == '\0' || browser->webView == NULL) return;
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+	if(find_toggled(browser->search_regex))
+	{
+		gchar *pattern = find_toggled(browser->search_words) ? g_strdup_printf("\\b(?:%s)", text)
+		                                                      : g_strdup(text);
+
+		browser->search_id = ++find_last_id;
+		find_regex_call(browser, "start", pattern, 0);
+		g_free(pattern);
+		return;
+	}
+#endif
+
+	findController = webkit_web_view_get_find_controller(browser->webView);
+
+	if(!find_toggled(browser->search_case)) options |= WEBKIT_FIND_OPTIONS_CASE_INSENSITIVE;
+	if(find_toggled(browser->search_words)) options |= WEBKIT_FIND_OPTIONS_AT_WORD_STARTS;
+
+	// Both bounded, a query matching most of a huge page stopping early
+	webkit_find_controller_search(findController, text, options, BADWOLF_FIND_MAX_MATCHES);
+	webkit_find_controller_count_matches(findController, text, options, BADWOLF_FIND_MAX_MATCHES);
+}
+
+/* find_step: Goes to the next match, or the previous one when forward is FALSE
+ */
+static void
+find_step(struct Client *browser, gboolean forward)
+{
+	WebKitFindController *findController;
+	guint count = browser->search_count;
+
+	// Searching right away instead of waiting for the typing to end
+	if(browser->search_timeout != 0)
+	{
+		find_start(browser);
+		return;
+	}
+
+	if(browser->webView == NULL) return;
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+	if(browser->search_id != 0)
+	{
+		find_regex_call(browser, "step", NULL, forward ? 1 : -1);
+		return;
+	}
+#endif
+
+	findController = webkit_web_view_get_find_controller(browser->webView);
+
+	if(forward)
+		webkit_find_controller_search_next(findController);
+	else
+		webkit_find_controller_search_previous(findController);
+
+	// Counted from where the search started, wrapping around when every match is known
+	if(browser->search_current == 0) return;
+
+	if(forward)
+		browser->search_current =
+		    count != G_MAXUINT && browser->search_current >= count ? 1 : browser->search_current + 1;
+	else if(browser->search_current > 1)
+		browser->search_current--;
+	else if(count != G_MAXUINT && count != 0)
+		browser->search_current = count;
+
+	find_native_show(browser);
+}
+
+static gboolean
+findCb_timeout(gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	browser->search_timeout = 0;
+	find_start(browser);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+SearchEntryCb_changed(GtkEditable *UNUSED(search), gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+	const gchar *text      = gtk_entry_get_text(GTK_ENTRY(browser->search));
+
+	if(text[0] == '\0')
+	{
+		find_stop(browser);
+		return;
+	}
+
+	if(browser->search_timeout != 0) g_source_remove(browser->search_timeout);
+
+	// One or two characters tend to match most of a page
+	browser->search_timeout =
+	    g_timeout_add(g_utf8_strlen(text, -1) < 3 ? BADWOLF_FIND_SHORT_DELAY : BADWOLF_FIND_DELAY,
+	                  findCb_timeout,
+	                  browser);
+}
+
+static gboolean
+SearchEntryCb_next__match(GtkSearchEntry *UNUSED(search), gpointer user_data)
+{
+	find_step((struct Client *)user_data, TRUE);
+
+	return TRUE;
+}
+
+static gboolean
+SearchEntryCb_previous__match(GtkSearchEntry *UNUSED(search), gpointer user_data)
+{
+	find_step((struct Client *)user_data, FALSE);
+
+	return TRUE;
+}
+
+static void
+SearchEntryCb_activate(GtkEntry *UNUSED(search), gpointer user_data)
+{
+	find_step((struct Client *)user_data, TRUE);
+}
+
+static gboolean
+SearchEntryCb_stop__search(GtkSearchEntry *UNUSED(search), gpointer user_data)
+{
+	find_stop((struct Client *)user_data);
+
+	return TRUE;
+}
+
+static void
+findCb_toggled(GtkToggleButton *UNUSED(toggle), gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	if(gtk_entry_get_text_length(GTK_ENTRY(browser->search)) > 0) find_start(browser);
+}
+
+static void
+find_controllerCb_found__text(WebKitFindController *UNUSED(findController),
+                              guint UNUSED(match_count),
+                              gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	// Also emitted when going to the next/previous match
+	if(browser->search_current == 0) browser->search_current = 1;
+
+	find_native_show(browser);
+}
+
+static void
+find_controllerCb_failed__to__find__text(WebKitFindController *UNUSED(findController),
+                                         gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	browser->search_current = 0;
+	browser->search_count   = 0;
+	find_matches_show(browser, 0, 0, FALSE);
+}
+
+static void
+find_controllerCb_counted__matches(WebKitFindController *UNUSED(findController),
+                                   guint match_count,
+                                   gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+
+	// Late result of a search which got replaced by a regex one
+	if(browser->search_id != 0) return;
+
+	browser->search_count = match_count;
+
+	if(match_count == 0)
+		find_matches_show(browser, 0, 0, FALSE);
+	else
+		find_native_show(browser);
+}
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+static gint32
+find_property_int(JSCValue *value, const gchar *name)
+{
+	JSCValue *property = jsc_value_object_get_property(value, name);
+	gint32 n           = jsc_value_is_number(property) ? jsc_value_to_int32(property) : 0;
+
+	g_object_unref(property);
+
+	return n;
+}
+
+/* content_managerCb_find: Progress of a regex search, posted by find_script
+ */
+static void
+content_managerCb_find(WebKitUserContentManager *UNUSED(content_manager),
+                       WebKitJavascriptResult *result,
+                       gpointer user_data)
+{
+	struct Window *window  = (struct Window *)user_data;
+	GtkNotebook *notebook  = GTK_NOTEBOOK(window->notebook);
+	JSCValue *value        = webkit_javascript_result_get_js_value(result);
+	struct Client *browser = NULL;
+	JSCValue *property;
+	gchar *error;
+	gint32 id;
+
+	if(!jsc_value_is_object(value)) return;
+
+	// Pages can't post to the isolated world, but the tab might be gone or searching again
+	id = find_property_int(value, "id");
+	if(id <= 0) return;
+
+	for(gint i = 0; browser == NULL && i < gtk_notebook_get_n_pages(notebook); i++)
+	{
+		struct Client *page = badwolf_page_get_client(gtk_notebook_get_nth_page(notebook, i));
+
+		if(page != NULL && page->search_id == (guint)id) browser = page;
+	}
+
+	if(browser == NULL) return;
+
+	property = jsc_value_object_get_property(value, "error");
+	error    = jsc_value_to_string(property);
+	g_object_unref(property);
+
+	if(error[0] != '\0')
+	{
+		gtk_label_set_text(GTK_LABEL(browser->search_matches), error);
+	}
+	else
+	{
+		JSCValue *more = jsc_value_object_get_property(value, "more");
+
+		find_matches_show(browser,
+		                  (guint)find_property_int(value, "current"),
+		                  (guint)find_property_int(value, "count"),
+		                  jsc_value_to_boolean(more));
+		g_object_unref(more);
+	}
+
+	g_free(error);
+}
+#endif
+
+/* badwolf_find_init: Registers the handler of the regex search, only exposed to FIND_WORLD
+ */
+void
+badwolf_find_init(struct Window *window)
+{
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+	if(!webkit_user_content_manager_register_script_message_handler_in_world(
+	       window->content_manager, "badwolfFind", FIND_WORLD))
+	{
+		fprintf(stderr, _("badwolf: Failed to register the find in page handler\n"));
+		return;
+	}
+
+	g_signal_connect(window->content_manager,
+	                 "script-message-received::badwolfFind",
+	                 G_CALLBACK(content_managerCb_find),
+	                 window);
+#else
+	(void)window;
+#endif
+}
+
+static GtkWidget *
+find_toggle_new(const gchar *name, const gchar *label, const gchar *tooltip)
+{
+	GtkWidget *toggle = gtk_toggle_button_new_with_label(label);
+
+	gtk_widget_set_name(toggle, name);
+	gtk_widget_set_tooltip_text(toggle, tooltip);
+	gtk_widget_set_focus_on_click(toggle, FALSE);
+	gtk_button_set_relief(GTK_BUTTON(toggle), GTK_RELIEF_NONE);
+
+	return toggle;
+}
+
+/* badwolf_find_attach: Packs the matches and options of the search after browser->search
+ * in browser->statusbar, and connects the search entry signals
+ */
+void
+badwolf_find_attach(struct Client *browser)
+{
+	GtkWidget *widgets[4];
+
+	browser->search_matches = gtk_label_new(NULL);
+	gtk_widget_set_name(browser->search_matches, "browser__search_matches");
+	gtk_label_set_single_line_mode(GTK_LABEL(browser->search_matches), TRUE);
+	gtk_label_set_ellipsize(GTK_LABEL(browser->search_matches), PANGO_ELLIPSIZE_END);
+	gtk_label_set_max_width_chars(GTK_LABEL(browser->search_matches), 20);
+
+	browser->search_case  = find_toggle_new("browser__search_case", "Aa", _("Match case"));
+	browser->search_words = find_toggle_new("browser__search_words", "ab", _("Match at word starts"));
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+	browser->search_regex = find_toggle_new(
+	    "browser__search_regex", ".*", _("Regular expression, matched within each text node"));
+#else
+	browser->search_regex = NULL;
+#endif
+
+	widgets[0] = browser->search_matches;
+	widgets[1] = browser->search_case;
+	widgets[2] = browser->search_words;
+	widgets[3] = browser->search_regex;
+
+	for(guint i = 0; i < 4 && widgets[i] != NULL; i++)
+	{
+		gtk_box_pack_start(
+		    GTK_BOX(browser->statusbar), widgets[i], FALSE, FALSE, BADWOLF_STATUSBAR_PADDING);
+
+		if(i > 0) g_signal_connect(widgets[i], "toggled", G_CALLBACK(findCb_toggled), browser);
+	}
+
+	g_signal_connect(browser->search, "changed", G_CALLBACK(SearchEntryCb_changed), browser);
+	g_signal_connect(browser->search, "activate", G_CALLBACK(SearchEntryCb_activate), browser);
+	g_signal_connect(browser->search, "next-match", G_CALLBACK(SearchEntryCb_next__match), browser);
+	g_signal_connect(
+	    browser->search, "previous-match", G_CALLBACK(SearchEntryCb_previous__match), browser);
+	g_signal_connect(browser->search, "stop-search", G_CALLBACK(SearchEntryCb_stop__search), browser);
+}
+
+/* badwolf_find_web_view: Connects the find controller of the newly created browser->webView
+ */
+void
+badwolf_find_web_view(struct Client *browser)
+{
+	WebKitFindController *findController = webkit_web_view_get_find_controller(browser->webView);
+
+	g_signal_connect(
+	    findController, "found-text", G_CALLBACK(find_controllerCb_found__text), browser);
+	g_signal_connect(findController,
+	                 "failed-to-find-text",
+	                 G_CALLBACK(find_controllerCb_failed__to__find__text),
+	                 browser);
+	g_signal_connect(
+	    findController, "counted-matches", G_CALLBACK(find_controllerCb_counted__matches), browser);
+}
+
+/* badwolf_find_reset: Forgets the matches of browser, as done when a new page got committed
+ */
+void
+badwolf_find_reset(struct Client *browser)
+{
+	browser->search_id      = 0;
+	browser->search_count   = 0;
+	browser->search_current = 0;
+
+	gtk_label_set_text(GTK_LABEL(browser->search_matches), "");
+}
+
+void
+badwolf_find_free(struct Client *browser)
+{
+	if(browser->search_timeout != 0) g_source_remove(browser->search_timeout);
+
+	if(browser->webView != NULL)
+		g_signal_handlers_disconnect_by_data(webkit_web_view_get_find_controller(browser->webView),
+		                                     browser);
+}
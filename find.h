@@ -0,0 +1,17 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef FIND_H_INCLUDED
+#define FIND_H_INCLUDED
+#include "badwolf.h"
+
+/* FIND_WORLD: Script world of the regular expression search, isolated from the page scripts
+ */
+#define FIND_WORLD "badwolf-find"
+
+void badwolf_find_init(struct Window *window);
+void badwolf_find_attach(struct Client *browser);
+void badwolf_find_web_view(struct Client *browser);
+void badwolf_find_reset(struct Client *browser);
+void badwolf_find_free(struct Client *browser);
+#endif /* FIND_H_INCLUDED */
@@ -0,0 +1,433 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "hibernate.h"
+
+#include "config.h"
+#include "contexts.h"
+#include "session.h"
+
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <stdio.h>      /* fprintf() */
+
+static guint lazy_pending = 0;
+static guint lazy_idle_id = 0;
+
+/* badwolf_page_get_client: Gets the struct Client of a notebook page,
+ * returns NULL for pages which aren't a browser (like the downloads tab)
+ */
+struct Client *
+badwolf_page_get_client(GtkWidget *page)
+{
+	return (struct Client *)g_object_get_data(G_OBJECT(page), "badwolf-client");
+}
+
+void
+badwolf_hibernation_free(struct Hibernation *hibernation)
+{
+	if(hibernation == NULL) return;
+
+	if(hibernation->lazy) lazy_pending--;
+
+	if(hibernation->session_state != NULL)
+		webkit_web_view_session_state_unref(hibernation->session_state);
+
+	if(hibernation->session_data != NULL) g_bytes_unref(hibernation->session_data);
+
+	g_free(hibernation->title);
+	g_free(hibernation->uri);
+	g_free(hibernation);
+}
+
+static void
+hibernation_add_placeholder(struct Client *browser, struct Hibernation *hibernation)
+{
+	hibernation->placeholder = gtk_label_new(_("Hibernated tab, select it to restore it."));
+	gtk_widget_set_name(hibernation->placeholder, "browser__hibernated");
+	gtk_box_pack_start(
+	    GTK_BOX(browser->box), hibernation->placeholder, TRUE, TRUE, BADWOLF_BOX_PADDING);
+	gtk_box_reorder_child(GTK_BOX(browser->box), hibernation->placeholder, 1);
+	gtk_widget_show(hibernation->placeholder);
+
+	browser->hibernation = hibernation;
+}
+
+/* tab_hibernate: Discards browser->webView, keeping only what's needed to restore it
+ *
+ * The WebView gets replaced by a placeholder in browser->box, browser->web_context stays
+ * referenced so the (ephemeral) session of the tab is kept.
+ * When session_state is NULL, the current one of the WebView is used.
+ */
+static void
+tab_hibernate(struct Client *browser, WebKitWebViewSessionState *session_state)
+{
+	WebKitWebView *webView = browser->webView;
+	struct Hibernation *hibernation;
+	WebKitSettings *settings;
+
+	if(webView == NULL) return;
+
+	hibernation = g_malloc(sizeof(struct Hibernation));
+	settings    = webkit_web_view_get_settings(webView);
+
+	if(session_state != NULL)
+		hibernation->session_state = webkit_web_view_session_state_ref(session_state);
+	else
+		hibernation->session_state = webkit_web_view_get_session_state(webView);
+
+	hibernation->title            = g_strdup(webkit_web_view_get_title(webView));
+	hibernation->uri              = g_strdup(webkit_web_view_get_uri(webView));
+	hibernation->zoom             = webkit_web_view_get_zoom_level(webView);
+	hibernation->javascript       = webkit_settings_get_enable_javascript_markup(settings);
+	hibernation->auto_load_images = webkit_settings_get_auto_load_images(settings);
+	hibernation->lazy             = FALSE;
+
+	hibernation->session_data      = NULL;
+	hibernation->session_data_size = 0;
+
+	hibernation_add_placeholder(browser, hibernation);
+	browser->webView = NULL;
+
+	// Avoids getting callbacks from a half-destroyed view
+	g_signal_handlers_disconnect_by_data(webView, browser);
+	gtk_widget_destroy(GTK_WIDGET(webView));
+
+	webView_tab_label_change(browser, NULL);
+}
+
+void
+badwolf_tab_hibernate(struct Client *browser)
+{
+	tab_hibernate(browser, NULL);
+}
+
+/* badwolf_tab_hibernate_lazy: Puts a tab without a WebView yet into hibernation,
+ * waking it up will then load uri.
+ */
+void
+badwolf_tab_hibernate_lazy(struct Client *browser, const gchar *uri)
+{
+	struct Hibernation *hibernation = g_malloc(sizeof(struct Hibernation));
+
+	hibernation->session_state = NULL;
+	hibernation->title         = NULL;
+	hibernation->uri           = g_strdup(uri);
+	hibernation->zoom          = 1;
+	hibernation->javascript =
+	    gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(browser->javascript));
+	hibernation->auto_load_images =
+	    gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(browser->auto_load_images));
+	hibernation->lazy = TRUE;
+
+	hibernation->session_data      = NULL;
+	hibernation->session_data_size = 0;
+
+	hibernation_add_placeholder(browser, hibernation);
+	browser->webView = NULL;
+
+	lazy_pending++;
+	badwolf_lazy_schedule(browser->window);
+}
+
+/* badwolf_tab_hibernate_restored: Turns a lazy tab into a plain hibernated one,
+ * restored from session_data (as stored in the session journal) once selected.
+ *
+ * Restored sessions can have hundreds of tabs, loading them in the background would
+ * only end up with them getting hibernated again.
+ */
+void
+badwolf_tab_hibernate_restored(struct Client *browser,
+                               const gchar *title,
+                               GBytes *session_data,
+                               guint32 session_data_size)
+{
+	struct Hibernation *hibernation = browser->hibernation;
+
+	if(hibernation == NULL) return;
+
+	if(hibernation->lazy) lazy_pending--;
+	hibernation->lazy = FALSE;
+
+	g_free(hibernation->title);
+	hibernation->title = g_strdup(title);
+
+	if(hibernation->session_data != NULL) g_bytes_unref(hibernation->session_data);
+	hibernation->session_data      = session_data != NULL ? g_bytes_ref(session_data) : NULL;
+	hibernation->session_data_size = session_data_size;
+}
+
+/* badwolf_tab_wake: Rebuilds browser->webView from browser->hibernation
+ */
+void
+badwolf_tab_wake(struct Client *browser)
+{
+	struct Hibernation *hibernation = browser->hibernation;
+	WebKitBackForwardListItem *item = NULL;
+
+	if(hibernation == NULL) return;
+
+	WebKitSettings *settings = webkit_settings_new_with_settings(BADWOLF_WEBKIT_SETTINGS);
+	webkit_settings_set_enable_javascript_markup(settings, hibernation->javascript);
+	webkit_settings_set_auto_load_images(settings, hibernation->auto_load_images);
+
+	gtk_widget_destroy(hibernation->placeholder);
+	browser->hibernation = NULL;
+	browser->last_active = g_get_monotonic_time();
+
+	if(browser->web_context == NULL) browser->web_context = badwolf_web_context_new(browser->window);
+
+	badwolf_new_web_view(browser, NULL, settings);
+	g_object_unref(settings);
+
+	webkit_web_view_set_zoom_level(browser->webView, hibernation->zoom);
+
+	if(hibernation->session_state == NULL && hibernation->session_data != NULL)
+		hibernation->session_state = badwolf_session_state_decompress(
+		    hibernation->session_data, hibernation->session_data_size);
+
+	if(hibernation->session_state != NULL)
+	{
+		webkit_web_view_restore_session_state(browser->webView, hibernation->session_state);
+		item = webkit_back_forward_list_get_current_item(
+		    webkit_web_view_get_back_forward_list(browser->webView));
+	}
+
+	if(item != NULL)
+		webkit_web_view_go_to_back_forward_list_item(browser->webView, item);
+	else if(hibernation->uri != NULL)
+		badwolf_load_uri(browser, hibernation->uri);
+
+	gtk_widget_show(GTK_WIDGET(browser->webView));
+
+	badwolf_hibernation_free(hibernation);
+}
+
+/* badwolf_hibernate_background_tabs: Hibernates every tab which isn't the current one
+ * and wasn't active for the last idle_usec microseconds.
+ *
+ * Tabs playing audio are left alone.
+ */
+void
+badwolf_hibernate_background_tabs(struct Window *window, gint64 idle_usec)
+{
+	GtkNotebook *notebook = GTK_NOTEBOOK(window->notebook);
+	gint current_page     = gtk_notebook_get_current_page(notebook);
+	gint64 now            = g_get_monotonic_time();
+
+	for(gint i = 0; i < gtk_notebook_get_n_pages(notebook); i++)
+	{
+		struct Client *browser = badwolf_page_get_client(gtk_notebook_get_nth_page(notebook, i));
+
+		if(browser == NULL || browser->webView == NULL) continue;
+
+		if(i == current_page)
+		{
+			browser->last_active = now;
+			continue;
+		}
+
+		if(webkit_web_view_is_playing_audio(browser->webView)) continue;
+
+		if(now - browser->last_active >= idle_usec) badwolf_tab_hibernate(browser);
+	}
+}
+
+gboolean
+hibernateCb_timeout(gpointer user_data)
+{
+	struct Window *window = (struct Window *)user_data;
+
+	badwolf_hibernate_background_tabs(window,
+	                                  (gint64)BADWOLF_TAB_HIBERNATE_TIMEOUT * G_USEC_PER_SEC);
+
+	return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+lazyCb_idle(gpointer user_data)
+{
+	struct Window *window  = (struct Window *)user_data;
+	GtkNotebook *notebook  = GTK_NOTEBOOK(window->notebook);
+	struct Client *pending = NULL;
+	guint loading          = 0;
+
+	for(gint i = 0; i < gtk_notebook_get_n_pages(notebook); i++)
+	{
+		struct Client *browser = badwolf_page_get_client(gtk_notebook_get_nth_page(notebook, i));
+
+		if(browser == NULL) continue;
+
+		if(browser->webView != NULL && webkit_web_view_is_loading(browser->webView))
+			loading++;
+		else if(pending == NULL && browser->hibernation != NULL && browser->hibernation->lazy)
+			pending = browser;
+	}
+
+	if(pending == NULL || loading >= BADWOLF_TAB_LAZY_LOADING_MAX)
+	{
+		// Either done or rescheduled by WebViewCb_load_changed once a load finishes
+		lazy_idle_id = 0;
+		return G_SOURCE_REMOVE;
+	}
+
+	badwolf_tab_wake(pending);
+
+	// Rescheduled by WebViewCb_load_changed once the load started
+	lazy_idle_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+/* badwolf_lazy_schedule: Materializes lazy tabs in the background when the main loop is idle,
+ * with at most BADWOLF_TAB_LAZY_LOADING_MAX tabs loading at the same time.
+ */
+void
+badwolf_lazy_schedule(struct Window *window)
+{
+	if(BADWOLF_TAB_LAZY_LOADING_MAX == 0 || lazy_pending == 0 || lazy_idle_id != 0) return;
+
+	lazy_idle_id = g_idle_add_full(G_PRIORITY_LOW, lazyCb_idle, window, NULL);
+}
+
+/* badwolf_memory_reclaim: Drops the memory caches of every context and hibernates background tabs,
+ * all of them when critical is TRUE, only the ones idle for BADWOLF_TAB_RECLAIM_IDLE otherwise.
+ */
+void
+badwolf_memory_reclaim(struct Window *window, gboolean critical)
+{
+	GtkNotebook *notebook = GTK_NOTEBOOK(window->notebook);
+	GPtrArray *contexts   = g_ptr_array_new();
+
+	for(gint i = 0; i < gtk_notebook_get_n_pages(notebook); i++)
+	{
+		struct Client *browser = badwolf_page_get_client(gtk_notebook_get_nth_page(notebook, i));
+
+		if(browser == NULL || browser->web_context == NULL) continue;
+
+		if(!g_ptr_array_find(contexts, browser->web_context, NULL))
+			g_ptr_array_add(contexts, browser->web_context);
+	}
+
+	for(guint i = 0; i < contexts->len; i++)
+	{
+		WebKitWebsiteDataManager *website_data_manager =
+		    webkit_web_context_get_website_data_manager(g_ptr_array_index(contexts, i));
+
+		webkit_website_data_manager_clear(
+		    website_data_manager, WEBKIT_WEBSITE_DATA_MEMORY_CACHE, 0, NULL, NULL, NULL);
+	}
+
+	g_ptr_array_free(contexts, TRUE);
+
+	badwolf_hibernate_background_tabs(
+	    window, critical ? 0 : (gint64)BADWOLF_TAB_RECLAIM_IDLE * G_USEC_PER_SEC);
+}
+
+#if GLIB_CHECK_VERSION(2, 64, 0)
+static void
+memory_monitorCb_low_memory_warning(GMemoryMonitor *UNUSED(monitor),
+                                    GMemoryMonitorWarningLevel level,
+                                    gpointer user_data)
+{
+	struct Window *window = (struct Window *)user_data;
+
+	fprintf(stderr, _("badwolf: Notice: Low memory warning (level %d), reclaiming memory\n"), level);
+
+	badwolf_memory_reclaim(window, level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL);
+}
+#endif
+
+/* badwolf_memory_monitor_init: Reclaims memory on the system's low-memory warnings,
+ * hopefully before any web process reaches its kill threshold.
+ */
+void
+badwolf_memory_monitor_init(struct Window *window)
+{
+#if GLIB_CHECK_VERSION(2, 64, 0)
+	// Kept for the whole lifetime of badwolf
+	GMemoryMonitor *memory_monitor = g_memory_monitor_dup_default();
+
+	g_signal_connect(memory_monitor,
+	                 "low-memory-warning",
+	                 G_CALLBACK(memory_monitorCb_low_memory_warning),
+	                 window);
+#else
+	(void)window;
+#endif
+}
+
+/* badwolf_tab_snapshot: Keeps the session state of browser in memory,
+ * for restoring it into a new WebView in case the web process crashes.
+ */
+void
+badwolf_tab_snapshot(struct Client *browser)
+{
+	gint64 now = g_get_monotonic_time();
+
+	if(browser->session_snapshot != NULL)
+		webkit_web_view_session_state_unref(browser->session_snapshot);
+
+	browser->session_snapshot = webkit_web_view_get_session_state(browser->webView);
+
+	// Page stayed alive long enough, not a crash loop
+	if(browser->crash_count > 0 &&
+	   now - browser->last_crash >= (gint64)BADWOLF_TAB_CRASH_RESET * G_USEC_PER_SEC)
+		browser->crash_count = 0;
+}
+
+static gboolean
+crashCb_restore(gpointer user_data)
+{
+	struct Client *browser = (struct Client *)user_data;
+	GtkNotebook *notebook  = GTK_NOTEBOOK(browser->window->notebook);
+
+	browser->restore_source = 0;
+	browser->restore_count++;
+
+	tab_hibernate(browser, browser->session_snapshot);
+
+	fprintf(stderr,
+	        _("badwolf: Notice: Restoring tab <%s> (crashes: %u, restores: %u)\n"),
+	        browser->hibernation->uri,
+	        browser->crash_count,
+	        browser->restore_count);
+
+	// Background tabs are restored once selected, like any hibernated tab
+	if(gtk_notebook_page_num(notebook, browser->box) == gtk_notebook_get_current_page(notebook))
+		badwolf_tab_wake(browser);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* badwolf_tab_crashed: Schedules the restoration of a tab which web process terminated,
+ * with an exponential backoff and giving up after BADWOLF_TAB_CRASH_MAX successive crashes.
+ */
+void
+badwolf_tab_crashed(struct Client *browser)
+{
+	guint delay;
+
+	browser->crash_count++;
+	browser->last_crash = g_get_monotonic_time();
+
+	if(browser->crash_count > BADWOLF_TAB_CRASH_MAX)
+	{
+		fprintf(stderr,
+		        _("badwolf: Warning: Tab crashed %u times in a row, not restoring it (restores: %u)\n"),
+		        browser->crash_count,
+		        browser->restore_count);
+		return;
+	}
+
+	delay = (guint)BADWOLF_TAB_CRASH_BACKOFF << MIN(browser->crash_count - 1, 16);
+	delay = MIN(delay, (guint)BADWOLF_TAB_CRASH_BACKOFF_MAX);
+
+	fprintf(stderr,
+	        _("badwolf: Notice: Tab crashed (crashes: %u, restores: %u), restoring in %ums\n"),
+	        browser->crash_count,
+	        browser->restore_count,
+	        delay);
+
+	if(browser->restore_source != 0) g_source_remove(browser->restore_source);
+	browser->restore_source = g_timeout_add(delay, crashCb_restore, browser);
+}
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef HIBERNATE_H_INCLUDED
+#define HIBERNATE_H_INCLUDED
+#include "badwolf.h"
+
+/* struct Hibernation: What is kept of a tab once its WebView got discarded,
+ * enough to rebuild an equivalent WebView when the tab gets selected again.
+ */
+struct Hibernation
+{
+	WebKitWebViewSessionState *session_state;
+	gchar *title;
+	gchar *uri;
+	gdouble zoom;
+	gboolean javascript;
+	gboolean auto_load_images;
+	gboolean lazy; /* Never got a WebView, see new_lazy_browser() */
+	GBytes *session_data; /* compressed session_state, see badwolf_session_restore() */
+	guint32 session_data_size;
+
+	GtkWidget *placeholder;
+};
+
+struct Client *badwolf_page_get_client(GtkWidget *page);
+void badwolf_hibernation_free(struct Hibernation *hibernation);
+void badwolf_tab_hibernate(struct Client *browser);
+void badwolf_tab_hibernate_lazy(struct Client *browser, const gchar *uri);
+void badwolf_tab_hibernate_restored(struct Client *browser,
+                                    const gchar *title,
+                                    GBytes *session_data,
+                                    guint32 session_data_size);
+void badwolf_tab_wake(struct Client *browser);
+void badwolf_hibernate_background_tabs(struct Window *window, gint64 idle_usec);
+gboolean hibernateCb_timeout(gpointer user_data);
+void badwolf_lazy_schedule(struct Window *window);
+void badwolf_memory_reclaim(struct Window *window, gboolean critical);
+void badwolf_memory_monitor_init(struct Window *window);
+void badwolf_tab_snapshot(struct Client *browser);
+void badwolf_tab_crashed(struct Client *browser);
+#endif /* HIBERNATE_H_INCLUDED */
@@ -0,0 +1,926 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "history.h"
+
+#include "completion.h"
+
+#include <errno.h>
+#include <glib/gi18n.h>  /* _() and other internationalization/localization helpers */
+#include <glib/gstdio.h> /* g_fopen(), g_rename(), g_unlink() */
+#include <stdio.h>       /* fwrite(), fprintf() */
+#include <stdlib.h>      /* strtoll() */
+#include <string.h>      /* memcpy(), memcmp(), memchr(), strcmp(), strerror() */
+
+#define HISTORY_MAGIC "BWHIST\x01\x00"
+#define HISTORY_MAGIC_LEN 8
+#define HISTORY_HEADER_LEN 24
+#define HISTORY_LOG_HEADER "badwolf-history "
+
+/* struct HistoryVisits: What is known of an URI besides the index
+ */
+struct HistoryVisits
+{
+	gchar *uri;
+	gchar *title;
+	guint32 visits;
+	gint64 last_visit;
+	gdouble frecency;
+};
+
+/* struct HistoryJob: Work for the writer thread, processed one at a time and in order
+ */
+struct HistoryJob
+{
+	gboolean compact;
+	GString *data; /* log lines to append, NULL when compacting */
+};
+
+/* struct HistoryItem: A record of the index being built
+ */
+struct HistoryItem
+{
+	guint64 hash;
+	guint32 position;
+	struct HistoryVisits *visits;
+};
+
+/* history_hash: 64-bit FNV-1a of uri, which orders the records of the index
+ */
+guint64
+history_hash(const gchar *uri)
+{
+	guint64 hash = G_GUINT64_CONSTANT(0xcbf29ce484222325);
+
+	for(const guchar *c = (const guchar *)uri; *c != '\0'; c++)
+	{
+		hash ^= *c;
+		hash *= G_GUINT64_CONSTANT(0x100000001b3);
+	}
+
+	return hash;
+}
+
+static void
+history_visits_free(gpointer data)
+{
+	struct HistoryVisits *visits = data;
+
+	g_free(visits->uri);
+	g_free(visits->title);
+	g_free(visits);
+}
+
+static GHashTable *
+history_visits_table_new(void)
+{
+	return g_hash_table_new_full(g_str_hash, g_str_equal, NULL, history_visits_free);
+}
+
+static struct HistoryVisits *
+history_visits_get(GHashTable *table, const gchar *uri)
+{
+	struct HistoryVisits *visits = g_hash_table_lookup(table, uri);
+
+	if(visits != NULL) return visits;
+
+	visits      = g_malloc0(sizeof(struct HistoryVisits));
+	visits->uri = g_strdup(uri);
+	g_hash_table_insert(table, visits->uri, visits);
+
+	return visits;
+}
+
+/* history_visits_add: Counts a visit at time, 0 only setting the title (when not NULL)
+ */
+static void
+history_visits_add(GHashTable *table, const gchar *uri, const gchar *title, gint64 time)
+{
+	struct HistoryVisits *visits = history_visits_get(table, uri);
+
+	if(title != NULL && title[0] != '\0')
+	{
+		g_free(visits->title);
+		visits->title = g_strdup(title);
+	}
+
+	if(time <= 0) return;
+
+	visits->visits++;
+	visits->frecency += completion_weight(time);
+	visits->last_visit = MAX(visits->last_visit, time);
+}
+
+/* history_merge: Adds the visits of from to entry
+ */
+static void
+history_merge(struct HistoryEntry *entry, const struct HistoryVisits *from)
+{
+	if(entry->uri == NULL) entry->uri = from->uri;
+	if(from->title != NULL) entry->title = from->title;
+
+	entry->visits += from->visits;
+	entry->frecency += from->frecency;
+	entry->last_visit = MAX(entry->last_visit, from->last_visit);
+}
+
+static void
+history_merge_table(GHashTable *into, GHashTable *from)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, from);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		struct HistoryVisits *visits = value;
+		struct HistoryVisits *merged = history_visits_get(into, visits->uri);
+
+		// Visits of into are the most recent ones
+		if(merged->title == NULL) merged->title = g_strdup(visits->title);
+
+		merged->visits += visits->visits;
+		merged->frecency += visits->frecency;
+		merged->last_visit = MAX(merged->last_visit, visits->last_visit);
+	}
+}
+
+static gchar *
+history_path(struct History *history, const gchar *name)
+{
+	return g_build_filename(history->dir, name, NULL);
+}
+
+/* history_record_entry: Fills entry from the i-th record, FALSE when it's corrupted
+ */
+static gboolean
+history_record_entry(struct History *history, guint32 i, struct HistoryEntry *entry)
+{
+	const struct HistoryRecord *record = &history->records[i];
+	guint32 uri                        = GUINT32_FROM_LE(record->uri);
+	guint32 title                      = GUINT32_FROM_LE(record->title);
+	guint64 frecency                   = GUINT64_FROM_LE(record->frecency);
+
+	if(uri >= history->strings_len || title >= history->strings_len) return FALSE;
+
+	entry->uri        = history->strings + uri;
+	entry->title      = title != 0 ? history->strings + title : NULL;
+	entry->visits     = GUINT32_FROM_LE(record->visits);
+	entry->last_visit = GINT64_FROM_LE(record->last_visit);
+	memcpy(&entry->frecency, &frecency, sizeof(entry->frecency));
+
+	return TRUE;
+}
+
+/* history_index_lookup: Record of uri in the index, FALSE when there is none
+ */
+static gboolean
+history_index_lookup(struct History *history, const gchar *uri, struct HistoryEntry *entry)
+{
+	guint64 hash = history_hash(uri);
+	guint32 low  = 0;
+	guint32 high = history->count;
+
+	while(low < high)
+	{
+		guint32 mid = low + (high - low) / 2;
+
+		if(GUINT64_FROM_LE(history->records[mid].hash) < hash)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	// Collisions are next to each other
+	for(; low < history->count && GUINT64_FROM_LE(history->records[low].hash) == hash; low++)
+		if(history_record_entry(history, low, entry) && strcmp(entry->uri, uri) == 0) return TRUE;
+
+	return FALSE;
+}
+
+/* history_map: (Re)loads the index, returns FALSE when it's invalid
+ */
+static gboolean
+history_map(struct History *history)
+{
+	gchar *path = history_path(history, "history.index");
+	GError *err = NULL;
+	GMappedFile *mapped;
+	const gchar *contents;
+	gsize len;
+	guint32 count;
+	guint64 generation;
+	gsize strings;
+
+	mapped = g_mapped_file_new(path, FALSE, &err);
+	if(mapped == NULL)
+	{
+		gboolean missing = g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+
+		if(!missing)
+			fprintf(stderr,
+			        _("badwolf: Error: Failed opening the history index: %s\n"),
+			        err->message);
+		g_error_free(err);
+		g_free(path);
+		return missing;
+	}
+	g_free(path);
+
+	contents = g_mapped_file_get_contents(mapped);
+	len      = g_mapped_file_get_length(mapped);
+
+	if(len < HISTORY_HEADER_LEN || memcmp(contents, HISTORY_MAGIC, HISTORY_MAGIC_LEN) != 0)
+		goto invalid;
+
+	memcpy(&generation, contents + 8, sizeof(generation));
+	memcpy(&count, contents + 16, sizeof(count));
+	generation = GUINT64_FROM_LE(generation);
+	count      = GUINT32_FROM_LE(count);
+
+	strings = HISTORY_HEADER_LEN + (gsize)count * (sizeof(struct HistoryRecord) + sizeof(guint32));
+	// At least the leading empty string, and the last one being terminated
+	if(strings >= len || contents[len - 1] != '\0') goto invalid;
+
+	if(history->mapped != NULL) g_mapped_file_unref(history->mapped);
+	history->mapped      = mapped;
+	history->records     = (const struct HistoryRecord *)(contents + HISTORY_HEADER_LEN);
+	history->order       = (const guint32 *)(history->records + count);
+	history->strings     = contents + strings;
+	history->strings_len = len - strings;
+	history->count       = count;
+	history->generation  = generation;
+
+	return TRUE;
+
+invalid:
+	fprintf(stderr, _("badwolf: Warning: Corrupted history index, ignoring it\n"));
+	g_mapped_file_unref(mapped);
+	return FALSE;
+}
+
+/* history_replay: Adds the visits of the log to table, unless it's older than generation.
+ * Returns FALSE when the log got ignored.
+ */
+static gboolean
+history_replay(GHashTable *table, const gchar *log, gsize len, guint64 generation)
+{
+	const gchar *end = log + len;
+	const gchar *line;
+	gchar *header_end;
+
+	if(len < strlen(HISTORY_LOG_HEADER) ||
+	   memcmp(log, HISTORY_LOG_HEADER, strlen(HISTORY_LOG_HEADER)) != 0)
+		return FALSE;
+
+	if(g_ascii_strtoull(log + strlen(HISTORY_LOG_HEADER), &header_end, 10) != generation ||
+	   *header_end != '\n')
+		return FALSE;
+
+	for(line = header_end + 1; line < end;)
+	{
+		const gchar *eol = memchr(line, '\n', (gsize)(end - line));
+		gchar **fields;
+		gchar *text;
+
+		// An unterminated line is an interrupted write
+		if(eol == NULL) break;
+
+		text   = g_strndup(line, (gsize)(eol - line));
+		fields = g_strsplit(text, "\t", 3);
+
+		if(g_strv_length(fields) == 3 && fields[1][0] != '\0')
+			history_visits_add(table, fields[1], fields[2], strtoll(fields[0], NULL, 10));
+
+		g_strfreev(fields);
+		g_free(text);
+		line = eol + 1;
+	}
+
+	return TRUE;
+}
+
+static gint
+history_item_frecency_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct HistoryItem *item_a = a;
+	const struct HistoryItem *item_b = b;
+
+	if(item_a->visits->frecency > item_b->visits->frecency) return -1;
+	if(item_a->visits->frecency < item_b->visits->frecency) return 1;
+
+	return 0;
+}
+
+static gint
+history_item_hash_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct HistoryItem *item_a = a;
+	const struct HistoryItem *item_b = b;
+
+	if(item_a->hash < item_b->hash) return -1;
+	if(item_a->hash > item_b->hash) return 1;
+
+	return strcmp(item_a->visits->uri, item_b->visits->uri);
+}
+
+static guint32
+history_put_string(GString *strings, const gchar *string)
+{
+	gsize offset = strings->len;
+
+	g_string_append_len(strings, string, (gssize)strlen(string) + 1);
+
+	return (guint32)offset;
+}
+
+/* history_write_index: Writes the index of the visits in table to path, returns FALSE on failure
+ */
+static gboolean
+history_write_index(const gchar *path, GHashTable *table, guint64 generation)
+{
+	GArray *items    = g_array_new(FALSE, FALSE, sizeof(struct HistoryItem));
+	GArray *records  = g_array_new(FALSE, FALSE, sizeof(struct HistoryRecord));
+	GArray *order    = g_array_new(FALSE, FALSE, sizeof(guint32));
+	GString *strings = g_string_new_len("", 1);
+	guint8 header[HISTORY_HEADER_LEN];
+	GHashTableIter iter;
+	gpointer value;
+	guint32 count;
+	gboolean ok = FALSE;
+	FILE *file;
+
+	g_hash_table_iter_init(&iter, table);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		struct HistoryVisits *visits = value;
+		struct HistoryItem item      = {history_hash(visits->uri), 0, visits};
+
+		// Only title changes of something which isn't in the history anymore
+		if(visits->visits == 0) continue;
+
+		g_array_append_val(items, item);
+	}
+
+	g_array_sort(items, history_item_frecency_cmp);
+	if(items->len > HISTORY_MAX_RECORDS) g_array_set_size(items, HISTORY_MAX_RECORDS);
+	count = items->len;
+
+	for(guint32 i = 0; i < count; i++)
+		g_array_index(items, struct HistoryItem, i).position = i;
+
+	// Frecency order, as positions in the hash-sorted records
+	g_array_sort(items, history_item_hash_cmp);
+	g_array_set_size(order, count);
+	for(guint32 i = 0; i < count; i++)
+	{
+		struct HistoryItem *item = &g_array_index(items, struct HistoryItem, i);
+		struct HistoryRecord record;
+		guint64 frecency;
+
+		memcpy(&frecency, &item->visits->frecency, sizeof(frecency));
+
+		record.hash       = GUINT64_TO_LE(item->hash);
+		record.last_visit = GINT64_TO_LE(item->visits->last_visit);
+		record.frecency   = GUINT64_TO_LE(frecency);
+		record.visits     = GUINT32_TO_LE(item->visits->visits);
+		record.uri        = GUINT32_TO_LE(history_put_string(strings, item->visits->uri));
+		record.title      = 0;
+		record.padding    = 0;
+		if(item->visits->title != NULL && item->visits->title[0] != '\0')
+			record.title = GUINT32_TO_LE(history_put_string(strings, item->visits->title));
+
+		g_array_append_val(records, record);
+		g_array_index(order, guint32, item->position) = GUINT32_TO_LE(i);
+	}
+
+	if(strings->len > G_MAXUINT32) goto clean;
+
+	generation = GUINT64_TO_LE(generation);
+	count      = GUINT32_TO_LE(count);
+	memset(header, 0, sizeof(header));
+	memcpy(header, HISTORY_MAGIC, HISTORY_MAGIC_LEN);
+	memcpy(header + 8, &generation, sizeof(generation));
+	memcpy(header + 16, &count, sizeof(count));
+
+	file = g_fopen(path, "wb");
+	if(file == NULL) goto clean;
+
+	ok = fwrite(header, sizeof(header), 1, file) == 1;
+	if(ok && records->len > 0)
+		ok = fwrite(records->data, records->len * sizeof(struct HistoryRecord), 1, file) == 1 &&
+		     fwrite(order->data, order->len * sizeof(guint32), 1, file) == 1;
+	if(ok) ok = fwrite(strings->str, strings->len, 1, file) == 1;
+	if(fclose(file) != 0) ok = FALSE;
+
+clean:
+	g_string_free(strings, TRUE);
+	g_array_free(order, TRUE);
+	g_array_free(records, TRUE);
+	g_array_free(items, TRUE);
+
+	return ok;
+}
+
+/* history_writer_compact: Puts the log into a new index, then removes it.
+ * Reads everything back from disk, so it only needs the paths.
+ */
+static gboolean
+history_writer_compact(struct History *history)
+{
+	gchar *index_path      = history_path(history, "history.index");
+	gchar *new_path        = history_path(history, "history.index~");
+	gchar *log_path        = history_path(history, "history.log");
+	GHashTable *table      = history_visits_table_new();
+	struct History current = {.dir = history->dir}; /* only for reading the current index */
+	gchar *log             = NULL;
+	gsize log_len          = 0;
+	gboolean ok            = FALSE;
+
+	history_map(&current);
+	for(guint32 i = 0; i < current.count; i++)
+	{
+		struct HistoryEntry entry;
+		struct HistoryVisits *visits;
+
+		if(!history_record_entry(&current, i, &entry)) continue;
+
+		visits             = history_visits_get(table, entry.uri);
+		visits->title      = g_strdup(entry.title);
+		visits->visits     = entry.visits;
+		visits->last_visit = entry.last_visit;
+		visits->frecency   = entry.frecency;
+	}
+	if(current.mapped != NULL) g_mapped_file_unref(current.mapped);
+
+	if(g_file_get_contents(log_path, &log, &log_len, NULL))
+		history_replay(table, log, log_len, history->log_generation);
+
+	if(!history_write_index(new_path, table, history->log_generation + 1)) goto clean;
+	if(g_rename(new_path, index_path) != 0) goto clean;
+
+	// The log is now older than the index, which is fine even if it doesn't get removed
+	history->log_generation++;
+	g_unlink(log_path);
+	ok = TRUE;
+
+clean:
+	if(!ok)
+		fprintf(stderr,
+		        _("badwolf: Error: Failed compacting the history into '%s': %s\n"),
+		        new_path,
+		        strerror(errno));
+
+	g_free(log);
+	g_hash_table_destroy(table);
+	g_free(log_path);
+	g_free(new_path);
+	g_free(index_path);
+
+	return ok;
+}
+
+static gboolean
+historyCb_compacted(gpointer user_data)
+{
+	struct History *history = user_data;
+
+	if(history->compact_failed || !history_map(history))
+		history_merge_table(history->tail, history->compacting);
+
+	g_hash_table_destroy(history->compacting);
+	history->compacting = NULL;
+
+	return G_SOURCE_REMOVE;
+}
+
+/* historyCb_write: Runs in the writer thread
+ */
+static void
+historyCb_write(gpointer data, gpointer user_data)
+{
+	struct HistoryJob *job  = data;
+	struct History *history = user_data;
+	guint64 generation      = history->log_generation;
+	gchar *path;
+	FILE *file;
+	gboolean ok;
+
+	if(job->compact)
+	{
+		history->compact_failed = !history_writer_compact(history);
+		g_idle_add(historyCb_compacted, history);
+		g_free(job);
+		return;
+	}
+
+	path = history_path(history, "history.log");
+	file = g_fopen(path, "ab");
+	ok   = file != NULL;
+
+	if(ok && fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0)
+		ok = fprintf(file, HISTORY_LOG_HEADER "%" G_GUINT64_FORMAT "\n", generation) > 0;
+
+	// A single write for the whole batch
+	if(ok) ok = fwrite(job->data->str, job->data->len, 1, file) == 1;
+	if(file != NULL && fclose(file) != 0) ok = FALSE;
+
+	if(!ok)
+		fprintf(stderr,
+		        _("badwolf: Error: Failed writing the history to '%s': %s\n"),
+		        path,
+		        strerror(errno));
+
+	g_free(path);
+	g_string_free(job->data, TRUE);
+	g_free(job);
+}
+
+/* history_open: Loads the history stored in dir (created when missing), NULL on failure
+ */
+struct History *
+history_open(const gchar *dir)
+{
+	struct History *history;
+	GMappedFile *log;
+	gchar *log_path;
+
+	if(g_mkdir_with_parents(dir, 0700) != 0)
+	{
+		fprintf(stderr, _("badwolf: Error: Failed creating '%s': %s\n"), dir, strerror(errno));
+		return NULL;
+	}
+
+	history          = g_malloc0(sizeof(struct History));
+	history->dir     = g_strdup(dir);
+	history->tail    = history_visits_table_new();
+	history->pending = g_string_new(NULL);
+
+	history_map(history);
+
+	// Only the visits since the last compaction, the log staying small
+	log_path = history_path(history, "history.log");
+	log      = g_mapped_file_new(log_path, FALSE, NULL);
+	if(log != NULL)
+	{
+		if(history_replay(history->tail,
+		                  g_mapped_file_get_contents(log),
+		                  g_mapped_file_get_length(log),
+		                  history->generation))
+			history->log_size = g_mapped_file_get_length(log);
+		else
+			g_unlink(log_path);
+
+		g_mapped_file_unref(log);
+	}
+	g_free(log_path);
+
+	history->log_generation = history->generation;
+	history->writer         = g_thread_pool_new(historyCb_write, history, 1, FALSE, NULL);
+
+	return history;
+}
+
+/* history_close: Writes what's pending then frees history
+ */
+void
+history_close(struct History *history)
+{
+	history_flush(history);
+	g_thread_pool_free(history->writer, FALSE, TRUE);
+
+	// Compaction results nobody will use anymore
+	while(g_source_remove_by_user_data(history))
+		;
+
+	if(history->compacting != NULL) g_hash_table_destroy(history->compacting);
+	if(history->mapped != NULL) g_mapped_file_unref(history->mapped);
+	g_hash_table_destroy(history->tail);
+	g_string_free(history->pending, TRUE);
+	g_free(history->dir);
+	g_free(history);
+}
+
+static gboolean
+historyCb_flush(gpointer user_data)
+{
+	struct History *history = user_data;
+
+	history->flush_id = 0;
+	history_flush(history);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void
+history_append(struct History *history, const gchar *uri, const gchar *title, gint64 time)
+{
+	gchar *line = g_strdup(title != NULL ? title : "");
+
+	// Keeps it on a single line with 3 fields
+	g_strdelimit(line, "\t\r\n", ' ');
+	g_string_append_printf(history->pending, "%" G_GINT64_FORMAT "\t%s\t%s\n", time, uri, line);
+	g_free(line);
+
+	if(history->flush_id == 0)
+		history->flush_id = g_timeout_add_seconds(HISTORY_FLUSH_INTERVAL, historyCb_flush, history);
+}
+
+/* history_recordable: Whether uri gets in the history, only http(s) ones are,
+ * leaving out local files, data: URIs, about:blank, badwolf: pages, …
+ */
+gboolean
+history_recordable(const gchar *uri)
+{
+	if(g_ascii_strncasecmp(uri, "http://", 7) != 0 && g_ascii_strncasecmp(uri, "https://", 8) != 0)
+		return FALSE;
+
+	// Wouldn't fit in the log
+	return strlen(uri) <= HISTORY_URI_MAX && strpbrk(uri, "\t\r\n") == NULL;
+}
+
+/* history_visit: Counts a visit of uri at time (in seconds since the UNIX epoch),
+ * when it's recordable, see history_recordable()
+ */
+void
+history_visit(struct History *history, const gchar *uri, const gchar *title, gint64 time)
+{
+	if(!history_recordable(uri) || time <= 0) return;
+
+	history_visits_add(history->tail, uri, title, time);
+	history_append(history, uri, title, time);
+}
+
+/* history_set_title: Changes the title of uri, when it's in the history
+ */
+void
+history_set_title(struct History *history, const gchar *uri, const gchar *title)
+{
+	struct HistoryEntry entry;
+
+	if(title == NULL || title[0] == '\0') return;
+	if(!history_lookup(history, uri, &entry) || g_strcmp0(entry.title, title) == 0) return;
+
+	history_visits_add(history->tail, uri, title, 0);
+	history_append(history, uri, title, 0);
+}
+
+/* history_flush: Hands the pending visits over to the writer thread,
+ * compacting the log once it got big enough.
+ */
+void
+history_flush(struct History *history)
+{
+	struct HistoryJob *job;
+
+	if(history->flush_id != 0)
+	{
+		g_source_remove(history->flush_id);
+		history->flush_id = 0;
+	}
+
+	if(history->pending->len == 0) return;
+
+	job          = g_malloc(sizeof(struct HistoryJob));
+	job->compact = FALSE;
+	job->data    = history->pending;
+
+	history->log_size += history->pending->len;
+	history->pending = g_string_new(NULL);
+	g_thread_pool_push(history->writer, job, NULL);
+
+	if(history->log_size >= HISTORY_COMPACT_SIZE) history_compact(history);
+}
+
+/* history_compact: Puts the log into the index, in the writer thread.
+ * The visits stay in memory until the new index gets loaded.
+ */
+void
+history_compact(struct History *history)
+{
+	struct HistoryJob *job;
+
+	if(history->compacting != NULL) return;
+
+	// Would replace the index history_seed() goes through, done once it's over
+	if(history->seeding > 0)
+	{
+		history->compact_deferred = TRUE;
+		return;
+	}
+
+	if(history->pending->len > 0) history_flush(history);
+	// history_flush() can start it
+	if(history->compacting != NULL) return;
+
+	job          = g_malloc(sizeof(struct HistoryJob));
+	job->compact = TRUE;
+	job->data    = NULL;
+
+	history->compacting = history->tail;
+	history->tail       = history_visits_table_new();
+	history->log_size   = 0;
+	g_thread_pool_push(history->writer, job, NULL);
+}
+
+/* history_lookup: What is known of uri, FALSE when it isn't in the history
+ */
+gboolean
+history_lookup(struct History *history, const gchar *uri, struct HistoryEntry *entry)
+{
+	struct HistoryVisits *visits;
+	gboolean found = history_index_lookup(history, uri, entry);
+
+	if(!found) *entry = (struct HistoryEntry){NULL, NULL, 0, 0, 0};
+
+	if(history->compacting != NULL)
+	{
+		visits = g_hash_table_lookup(history->compacting, uri);
+		if(visits != NULL) history_merge(entry, visits);
+		found |= visits != NULL;
+	}
+
+	visits = g_hash_table_lookup(history->tail, uri);
+	if(visits != NULL) history_merge(entry, visits);
+	found |= visits != NULL;
+
+	return found;
+}
+
+static gboolean
+history_in_memory(struct History *history, const gchar *uri)
+{
+	return g_hash_table_contains(history->tail, uri) ||
+	       (history->compacting != NULL && g_hash_table_contains(history->compacting, uri));
+}
+
+/* history_foreach_index: Calls func for (at most max of) the entries of the index
+ * which aren't also in memory, by decreasing frecency
+ */
+static void
+history_foreach_index(struct History *history, guint max, HistoryFunc func, gpointer user_data)
+{
+	struct HistoryEntry entry;
+	guint done = 0;
+
+	for(guint32 i = 0; i < history->count && done < max; i++)
+	{
+		guint32 position = GUINT32_FROM_LE(history->order[i]);
+
+		if(position >= history->count || !history_record_entry(history, position, &entry))
+			continue;
+		if(history_in_memory(history, entry.uri)) continue;
+
+		func(&entry, user_data);
+		done++;
+	}
+}
+
+/* history_foreach_memory: Calls func for the entries with visits not in the index yet
+ */
+static void
+history_foreach_memory(struct History *history, HistoryFunc func, gpointer user_data)
+{
+	struct HistoryEntry entry;
+	GHashTableIter iter;
+	gpointer key;
+
+	if(history->compacting != NULL)
+	{
+		g_hash_table_iter_init(&iter, history->compacting);
+		while(g_hash_table_iter_next(&iter, &key, NULL))
+			if(history_lookup(history, key, &entry) && entry.visits > 0) func(&entry, user_data);
+	}
+
+	g_hash_table_iter_init(&iter, history->tail);
+	while(g_hash_table_iter_next(&iter, &key, NULL))
+	{
+		// Already done with the compacting ones
+		if(history->compacting != NULL && g_hash_table_contains(history->compacting, key))
+			continue;
+
+		if(history_lookup(history, key, &entry) && entry.visits > 0) func(&entry, user_data);
+	}
+}
+
+/* history_foreach: Calls func for every entry, the ones of the index first
+ * by decreasing frecency, then the ones only known in memory.
+ */
+void
+history_foreach(struct History *history, HistoryFunc func, gpointer user_data)
+{
+	history_foreach_index(history, G_MAXUINT, func, user_data);
+	history_foreach_memory(history, func, user_data);
+}
+
+static void
+history_seed_table(GHashTable *table, HistoryFunc func, gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, table);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		const struct HistoryVisits *visits = value;
+		struct HistoryEntry entry;
+
+		// Only got a title
+		if(visits->visits == 0) continue;
+
+		entry = (struct HistoryEntry){
+		    visits->uri, visits->title, visits->visits, visits->last_visit, visits->frecency};
+		func(&entry, user_data);
+	}
+}
+
+/* history_seed: Calls func for a part of the history, so it can be gone through in steps.
+ * The first call (with a zeroed cursor) gives the visits which aren't in the index yet,
+ * then each call gives at most max entries of the index by decreasing frecency,
+ * without their visits in memory so each visit is only given once.
+ * Compactions wait for it to be done, so the index stays the same meanwhile.
+ * Returns FALSE once done.
+ */
+gboolean
+history_seed(struct History *history,
+             struct HistoryCursor *cursor,
+             guint max,
+             HistoryFunc func,
+             gpointer user_data)
+{
+	struct HistoryEntry entry;
+
+	if(cursor->done) return FALSE;
+
+	if(!cursor->started)
+	{
+		// Would change the index while going through it, starting once it's done
+		if(history->compacting != NULL) return TRUE;
+
+		cursor->started  = TRUE;
+		cursor->position = 0;
+		history->seeding++;
+
+		history_seed_table(history->tail, func, user_data);
+	}
+
+	for(guint done = 0; cursor->position < history->count && done < max; cursor->position++)
+	{
+		guint32 position = GUINT32_FROM_LE(history->order[cursor->position]);
+
+		if(position >= history->count || !history_record_entry(history, position, &entry))
+			continue;
+
+		func(&entry, user_data);
+		done++;
+	}
+
+	if(cursor->position < history->count) return TRUE;
+
+	cursor->done = TRUE;
+	if(--history->seeding == 0 && history->compact_deferred)
+	{
+		history->compact_deferred = FALSE;
+		history_compact(history);
+	}
+
+	return FALSE;
+}
+
+static gint
+history_entry_frecency_cmp(gconstpointer a, gconstpointer b)
+{
+	const struct HistoryEntry *entry_a = a;
+	const struct HistoryEntry *entry_b = b;
+
+	if(entry_a->frecency > entry_b->frecency) return -1;
+	if(entry_a->frecency < entry_b->frecency) return 1;
+
+	return 0;
+}
+
+static void
+history_top_add(const struct HistoryEntry *entry, gpointer user_data)
+{
+	g_array_append_val((GArray *)user_data, *entry);
+}
+
+/* history_top: The (at most max) struct HistoryEntry with the highest frecency.
+ *
+ * Only looks at the max first ones of the index, the entries with visits in memory
+ * being the only ones which could have changed their order.
+ */
+GArray *
+history_top(struct History *history, guint max)
+{
+	GArray *top = g_array_new(FALSE, FALSE, sizeof(struct HistoryEntry));
+
+	history_foreach_index(history, max, history_top_add, top);
+	history_foreach_memory(history, history_top_add, top);
+
+	g_array_sort(top, history_entry_frecency_cmp);
+	if(top->len > max) g_array_set_size(top, max);
+
+	return top;
+}
@@ -0,0 +1,109 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef HISTORY_H_INCLUDED
+#define HISTORY_H_INCLUDED
+#include <glib.h>
+
+/* History store: visits get appended to a log (history.log), which gets regularly
+ * compacted into a memory-mapped index (history.index) by the writer thread.
+ *
+ * The log starts with a "badwolf-history <generation>\n" line, followed by one line per visit:
+ * time (in seconds since the UNIX epoch, 0 when only the title changed), URI and title,
+ * separated by tabs.
+ *
+ * The index is made of (all integers being little-endian):
+ * - a header: magic (8 bytes), generation (uint64_t), amount of records (uint32_t), padding
+ * - the records, by increasing URI hash, see struct HistoryRecord
+ * - the position of the records by decreasing frecency (uint32_t each)
+ * - the strings, NUL-terminated, starting with an empty one
+ *
+ * The generation counts the compactions, a log older than the index being already in it.
+ */
+
+/* HISTORY_FLUSH_INTERVAL: Seconds during which visits get batched before being written
+ * HISTORY_COMPACT_SIZE: Bytes of log after which it gets compacted into the index
+ * HISTORY_MAX_RECORDS: Records kept by the index, the ones with the lowest frecency being dropped
+ * HISTORY_URI_MAX: Longest URI recorded, longer ones being mostly tracking or generated data
+ */
+#define HISTORY_FLUSH_INTERVAL 5
+#define HISTORY_COMPACT_SIZE (1024 * 1024)
+#define HISTORY_MAX_RECORDS 200000
+#define HISTORY_URI_MAX 2048
+
+struct HistoryRecord
+{
+	guint64 hash;
+	gint64 last_visit;
+	guint64 frecency; /* gdouble bits */
+	guint32 visits;
+	guint32 uri;   /* offset in the strings */
+	guint32 title; /* offset in the strings, 0 when unknown */
+	guint32 padding;
+};
+
+struct HistoryEntry
+{
+	const gchar *uri;
+	const gchar *title; /* NULL when unknown */
+	guint32 visits;
+	gint64 last_visit;
+	gdouble frecency; /* see completion_weight() */
+};
+
+/* struct History: The index, with the visits which aren't in it yet kept in memory.
+ * Entries handed out by it stay valid until the next call changing it.
+ */
+struct History
+{
+	gchar *dir;
+	GMappedFile *mapped; /* NULL when there is no index yet */
+	const struct HistoryRecord *records;
+	const guint32 *order;
+	const gchar *strings;
+	guint32 count;
+	gsize strings_len;
+	guint64 generation;
+
+	GHashTable *tail;       /* URI → visits not in the index yet */
+	GHashTable *compacting; /* same, being put in the index, NULL when not compacting */
+	GString *pending;       /* log lines waiting to be written */
+	gsize log_size;
+	guint flush_id;
+
+	guint seeding;             /* history_seed() in progress, the index can't change meanwhile */
+	gboolean compact_deferred; /* history_compact() got called meanwhile */
+
+	GThreadPool *writer;
+	guint64 log_generation;  /* of the log on disk, only used by the writer */
+	gboolean compact_failed; /* set by the writer before the compaction gets applied */
+};
+
+/* struct HistoryCursor: Where history_seed() is at, zeroed to start from the beginning
+ */
+struct HistoryCursor
+{
+	gboolean started;
+	gboolean done;
+	guint32 position; /* in the order of the index */
+};
+
+typedef void (*HistoryFunc)(const struct HistoryEntry *entry, gpointer user_data);
+
+guint64 history_hash(const gchar *uri);
+gboolean history_recordable(const gchar *uri);
+struct History *history_open(const gchar *dir);
+void history_close(struct History *history);
+void history_visit(struct History *history, const gchar *uri, const gchar *title, gint64 time);
+void history_set_title(struct History *history, const gchar *uri, const gchar *title);
+void history_flush(struct History *history);
+void history_compact(struct History *history);
+gboolean history_lookup(struct History *history, const gchar *uri, struct HistoryEntry *entry);
+GArray *history_top(struct History *history, guint max);
+void history_foreach(struct History *history, HistoryFunc func, gpointer user_data);
+gboolean history_seed(struct History *history,
+                      struct HistoryCursor *cursor,
+                      guint max,
+                      HistoryFunc func,
+                      gpointer user_data);
+#endif /* HISTORY_H_INCLUDED */
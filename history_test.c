@@ -0,0 +1,262 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "history.h"
+
+#include <glib.h>
+#include <glib/gstdio.h> /* g_unlink(), g_rmdir() */
+#include <string.h>      /* memcpy() */
+
+#define T1 1600000000
+#define T2 (T1 + 3600)
+
+static void
+history_hash_test(void)
+{
+	struct
+	{
+		const gchar *uri;
+		guint64 expect;
+	} cases[] = {
+	    //
+	    {"", G_GUINT64_CONSTANT(0xcbf29ce484222325)},
+	    {"a", G_GUINT64_CONSTANT(0xaf63dc4c8601ec8c)},
+	    {"foobar", G_GUINT64_CONSTANT(0x85944171f73967e8)} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		guint64 got = history_hash(cases[i].uri);
+
+		g_info("history_hash(\"%s\")", cases[i].uri);
+
+		if(got != cases[i].expect)
+		{
+			g_error("expected: %" G_GINT64_MODIFIER "x, got: %" G_GINT64_MODIFIER "x",
+			        cases[i].expect,
+			        got);
+		}
+	}
+}
+
+static void
+history_expect(struct History *history, const gchar *uri, guint32 visits, const gchar *title)
+{
+	struct HistoryEntry entry;
+
+	g_info("history_lookup(\"%s\")", uri);
+
+	if(!history_lookup(history, uri, &entry))
+	{
+		if(visits != 0) g_error("expected: %u visits, got: none", visits);
+		return;
+	}
+
+	if(entry.visits != visits) g_error("expected: %u visits, got: %u", visits, entry.visits);
+	g_assert_cmpstr(entry.uri, ==, uri);
+	g_assert_cmpstr(entry.title, ==, title);
+}
+
+static void
+history_recordable_test(void)
+{
+	gchar *long_uri = g_strnfill(HISTORY_URI_MAX, 'a');
+	struct
+	{
+		const gchar *uri;
+		gboolean expect;
+	} cases[] = {
+	    //
+	    {"https://example.org/", TRUE},
+	    {"HTTP://example.org/", TRUE},
+	    {"http://example.org/c\td", FALSE},
+	    {"", FALSE},
+	    {"about:blank", FALSE},
+	    {"badwolf:perf", FALSE},
+	    {"data:text/html,<p>Hello</p>", FALSE},
+	    {"file:///etc/passwd", FALSE},
+	    {"httpsx://example.org/", FALSE} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		g_info("history_recordable(\"%s\")", cases[i].uri);
+
+		if(history_recordable(cases[i].uri) != cases[i].expect)
+			g_error("expected: %d, got: %d", cases[i].expect, !cases[i].expect);
+	}
+
+	// Exactly HISTORY_URI_MAX bytes, then one more
+	memcpy(long_uri, "https://", 8);
+	g_assert_true(history_recordable(long_uri));
+	g_free(long_uri);
+
+	long_uri = g_strnfill(HISTORY_URI_MAX + 1, 'a');
+	memcpy(long_uri, "https://", 8);
+	g_assert_false(history_recordable(long_uri));
+	g_free(long_uri);
+}
+
+static void
+history_store_test(void)
+{
+	gchar *dir      = g_dir_make_tmp("badwolf-history_test-XXXXXX", NULL);
+	gchar *log_path = g_build_filename(dir, "history.log", NULL);
+	gchar *index    = g_build_filename(dir, "history.index", NULL);
+	struct History *history;
+	GArray *top;
+
+	g_assert_nonnull(dir);
+
+	// Only in the log
+	history = history_open(dir);
+	g_assert_nonnull(history);
+	history_visit(history, "https://example.org/a", NULL, T1);
+	history_visit(history, "https://example.org/a", NULL, T2);
+	history_visit(history, "https://example.org/b", "B", T1);
+	history_visit(history, "https://example.org/c\td", "Nope", T1);
+	history_set_title(history, "https://example.org/a", "A\tnew");
+	history_set_title(history, "https://example.org/unknown", "Unknown");
+	history_expect(history, "https://example.org/a", 2, "A\tnew");
+	history_close(history);
+
+	history = history_open(dir);
+	g_assert_null(history->mapped);
+	history_expect(history, "https://example.org/a", 2, "A new");
+	history_expect(history, "https://example.org/b", 1, "B");
+	history_expect(history, "https://example.org/c\td", 0, NULL);
+	history_expect(history, "https://example.org/unknown", 0, NULL);
+
+	top = history_top(history, 1);
+	g_assert_cmpuint(top->len, ==, 1);
+	g_assert_cmpstr(g_array_index(top, struct HistoryEntry, 0).uri, ==, "https://example.org/a");
+	g_array_free(top, TRUE);
+
+	history_compact(history);
+	history_close(history);
+
+	// Only in the index
+	g_assert_false(g_file_test(log_path, G_FILE_TEST_EXISTS));
+	history = history_open(dir);
+	g_assert_nonnull(history->mapped);
+	g_assert_cmpuint(history->count, ==, 2);
+	g_assert_cmpuint(history->generation, ==, 1);
+	history_expect(history, "https://example.org/a", 2, "A new");
+	history_expect(history, "https://example.org/b", 1, "B");
+
+	// Both
+	history_visit(history, "https://example.org/b", NULL, T2);
+	history_visit(history, "https://example.org/b", NULL, T2);
+	history_visit(history, "https://example.org/e", "E", T1);
+	history_expect(history, "https://example.org/b", 3, "B");
+
+	top = history_top(history, 10);
+	g_assert_cmpuint(top->len, ==, 3);
+	g_assert_cmpstr(g_array_index(top, struct HistoryEntry, 0).uri, ==, "https://example.org/b");
+	g_assert_cmpstr(g_array_index(top, struct HistoryEntry, 1).uri, ==, "https://example.org/a");
+	g_assert_cmpstr(g_array_index(top, struct HistoryEntry, 2).uri, ==, "https://example.org/e");
+	g_array_free(top, TRUE);
+	history_close(history);
+
+	history = history_open(dir);
+	history_expect(history, "https://example.org/b", 3, "B");
+	history_expect(history, "https://example.org/e", 1, "E");
+	history_close(history);
+
+	// A log already compacted, left by an interrupted compaction
+	g_assert_true(g_file_set_contents(
+	    log_path, "badwolf-history 0\n1600000000\thttps://example.org/a\t\n", -1, NULL));
+	history = history_open(dir);
+	history_expect(history, "https://example.org/a", 2, "A new");
+	history_close(history);
+	g_assert_false(g_file_test(log_path, G_FILE_TEST_EXISTS));
+
+	g_unlink(index);
+	g_rmdir(dir);
+	g_free(index);
+	g_free(log_path);
+	g_free(dir);
+}
+
+static void
+history_seedCb_count(const struct HistoryEntry *entry, gpointer user_data)
+{
+	GHashTable *seen = user_data;
+
+	g_hash_table_insert(seen,
+	                    g_strdup(entry->uri),
+	                    GUINT_TO_POINTER(GPOINTER_TO_UINT(g_hash_table_lookup(seen, entry->uri)) +
+	                                     entry->visits));
+}
+
+static void
+history_seed_test(void)
+{
+	gchar *dir                  = g_dir_make_tmp("badwolf-history_test-XXXXXX", NULL);
+	gchar *log_path             = g_build_filename(dir, "history.log", NULL);
+	gchar *index                = g_build_filename(dir, "history.index", NULL);
+	GHashTable *seen            = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	struct HistoryCursor cursor = {FALSE, FALSE, 0};
+	struct History *history;
+	gint64 end;
+
+	history = history_open(dir);
+	history_visit(history, "https://example.org/a", NULL, T1);
+	history_visit(history, "https://example.org/a", NULL, T2);
+	history_visit(history, "https://example.org/b", NULL, T1);
+	history_compact(history);
+	history_close(history);
+
+	// b is both in the index and in memory
+	history = history_open(dir);
+	g_assert_cmpuint(history->count, ==, 2);
+	history_visit(history, "https://example.org/b", NULL, T2);
+	history_visit(history, "https://example.org/e", NULL, T1);
+
+	// Memory then the first entry of the index, then the second one
+	g_assert_true(history_seed(history, &cursor, 1, history_seedCb_count, seen));
+	g_assert_cmpuint(g_hash_table_size(seen), ==, 3);
+
+	// Waits for the seed to be done instead of replacing the index under it
+	history_compact(history);
+	g_assert_null(history->compacting);
+	g_assert_true(history->compact_deferred);
+
+	g_assert_false(history_seed(history, &cursor, 1, history_seedCb_count, seen));
+	g_assert_nonnull(history->compacting);
+	g_assert_false(history_seed(history, &cursor, 1, history_seedCb_count, seen));
+
+	// Each visit given once
+	g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "https://example.org/a")), ==, 2);
+	g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "https://example.org/b")), ==, 2);
+	g_assert_cmpuint(GPOINTER_TO_UINT(g_hash_table_lookup(seen, "https://example.org/e")), ==, 1);
+
+	end = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+	while(history->compacting != NULL && g_get_monotonic_time() < end)
+		g_main_context_iteration(NULL, TRUE);
+	g_assert_cmpuint(history->generation, ==, 2);
+	g_assert_cmpuint(history->count, ==, 3);
+	history_close(history);
+
+	g_hash_table_destroy(seen);
+	g_unlink(log_path);
+	g_unlink(index);
+	g_rmdir(dir);
+	g_free(index);
+	g_free(log_path);
+	g_free(dir);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/history_hash/test", history_hash_test);
+	g_test_add_func("/history_recordable/test", history_recordable_test);
+	g_test_add_func("/history_store/test", history_store_test);
+	g_test_add_func("/history_seed/test", history_seed_test);
+
+	return g_test_run();
+}
@@ -5,6 +5,8 @@
 #include "keybindings.h"
 
 #include "badwolf.h"
+#include "hibernate.h"
+#include "trace.h"
 
 #include <glib/gi18n.h> /* _() */
 
@@ -64,7 +66,7 @@ toggle_caret_browsing(WebKitWebView *webView)
 	webkit_web_view_set_settings(webView, settings);
 }
 
-/* commonCb_key_press_event: Global callback for keybindings
+/* common_key_press_event: Global keybindings, see commonCb_key_press_event()
  *
  * Theses shortcuts should be avoided as much as possible:
  * - Single key shortcuts (ie. backspace and space)
@@ -73,8 +75,8 @@ toggle_caret_browsing(WebKitWebView *webView)
  *
  * loosely follows https://developer.gnome.org/hig/guidelines/keyboard.html
  */
-gboolean
-commonCb_key_press_event(struct Window *window, GdkEvent *event, struct Client *browser)
+static gboolean
+common_key_press_event(struct Window *window, GdkEvent *event, struct Client *browser)
 {
 	GtkNotebook *notebook = GTK_NOTEBOOK(window->notebook);
 
@@ -88,8 +90,8 @@ commonCb_key_press_event(struct Window *window, GdkEvent *event, struct Client *
 				webkit_web_view_try_close(browser->webView);
 				return TRUE;
 			case GDK_KEY_w:
-                gtk_widget_destroy(GTK_WIDGET(browser->box));
-                return TRUE;
+				gtk_widget_destroy(GTK_WIDGET(browser->box));
+				return TRUE;
 			case GDK_KEY_r:
 				if(((GdkEventKey *)event)->state & GDK_SHIFT_MASK)
 					webkit_web_view_reload_bypass_cache(browser->webView);
@@ -116,6 +118,13 @@ commonCb_key_press_event(struct Window *window, GdkEvent *event, struct Client *
 				webkit_print_operation_run_dialog(webkit_print_operation_new(browser->webView),
 				                                  GTK_WINDOW(browser->window->main_window));
 				return TRUE;
+			case GDK_KEY_H:
+				badwolf_hibernate_background_tabs(window, 0);
+				return TRUE;
+			case GDK_KEY_T:
+				badwolf_new_tab(
+				    notebook, new_container_browser(window, NULL, browser->container), TRUE);
+				return TRUE;
 			}
 		}
 		else
@@ -188,14 +197,31 @@ commonCb_key_press_event(struct Window *window, GdkEvent *event, struct Client *
 	return FALSE;
 }
 
+gboolean
+commonCb_key_press_event(struct Window *window, GdkEvent *event, struct Client *browser)
+{
+	gboolean ret;
+
+	TRACE_BEGIN(__func__);
+
+	ret = common_key_press_event(window, event, browser);
+
+	TRACE_END(__func__);
+	return ret;
+}
+
 gboolean
 WebViewCb_key_press_event(WebKitWebView *UNUSED(webView), GdkEvent *event, gpointer user_data)
 {
 	struct Client *browser = (struct Client *)user_data;
+	gboolean ret;
 
-	if(commonCb_key_press_event(browser->window, event, browser)) return TRUE;
+	TRACE_BEGIN(__func__);
 
-	return FALSE;
+	ret = commonCb_key_press_event(browser->window, event, browser);
+
+	TRACE_END(__func__);
+	return ret;
 }
 
 gboolean
@@ -225,7 +251,7 @@ tab_boxCb_button_release_event(GtkWidget *UNUSED(widget), GdkEvent *event, gpoin
 
 	if(((GdkEventButton *)event)->button == GDK_BUTTON_MIDDLE)
 	{
-		webkit_web_view_try_close(browser->webView);
+		badwolf_close_tab(browser);
 		return TRUE;
 	}
 	return FALSE;
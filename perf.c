@@ -0,0 +1,385 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+/* Page-load timings, aggregated per host and shown at badwolf:perf
+ */
+
+#include "perf.h"
+
+#include "config.h"
+
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <stdio.h>      /* fprintf() */
+
+/* Same order as enum perf_metric, the page script posts them under these names */
+static const gchar *perf_metric_names[PERF_METRICS] = {
+    "redirect",
+    "commit",
+    "finish",
+    "ttfb",
+    "dom_content_loaded",
+    "load",
+    "first_paint",
+    "first_contentful_paint",
+};
+
+/* Posted once the page got loaded, paint timings being known by then */
+static const gchar *perf_script =
+    "(function() {"
+    "  function report() {"
+    "    var nav = performance.getEntriesByType('navigation')[0];"
+    "    if(!nav) return;"
+    "    var m = {host: location.host,"
+    "             ttfb: nav.responseStart - nav.startTime,"
+    "             dom_content_loaded: nav.domContentLoadedEventEnd - nav.startTime,"
+    "             load: nav.loadEventEnd - nav.startTime};"
+    "    performance.getEntriesByType('paint').forEach(function(p) {"
+    "      m[p.name.replace(/-/g, '_')] = p.startTime;"
+    "    });"
+    "    window.webkit.messageHandlers.badwolfPerf.postMessage(m);"
+    "  }"
+    "  if(document.readyState === 'complete') setTimeout(report, 0);"
+    "  else window.addEventListener('load', function() { setTimeout(report, 0); });"
+    "})();";
+
+static GHashTable *hosts = NULL; /* host → struct PerfHistogram[PERF_METRICS] */
+
+static gdouble bucket_bounds[PERF_BUCKETS]; /* upper bounds, 2^(i/4) */
+
+static const gdouble *
+perf_bucket_bounds(void)
+{
+	if(bucket_bounds[0] == 0)
+	{
+		bucket_bounds[0] = 1;
+		for(guint i = 1; i < PERF_BUCKETS; i++)
+			bucket_bounds[i] = bucket_bounds[i - 1] * 1.189207115002721; /* 2^(1/4) */
+	}
+
+	return bucket_bounds;
+}
+
+void
+perf_histogram_add(struct PerfHistogram *histogram, gdouble ms)
+{
+	const gdouble *bounds = perf_bucket_bounds();
+	guint bucket          = 0;
+
+	while(bucket < PERF_BUCKETS - 1 && ms > bounds[bucket])
+		bucket++;
+
+	histogram->count++;
+	histogram->buckets[bucket]++;
+}
+
+/* perf_histogram_quantile: Upper bound (in ms) of the bucket holding the q quantile,
+ * -1 when histogram is empty
+ */
+gdouble
+perf_histogram_quantile(const struct PerfHistogram *histogram, gdouble q)
+{
+	const gdouble *bounds = perf_bucket_bounds();
+	gdouble target        = q * histogram->count;
+	guint seen            = 0;
+
+	if(histogram->count == 0) return -1;
+
+	for(guint i = 0; i < PERF_BUCKETS; i++)
+	{
+		seen += histogram->buckets[i];
+		if(seen > 0 && seen >= target) return bounds[i];
+	}
+
+	return bounds[PERF_BUCKETS - 1];
+}
+
+void
+perf_record(const gchar *host, enum perf_metric metric, gdouble ms)
+{
+	struct PerfHistogram *histograms;
+
+	if(hosts == NULL) hosts = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	if(ms < 0 || metric >= PERF_METRICS) return;
+	if(host == NULL || host[0] == '\0') host = "-";
+
+	histograms = g_hash_table_lookup(hosts, host);
+	if(histograms == NULL)
+	{
+		// Bounded, every histogram taking about 2KiB
+		if(g_hash_table_size(hosts) >= BADWOLF_PERF_HOSTS) host = _("(other)");
+
+		histograms = g_hash_table_lookup(hosts, host);
+	}
+	if(histograms == NULL)
+	{
+		histograms = g_malloc0(sizeof(struct PerfHistogram) * PERF_METRICS);
+		g_hash_table_insert(hosts, g_strdup(host), histograms);
+	}
+
+	perf_histogram_add(&histograms[metric], ms);
+}
+
+static GList *
+perf_hosts_sorted(void)
+{
+	if(hosts == NULL) return NULL;
+
+	return g_list_sort(g_hash_table_get_keys(hosts), (GCompareFunc)g_strcmp0);
+}
+
+/* perf_csv_append_field: Appends field quoted as per RFC 4180, hosts coming from URIs
+ */
+static void
+perf_csv_append_field(GString *csv, const gchar *field)
+{
+	g_string_append_c(csv, '"');
+	for(const gchar *c = field; *c != '\0'; c++)
+	{
+		if(*c == '"') g_string_append_c(csv, '"');
+		g_string_append_c(csv, *c);
+	}
+	g_string_append_c(csv, '"');
+}
+
+GString *
+perf_report_csv(void)
+{
+	GString *csv = g_string_new("host,metric,count,p50,p95,p99\n");
+	GList *keys  = perf_hosts_sorted();
+
+	for(GList *key = keys; key != NULL; key = key->next)
+	{
+		struct PerfHistogram *histograms = g_hash_table_lookup(hosts, key->data);
+
+		for(guint metric = 0; metric < PERF_METRICS; metric++)
+		{
+			struct PerfHistogram *histogram = &histograms[metric];
+
+			if(histogram->count == 0) continue;
+
+			perf_csv_append_field(csv, key->data);
+			g_string_append_printf(csv,
+			                       ",%s,%u,%.0f,%.0f,%.0f\n",
+			                       perf_metric_names[metric],
+			                       histogram->count,
+			                       perf_histogram_quantile(histogram, 0.50),
+			                       perf_histogram_quantile(histogram, 0.95),
+			                       perf_histogram_quantile(histogram, 0.99));
+		}
+	}
+
+	g_list_free(keys);
+
+	return csv;
+}
+
+GString *
+perf_report_html(void)
+{
+	GString *html = g_string_new(NULL);
+	GList *keys   = perf_hosts_sorted();
+
+	g_string_append_printf(html,
+	                       "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>%s</title>"
+	                       "<style>td{text-align:right;padding:0 1ex}</style></head><body>"
+	                       "<h1>%s</h1><p>%s <a href=\"badwolf:perf.csv\">CSV</a></p>"
+	                       "<table><tr><th>host</th>",
+	                       _("Page-load timings"),
+	                       _("Page-load timings"),
+	                       _("p50 / p95 / p99 in milliseconds, rounded up by up to 19%."));
+
+	for(guint metric = 0; metric < PERF_METRICS; metric++)
+		g_string_append_printf(html, "<th>%s</th>", perf_metric_names[metric]);
+	g_string_append(html, "</tr>");
+
+	for(GList *key = keys; key != NULL; key = key->next)
+	{
+		struct PerfHistogram *histograms = g_hash_table_lookup(hosts, key->data);
+		gchar *host                      = g_markup_escape_text(key->data, -1);
+
+		g_string_append_printf(html, "<tr><th>%s</th>", host);
+		g_free(host);
+
+		for(guint metric = 0; metric < PERF_METRICS; metric++)
+		{
+			struct PerfHistogram *histogram = &histograms[metric];
+
+			if(histogram->count == 0)
+				g_string_append(html, "<td>-</td>");
+			else
+				g_string_append_printf(html,
+				                       "<td title=\"%u\">%.0f / %.0f / %.0f</td>",
+				                       histogram->count,
+				                       perf_histogram_quantile(histogram, 0.50),
+				                       perf_histogram_quantile(histogram, 0.95),
+				                       perf_histogram_quantile(histogram, 0.99));
+		}
+
+		g_string_append(html, "</tr>");
+	}
+
+	g_string_append(html, "</table></body></html>");
+
+	g_list_free(keys);
+
+	return html;
+}
+
+static gdouble
+perf_elapsed_ms(gint64 start, gint64 end)
+{
+	return (gdouble)(end - start) / 1000;
+}
+
+/* badwolf_perf_load_changed: Records the load-changed timings of browser,
+ * done per host of the page once its load finished
+ */
+void
+badwolf_perf_load_changed(struct Client *browser, WebKitLoadEvent load_event)
+{
+	gint64 now = g_get_monotonic_time();
+	const gchar *uri;
+	GUri *guri;
+
+	switch(load_event)
+	{
+	case WEBKIT_LOAD_STARTED:
+		browser->load_started    = now;
+		browser->load_redirected = 0;
+		browser->load_committed  = 0;
+		return;
+	case WEBKIT_LOAD_REDIRECTED:
+		browser->load_redirected = now;
+		return;
+	case WEBKIT_LOAD_COMMITTED:
+		browser->load_committed = now;
+		return;
+	case WEBKIT_LOAD_FINISHED:
+		break;
+	}
+
+	if(browser->load_started == 0) return;
+
+	uri  = webkit_web_view_get_uri(browser->webView);
+	guri = uri != NULL ? g_uri_parse(uri, G_URI_FLAGS_NONE, NULL) : NULL;
+
+	// Not measuring badwolf:perf itself
+	if(guri != NULL && g_strcmp0(g_uri_get_scheme(guri), "badwolf") != 0)
+	{
+		const gchar *host = g_uri_get_host(guri);
+		gint64 started    = browser->load_started;
+
+		if(host == NULL || host[0] == '\0') host = g_uri_get_scheme(guri);
+
+		if(browser->load_redirected != 0)
+			perf_record(host, PERF_REDIRECT, perf_elapsed_ms(started, browser->load_redirected));
+		if(browser->load_committed != 0)
+			perf_record(host, PERF_COMMIT, perf_elapsed_ms(started, browser->load_committed));
+		perf_record(host, PERF_FINISH, perf_elapsed_ms(started, now));
+	}
+
+	if(guri != NULL) g_uri_unref(guri);
+
+	browser->load_started = 0;
+}
+
+static void
+content_managerCb_perf(WebKitUserContentManager *UNUSED(content_manager),
+                       WebKitJavascriptResult *result,
+                       gpointer UNUSED(user_data))
+{
+	JSCValue *value = webkit_javascript_result_get_js_value(result);
+	JSCValue *property;
+	gchar *host;
+
+	if(!jsc_value_is_object(value)) return;
+
+	property = jsc_value_object_get_property(value, "host");
+	host     = jsc_value_to_string(property);
+	g_object_unref(property);
+
+	for(guint metric = PERF_TTFB; metric < PERF_METRICS; metric++)
+	{
+		property = jsc_value_object_get_property(value, perf_metric_names[metric]);
+
+		if(jsc_value_is_number(property))
+			perf_record(host, (enum perf_metric)metric, jsc_value_to_double(property));
+
+		g_object_unref(property);
+	}
+
+	g_free(host);
+}
+
+/* badwolf_perf_init: Collects the timings known by the pages when BADWOLF_PERF is set,
+ * from PERF_WORLD so pages can't post made-up timings for any host.
+ */
+void
+badwolf_perf_init(struct Window *window)
+{
+	const gchar *env = g_getenv("BADWOLF_PERF");
+	WebKitUserScript *script;
+
+	if(env == NULL || env[0] == '\0') return;
+
+	if(!webkit_user_content_manager_register_script_message_handler_in_world(
+	       window->content_manager, "badwolfPerf", PERF_WORLD))
+	{
+		fprintf(stderr, _("badwolf: Failed to register the page-load timings handler\n"));
+		return;
+	}
+
+	g_signal_connect(window->content_manager,
+	                 "script-message-received::badwolfPerf",
+	                 G_CALLBACK(content_managerCb_perf),
+	                 NULL);
+
+	script = webkit_user_script_new_for_world(perf_script,
+	                                          WEBKIT_USER_CONTENT_INJECT_TOP_FRAME,
+	                                          WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END,
+	                                          PERF_WORLD,
+	                                          NULL,
+	                                          NULL);
+	webkit_user_content_manager_add_script(window->content_manager, script);
+	webkit_user_script_unref(script);
+}
+
+/* badwolf_perf_schemeCb_request: Serves badwolf:perf and its CSV export badwolf:perf.csv
+ */
+void
+badwolf_perf_schemeCb_request(WebKitURISchemeRequest *request, gpointer UNUSED(user_data))
+{
+	const gchar *path = webkit_uri_scheme_request_get_path(request);
+	const gchar *mime;
+	GInputStream *stream;
+	GString *body;
+	gsize length;
+
+	if(g_strcmp0(path, "perf") == 0)
+	{
+		body = perf_report_html();
+		mime = "text/html";
+	}
+	else if(g_strcmp0(path, "perf.csv") == 0)
+	{
+		body = perf_report_csv();
+		mime = "text/csv";
+	}
+	else
+	{
+		GError *err = g_error_new(G_IO_ERROR,
+		                          G_IO_ERROR_NOT_FOUND,
+		                          _("Unknown page: %s"),
+		                          webkit_uri_scheme_request_get_uri(request));
+		webkit_uri_scheme_request_finish_error(request, err);
+		g_error_free(err);
+		return;
+	}
+
+	length = body->len;
+	stream = g_memory_input_stream_new_from_data(g_string_free(body, FALSE), (gssize)length, g_free);
+	webkit_uri_scheme_request_finish(request, stream, (gint64)length, mime);
+	g_object_unref(stream);
+}
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef PERF_H_INCLUDED
+#define PERF_H_INCLUDED
+#include "badwolf.h"
+
+/* PERF_BUCKETS: Histogram buckets, 4 per power of two of milliseconds starting at 1ms,
+ * so quantiles are within 19% of the real value, up to about 65s.
+ */
+#define PERF_BUCKETS 64
+
+/* PERF_WORLD: Script world of the page-load timings, isolated from the page scripts
+ */
+#define PERF_WORLD "badwolf-perf"
+
+enum perf_metric
+{
+	/* From load-changed, relative to WEBKIT_LOAD_STARTED */
+	PERF_REDIRECT,
+	PERF_COMMIT,
+	PERF_FINISH,
+	/* From the page, when BADWOLF_PERF is set */
+	PERF_TTFB,
+	PERF_DOM_CONTENT_LOADED,
+	PERF_LOAD,
+	PERF_FIRST_PAINT,
+	PERF_FIRST_CONTENTFUL_PAINT,
+	PERF_METRICS,
+};
+
+struct PerfHistogram
+{
+	guint count;
+	guint buckets[PERF_BUCKETS];
+};
+
+void perf_histogram_add(struct PerfHistogram *histogram, gdouble ms);
+gdouble perf_histogram_quantile(const struct PerfHistogram *histogram, gdouble q);
+void perf_record(const gchar *host, enum perf_metric metric, gdouble ms);
+GString *perf_report_csv(void);
+GString *perf_report_html(void);
+void badwolf_perf_init(struct Window *window);
+void badwolf_perf_load_changed(struct Client *browser, WebKitLoadEvent load_event);
+void badwolf_perf_schemeCb_request(WebKitURISchemeRequest *request, gpointer user_data);
+#endif /* PERF_H_INCLUDED */
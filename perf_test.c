@@ -0,0 +1,84 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "perf.h"
+
+#include <glib.h>
+
+static void
+perf_histogram_quantile_test(void)
+{
+	struct PerfHistogram histogram = {0, {0}};
+	struct
+	{
+		gdouble q;
+		gdouble min;
+	} cases[] = {
+	    //
+	    {0.00, 1},
+	    {0.01, 1},
+	    {0.50, 50},
+	    {0.95, 95},
+	    {0.99, 99},
+	    {1.00, 100} //
+	};
+
+	g_assert_cmpfloat(perf_histogram_quantile(&histogram, 0.5), ==, -1);
+
+	for(guint ms = 1; ms <= 100; ms++)
+		perf_histogram_add(&histogram, ms);
+
+	g_assert_cmpuint(histogram.count, ==, 100);
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		gdouble got = perf_histogram_quantile(&histogram, cases[i].q);
+
+		g_info("perf_histogram_quantile(%g)", cases[i].q);
+
+		// Bucket upper bounds, at most 2^(1/4) times the real value
+		if(got < cases[i].min || got > cases[i].min * 1.19)
+		{
+			g_error("expected: [%g, %g], got: %g", cases[i].min, cases[i].min * 1.19, got);
+		}
+	}
+
+	// Out of range values end up in the first and last buckets
+	perf_histogram_add(&histogram, 0);
+	perf_histogram_add(&histogram, 1e9);
+	g_assert_cmpuint(histogram.buckets[0], ==, 2);
+	g_assert_cmpuint(histogram.buckets[PERF_BUCKETS - 1], ==, 1);
+}
+
+static void
+perf_report_csv_test(void)
+{
+	GString *csv;
+
+	perf_record("example.org", PERF_FINISH, 100);
+	perf_record("example.org", PERF_FINISH, 100);
+	perf_record("example.org", PERF_TTFB, -1);
+	perf_record("a.example", PERF_COMMIT, 1);
+	perf_record("a\"b,c", PERF_COMMIT, 1);
+
+	csv = perf_report_csv();
+	g_assert_cmpstr(csv->str,
+	                ==,
+	                "host,metric,count,p50,p95,p99\n"
+	                "\"a\"\"b,c\",commit,1,1,1,1\n"
+	                "\"a.example\",commit,1,1,1,1\n"
+	                "\"example.org\",finish,2,108,108,108\n");
+	g_string_free(csv, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/perf_histogram_quantile/test", perf_histogram_quantile_test);
+	g_test_add_func("/perf_report_csv/test", perf_report_csv_test);
+
+	return g_test_run();
+}
@@ -0,0 +1,702 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "session.h"
+
+#include "config.h"
+#include "hibernate.h"
+
+#include <errno.h>       /* errno */
+#include <glib/gi18n.h>  /* _() and other internationalization/localization helpers */
+#include <glib/gstdio.h> /* g_rename() */
+#include <stdio.h>       /* fopen(), fwrite(), fprintf() */
+#include <stdlib.h>      /* getenv() */
+#include <string.h>      /* memcpy(), memcmp(), memchr(), strchr(), strerror() */
+#include <zlib.h>        /* compress2(), uncompress() */
+
+#define SESSION_MAGIC "BWSJ\x01"
+#define SESSION_MAGIC_LEN 5
+#define SESSION_HEADER_LEN 13
+/* SESSION_ZLIB_MAX_RATIO: Most zlib can expand data, bigger sizes being corrupted ones */
+#define SESSION_ZLIB_MAX_RATIO 1032
+
+/* struct SessionRecord: A record waiting to be written, data is never modified once created
+ * so records can be handed over to the writer thread.
+ */
+struct SessionRecord
+{
+	guint8 type;
+	guint32 tab_id;
+	guint32 value;
+	GBytes *data;
+};
+
+struct SessionJob
+{
+	gboolean rewrite; /* Replaces the journal instead of appending to it */
+	GPtrArray *records;
+};
+
+/* struct SessionTab: What is known of a tab, used for compacting the journal and replaying it
+ */
+struct SessionTab
+{
+	guint32 id;
+	gchar *uri;
+	gchar *title;
+	GBytes *state; /* compressed */
+	guint32 state_size;
+};
+
+static struct Window *session_window = NULL; /* NULL when the journal is disabled */
+static gchar *session_path           = NULL;
+static GThreadPool *session_writer   = NULL;
+static GPtrArray *session_pending    = NULL;
+static GHashTable *session_tabs      = NULL; /* tab id → struct SessionTab */
+static GHashTable *session_dirty     = NULL; /* tab id → struct Client, state to be written */
+static guint32 session_next_id       = 1;
+static guint session_flush_id        = 0;
+static gsize session_appended        = 0;
+static gboolean session_restoring    = FALSE;
+
+static struct SessionRecord *
+session_record_new(guint8 type, guint32 tab_id, guint32 value, GBytes *data)
+{
+	struct SessionRecord *record = g_malloc(sizeof(struct SessionRecord));
+
+	record->type   = type;
+	record->tab_id = tab_id;
+	record->value  = value;
+	record->data   = data != NULL ? data : g_bytes_new_static("", 0);
+
+	return record;
+}
+
+static void
+session_record_free(gpointer data)
+{
+	struct SessionRecord *record = data;
+
+	g_bytes_unref(record->data);
+	g_free(record);
+}
+
+static void
+session_tab_free(gpointer data)
+{
+	struct SessionTab *tab = data;
+
+	g_free(tab->uri);
+	g_free(tab->title);
+	if(tab->state != NULL) g_bytes_unref(tab->state);
+	g_free(tab);
+}
+
+static struct SessionTab *
+session_tab_new(guint32 id)
+{
+	struct SessionTab *tab = g_malloc0(sizeof(struct SessionTab));
+
+	tab->id = id;
+
+	return tab;
+}
+
+static GBytes *
+session_compress(GBytes *raw)
+{
+	gsize raw_len;
+	const guint8 *raw_data = g_bytes_get_data(raw, &raw_len);
+	uLongf len             = compressBound((uLong)raw_len);
+	Bytef *buf             = g_malloc(len);
+
+	if(compress2(buf, &len, raw_data, (uLong)raw_len, Z_DEFAULT_COMPRESSION) != Z_OK)
+	{
+		g_free(buf);
+		return NULL;
+	}
+
+	return g_bytes_new_take(g_realloc(buf, len), len);
+}
+
+/* badwolf_session_state_decompress: Reverse of what gets stored in SESSION_STATE records,
+ * returns NULL on failure.
+ */
+WebKitWebViewSessionState *
+badwolf_session_state_decompress(GBytes *data, guint32 size)
+{
+	WebKitWebViewSessionState *state;
+	gsize data_len;
+	const guint8 *compressed = g_bytes_get_data(data, &data_len);
+	uLongf len               = size;
+	Bytef *buf               = NULL;
+	GBytes *raw;
+
+	// The size comes from the journal, not allocating whatever a corrupted one asks for
+	if((guint64)size <= (guint64)data_len * SESSION_ZLIB_MAX_RATIO)
+		buf = g_try_malloc(size > 0 ? size : 1);
+
+	if(buf == NULL || uncompress(buf, &len, compressed, (uLong)data_len) != Z_OK || len != size)
+	{
+		fprintf(stderr, _("badwolf: Warning: Corrupted session state in the session journal\n"));
+		g_free(buf);
+		return NULL;
+	}
+
+	raw   = g_bytes_new_take(buf, len);
+	state = webkit_web_view_session_state_new(raw);
+	g_bytes_unref(raw);
+
+	return state;
+}
+
+static void
+session_put_uint32(guint8 *buf, guint32 value)
+{
+	value = GUINT32_TO_LE(value);
+	memcpy(buf, &value, sizeof(value));
+}
+
+static guint32
+session_get_uint32(const guint8 *buf)
+{
+	guint32 value;
+
+	memcpy(&value, buf, sizeof(value));
+
+	return GUINT32_FROM_LE(value);
+}
+
+/* session_write_records: Writes the records to file, returns FALSE on failure
+ */
+static gboolean
+session_write_records(FILE *file, GPtrArray *records)
+{
+	for(guint i = 0; i < records->len; i++)
+	{
+		struct SessionRecord *record = g_ptr_array_index(records, i);
+		guint8 header[SESSION_HEADER_LEN];
+		gsize len;
+		gconstpointer data = g_bytes_get_data(record->data, &len);
+
+		header[0] = record->type;
+		session_put_uint32(header + 1, record->tab_id);
+		session_put_uint32(header + 5, record->value);
+		session_put_uint32(header + 9, (guint32)len);
+
+		if(fwrite(header, sizeof(header), 1, file) != 1) return FALSE;
+		if(len > 0 && fwrite(data, len, 1, file) != 1) return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* sessionCb_write: Runs in the writer thread, jobs being processed one at a time and in order
+ */
+static void
+sessionCb_write(gpointer data, gpointer UNUSED(user_data))
+{
+	struct SessionJob *job = data;
+	gchar *path = job->rewrite ? g_strconcat(session_path, "~", NULL) : g_strdup(session_path);
+	FILE *file  = fopen(path, job->rewrite ? "wb" : "ab"); // flawfinder: ignore
+	gboolean ok = file != NULL;
+
+	if(ok && fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0)
+		ok = fwrite(SESSION_MAGIC, SESSION_MAGIC_LEN, 1, file) == 1;
+
+	if(ok) ok = session_write_records(file, job->records);
+	if(file != NULL && fclose(file) != 0) ok = FALSE;
+
+	if(ok && job->rewrite && g_rename(path, session_path) != 0) ok = FALSE;
+
+	if(!ok)
+		fprintf(stderr,
+		        _("badwolf: Error: Failed writing the session journal to '%s': %s\n"),
+		        path,
+		        strerror(errno));
+
+	g_free(path);
+	g_ptr_array_free(job->records, TRUE);
+	g_free(job);
+}
+
+static void
+session_push(GPtrArray *records, gboolean rewrite)
+{
+	struct SessionJob *job = g_malloc(sizeof(struct SessionJob));
+
+	job->rewrite = rewrite;
+	job->records = records;
+
+	g_thread_pool_push(session_writer, job, NULL);
+}
+
+/* session_tab_index: Position of browser amongst the tabs, other pages (like downloads) excluded
+ */
+static guint32
+session_tab_index(struct Client *browser)
+{
+	GtkNotebook *notebook = GTK_NOTEBOOK(session_window->notebook);
+	gint page_num         = gtk_notebook_page_num(notebook, browser->box);
+	guint32 index         = 0;
+
+	for(gint i = 0; i < page_num; i++)
+		if(badwolf_page_get_client(gtk_notebook_get_nth_page(notebook, i)) != NULL) index++;
+
+	return index;
+}
+
+static GBytes *
+session_navigate_data(struct SessionTab *tab)
+{
+	gchar *data = g_strconcat(
+	    tab->uri != NULL ? tab->uri : "", "\n", tab->title != NULL ? tab->title : "", NULL);
+
+	return g_bytes_new_take(data, strlen(data));
+}
+
+/* session_compact: Rewrites the journal with only the records needed to restore the current tabs
+ */
+static void
+session_compact(void)
+{
+	GtkNotebook *notebook = GTK_NOTEBOOK(session_window->notebook);
+	GPtrArray *records    = g_ptr_array_new_with_free_func(session_record_free);
+	guint32 index         = 0;
+
+	for(gint i = 0; i < gtk_notebook_get_n_pages(notebook); i++)
+	{
+		struct Client *browser = badwolf_page_get_client(gtk_notebook_get_nth_page(notebook, i));
+		struct SessionTab *tab;
+
+		if(browser == NULL) continue;
+
+		tab = g_hash_table_lookup(session_tabs, GUINT_TO_POINTER(browser->session_id));
+		if(tab == NULL) continue;
+
+		g_ptr_array_add(records, session_record_new(SESSION_OPEN, tab->id, index++, NULL));
+
+		if(tab->uri != NULL || tab->title != NULL)
+		{
+			GBytes *data = session_navigate_data(tab);
+			g_ptr_array_add(records, session_record_new(SESSION_NAVIGATE, tab->id, 0, data));
+		}
+
+		if(tab->state != NULL)
+			g_ptr_array_add(records,
+			                session_record_new(
+			                    SESSION_STATE, tab->id, tab->state_size, g_bytes_ref(tab->state)));
+
+		if(i == gtk_notebook_get_current_page(notebook))
+			g_ptr_array_add(records, session_record_new(SESSION_SELECT, tab->id, 0, NULL));
+	}
+
+	session_appended = 0;
+	session_push(records, TRUE);
+}
+
+/* session_flush: Adds the states of the tabs which navigated since the last flush,
+ * then hands the pending records over to the writer thread.
+ */
+static void
+session_flush(void)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init(&iter, session_dirty);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		struct Client *browser = value;
+		struct SessionTab *tab;
+		GBytes *raw, *compressed;
+		gsize raw_len;
+
+		tab = g_hash_table_lookup(session_tabs, GUINT_TO_POINTER(browser->session_id));
+		if(tab == NULL || browser->session_snapshot == NULL) continue;
+
+		raw        = webkit_web_view_session_state_serialize(browser->session_snapshot);
+		raw_len    = g_bytes_get_size(raw);
+		compressed = session_compress(raw);
+		g_bytes_unref(raw);
+
+		if(compressed == NULL || raw_len > G_MAXUINT32)
+		{
+			if(compressed != NULL) g_bytes_unref(compressed);
+			continue;
+		}
+
+		if(tab->state != NULL) g_bytes_unref(tab->state);
+		tab->state      = compressed;
+		tab->state_size = (guint32)raw_len;
+
+		g_ptr_array_add(
+		    session_pending,
+		    session_record_new(SESSION_STATE, tab->id, tab->state_size, g_bytes_ref(compressed)));
+	}
+	g_hash_table_remove_all(session_dirty);
+
+	if(session_pending->len == 0) return;
+
+	for(guint i = 0; i < session_pending->len; i++)
+	{
+		struct SessionRecord *record = g_ptr_array_index(session_pending, i);
+		session_appended += SESSION_HEADER_LEN + g_bytes_get_size(record->data);
+	}
+
+	session_push(session_pending, FALSE);
+	session_pending = g_ptr_array_new_with_free_func(session_record_free);
+
+	if(session_appended >= BADWOLF_SESSION_COMPACT_SIZE) session_compact();
+}
+
+static gboolean
+sessionCb_flush(gpointer UNUSED(user_data))
+{
+	session_flush_id = 0;
+	session_flush();
+
+	return G_SOURCE_REMOVE;
+}
+
+/* session_append: Queues a record, written in batch every BADWOLF_SESSION_FLUSH_INTERVAL
+ */
+static void
+session_append(guint8 type, guint32 tab_id, guint32 value, GBytes *data)
+{
+	if(session_restoring)
+	{
+		if(data != NULL) g_bytes_unref(data);
+		return;
+	}
+
+	g_ptr_array_add(session_pending, session_record_new(type, tab_id, value, data));
+
+	if(session_flush_id == 0)
+		session_flush_id =
+		    g_timeout_add_seconds(BADWOLF_SESSION_FLUSH_INTERVAL, sessionCb_flush, NULL);
+}
+
+static void
+main_windowCb_destroy(GtkWidget *UNUSED(widget), gpointer UNUSED(user_data))
+{
+	badwolf_session_close();
+}
+
+/* session_replay: Replays the journal into tabs (ordered array of struct SessionTab),
+ * stopping at the first truncated record, which is what a crash while writing leaves.
+ */
+static void
+session_replay(GBytes *journal, GPtrArray *tabs, guint32 *selected)
+{
+	gsize len;
+	const guint8 *data = g_bytes_get_data(journal, &len);
+	gsize offset       = SESSION_MAGIC_LEN;
+
+	if(len < SESSION_MAGIC_LEN || memcmp(data, SESSION_MAGIC, SESSION_MAGIC_LEN) != 0)
+	{
+		fprintf(stderr,
+		        _("badwolf: Warning: '%s' isn't a session journal, ignoring it\n"),
+		        session_path);
+		return;
+	}
+
+	while(len - offset >= SESSION_HEADER_LEN)
+	{
+		guint8 type            = data[offset];
+		guint32 tab_id         = session_get_uint32(data + offset + 1);
+		guint32 value          = session_get_uint32(data + offset + 5);
+		guint32 record_len     = session_get_uint32(data + offset + 9);
+		const gchar *payload   = (const gchar *)data + offset + SESSION_HEADER_LEN;
+		struct SessionTab *tab = NULL;
+		guint index            = 0;
+
+		if(len - offset - SESSION_HEADER_LEN < record_len) break;
+
+		for(guint i = 0; i < tabs->len; i++)
+		{
+			struct SessionTab *t = g_ptr_array_index(tabs, i);
+			if(t->id == tab_id)
+			{
+				tab   = t;
+				index = i;
+				break;
+			}
+		}
+
+		switch(type)
+		{
+		case SESSION_OPEN:
+			if(tab != NULL) g_ptr_array_remove_index(tabs, index);
+			tab      = session_tab_new(tab_id);
+			tab->uri = g_strndup(payload, record_len);
+			g_ptr_array_insert(tabs, (gint)MIN(value, tabs->len), tab);
+			break;
+		case SESSION_CLOSE:
+			if(tab != NULL) g_ptr_array_remove_index(tabs, index);
+			break;
+		case SESSION_NAVIGATE:
+			if(tab != NULL)
+			{
+				const gchar *sep = memchr(payload, '\n', record_len);
+
+				g_free(tab->uri);
+				g_free(tab->title);
+				if(sep != NULL)
+				{
+					tab->uri   = g_strndup(payload, (gsize)(sep - payload));
+					tab->title = g_strndup(sep + 1, record_len - (gsize)(sep - payload) - 1);
+				}
+				else
+				{
+					tab->uri   = g_strndup(payload, record_len);
+					tab->title = NULL;
+				}
+			}
+			break;
+		case SESSION_MOVE:
+			if(tab != NULL)
+			{
+				g_ptr_array_steal_index(tabs, index);
+				g_ptr_array_insert(tabs, (gint)MIN(value, tabs->len), tab);
+			}
+			break;
+		case SESSION_STATE:
+			if(tab != NULL)
+			{
+				if(tab->state != NULL) g_bytes_unref(tab->state);
+				// Slice of the mapped journal, no copy
+				tab->state = g_bytes_new_from_bytes(journal, offset + SESSION_HEADER_LEN, record_len);
+				tab->state_size = value;
+			}
+			break;
+		case SESSION_SELECT:
+			*selected = tab_id;
+			break;
+		default:
+			fprintf(stderr,
+			        _("badwolf: Warning: Unknown record type 0x%02x in the session journal\n"),
+			        type);
+			break;
+		}
+
+		offset += SESSION_HEADER_LEN + record_len;
+	}
+}
+
+/* badwolf_session_restore: Enables the session journal when BADWOLF_SESSION is set,
+ * restoring its tabs (as hibernated ones) into window.
+ *
+ * Returns the amount of restored tabs.
+ */
+guint
+badwolf_session_restore(struct Window *window)
+{
+	const char *name = getenv("BADWOLF_SESSION"); // flawfinder: ignore
+	GPtrArray *tabs;
+	GMappedFile *mapped;
+	GBytes *journal;
+	GError *err        = NULL;
+	guint32 selected   = 0;
+	gint selected_page = -1;
+	gint64 start       = g_get_monotonic_time();
+	guint restored;
+	gchar *dir;
+
+	if(name == NULL || name[0] == '\0') return 0;
+
+	if(strchr(name, G_DIR_SEPARATOR) != NULL || name[0] == '.')
+	{
+		fprintf(stderr, _("badwolf: Warning: Invalid session name '%s', journal disabled\n"), name);
+		return 0;
+	}
+
+	dir = g_build_filename(g_get_user_data_dir(), "badwolf", "sessions", NULL);
+	if(g_mkdir_with_parents(dir, 0700) != 0)
+	{
+		fprintf(stderr,
+		        _("badwolf: Error: Failed creating '%s': %s, journal disabled\n"),
+		        dir,
+		        strerror(errno));
+		g_free(dir);
+		return 0;
+	}
+
+	session_path = g_build_filename(dir, name, NULL);
+	g_free(dir);
+
+	session_window  = window;
+	session_writer  = g_thread_pool_new(sessionCb_write, NULL, 1, FALSE, NULL);
+	session_pending = g_ptr_array_new_with_free_func(session_record_free);
+	session_tabs    = g_hash_table_new_full(NULL, NULL, NULL, session_tab_free);
+	session_dirty   = g_hash_table_new(NULL, NULL);
+
+	// Before the tabs get destroyed, which would otherwise be journaled as closed
+	g_signal_connect(window->main_window, "destroy", G_CALLBACK(main_windowCb_destroy), NULL);
+
+	mapped = g_mapped_file_new(session_path, FALSE, &err);
+	if(mapped == NULL)
+	{
+		if(!g_error_matches(err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			fprintf(stderr,
+			        _("badwolf: Error: Failed opening the session journal: %s\n"),
+			        err->message);
+		g_error_free(err);
+		return 0;
+	}
+
+	journal = g_mapped_file_get_bytes(mapped);
+	g_mapped_file_unref(mapped);
+
+	tabs = g_ptr_array_new_with_free_func(session_tab_free);
+	session_replay(journal, tabs, &selected);
+	g_bytes_unref(journal);
+
+	session_restoring = TRUE;
+	// Tabs get inserted after the current page, which stays the downloads one
+	for(guint i = tabs->len; i > 0; i--)
+	{
+		struct SessionTab *tab = g_ptr_array_index(tabs, i - 1);
+		struct Client *browser = new_lazy_browser(window, tab->uri);
+
+		if(browser == NULL) continue;
+
+		badwolf_tab_hibernate_restored(browser, tab->title, tab->state, tab->state_size);
+		badwolf_new_tab(GTK_NOTEBOOK(window->notebook), browser, FALSE);
+
+		if(tab->id == selected)
+			selected_page = gtk_notebook_page_num(GTK_NOTEBOOK(window->notebook), browser->box);
+	}
+
+	if(selected_page >= 0)
+		gtk_notebook_set_current_page(GTK_NOTEBOOK(window->notebook), selected_page);
+	session_restoring = FALSE;
+
+	session_compact();
+
+	fprintf(stderr,
+	        _("badwolf: Restored %u tabs from session '%s' in %.3fs\n"),
+	        tabs->len,
+	        name,
+	        (double)(g_get_monotonic_time() - start) / G_USEC_PER_SEC);
+
+	restored = tabs->len;
+	g_ptr_array_free(tabs, TRUE);
+
+	return restored;
+}
+
+/* badwolf_session_close: Writes what is pending and disables the journal,
+ * waiting for the writer thread to finish.
+ */
+void
+badwolf_session_close(void)
+{
+	if(session_window == NULL) return;
+
+	if(session_flush_id != 0)
+	{
+		g_source_remove(session_flush_id);
+		session_flush_id = 0;
+	}
+
+	session_flush();
+	session_window = NULL;
+
+	g_thread_pool_free(session_writer, FALSE, TRUE);
+	session_writer = NULL;
+}
+
+/* badwolf_session_path: Path of the session journal, NULL when disabled
+ */
+const gchar *
+badwolf_session_path(void)
+{
+	return session_window != NULL ? session_path : NULL;
+}
+
+void
+badwolf_session_tab_opened(struct Client *browser)
+{
+	struct SessionTab *tab;
+	const gchar *uri;
+
+	if(session_window == NULL) return;
+
+	tab = session_tab_new(session_next_id++);
+	browser->session_id = tab->id;
+
+	if(browser->hibernation != NULL)
+	{
+		uri        = browser->hibernation->uri;
+		tab->title = g_strdup(browser->hibernation->title);
+
+		if(browser->hibernation->session_data != NULL)
+		{
+			tab->state      = g_bytes_ref(browser->hibernation->session_data);
+			tab->state_size = browser->hibernation->session_data_size;
+		}
+	}
+	else
+		uri = gtk_entry_get_text(GTK_ENTRY(browser->location));
+
+	tab->uri = g_strdup(uri != NULL ? uri : "");
+	g_hash_table_insert(session_tabs, GUINT_TO_POINTER(tab->id), tab);
+
+	session_append(
+	    SESSION_OPEN, tab->id, session_tab_index(browser), g_bytes_new(tab->uri, strlen(tab->uri)));
+}
+
+void
+badwolf_session_tab_closed(struct Client *browser)
+{
+	gpointer id = GUINT_TO_POINTER(browser->session_id);
+
+	if(session_window == NULL || browser->session_id == 0) return;
+
+	g_hash_table_remove(session_dirty, id);
+	g_hash_table_remove(session_tabs, id);
+
+	session_append(SESSION_CLOSE, browser->session_id, 0, NULL);
+}
+
+/* badwolf_session_tab_navigated: Journals the current URI and title of browser,
+ * its session state gets added at the next flush.
+ */
+void
+badwolf_session_tab_navigated(struct Client *browser)
+{
+	struct SessionTab *tab;
+	gpointer id = GUINT_TO_POINTER(browser->session_id);
+
+	if(session_window == NULL || browser->webView == NULL) return;
+
+	tab = g_hash_table_lookup(session_tabs, id);
+	if(tab == NULL) return;
+
+	g_free(tab->uri);
+	g_free(tab->title);
+	tab->uri   = g_strdup(webkit_web_view_get_uri(browser->webView));
+	tab->title = g_strdup(webkit_web_view_get_title(browser->webView));
+
+	g_hash_table_insert(session_dirty, id, browser);
+
+	session_append(SESSION_NAVIGATE, tab->id, 0, session_navigate_data(tab));
+}
+
+void
+badwolf_session_tab_moved(struct Client *browser)
+{
+	if(session_window == NULL || browser->session_id == 0) return;
+
+	session_append(SESSION_MOVE, browser->session_id, session_tab_index(browser), NULL);
+}
+
+void
+badwolf_session_tab_selected(struct Client *browser)
+{
+	if(session_window == NULL || browser->session_id == 0) return;
+
+	session_append(SESSION_SELECT, browser->session_id, 0, NULL);
+}
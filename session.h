@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SESSION_H_INCLUDED
+#define SESSION_H_INCLUDED
+#include "badwolf.h"
+
+/* Session journal: append-only log of the tabs, enabled by setting BADWOLF_SESSION
+ *
+ * Every record is made of a 13 bytes header (all integers being little-endian):
+ * - type (uint8_t), see enum session_record
+ * - tab identifier (uint32_t)
+ * - value (uint32_t), meaning depends on the type
+ * - length (uint32_t) of the data following the header
+ */
+enum session_record
+{
+	SESSION_OPEN     = 'O', /* value: position, data: URI */
+	SESSION_CLOSE    = 'C',
+	SESSION_NAVIGATE = 'N', /* data: URI, newline, title */
+	SESSION_MOVE     = 'M', /* value: position */
+	SESSION_STATE    = 'S', /* value: uncompressed size, data: zlib-compressed session state */
+	SESSION_SELECT   = 'T',
+};
+
+guint badwolf_session_restore(struct Window *window);
+void badwolf_session_close(void);
+const gchar *badwolf_session_path(void);
+void badwolf_session_tab_opened(struct Client *browser);
+void badwolf_session_tab_closed(struct Client *browser);
+void badwolf_session_tab_navigated(struct Client *browser);
+void badwolf_session_tab_moved(struct Client *browser);
+void badwolf_session_tab_selected(struct Client *browser);
+WebKitWebViewSessionState *badwolf_session_state_decompress(GBytes *data, guint32 size);
+#endif /* SESSION_H_INCLUDED */
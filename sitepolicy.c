@@ -0,0 +1,324 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "sitepolicy.h"
+
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <stdio.h>      /* fprintf() */
+#include <string.h>     /* strcmp(), strlen() */
+
+/* Keys of the site-policies groups */
+static const struct
+{
+	enum sitepolicy_field field;
+	const gchar *key;
+} sitepolicy_keys[] = {
+    {SITEPOLICY_JAVASCRIPT, "javascript"},
+    {SITEPOLICY_IMAGES, "images"},
+    {SITEPOLICY_AUTOPLAY, "autoplay"},
+    {SITEPOLICY_ZOOM, "zoom"},
+    {SITEPOLICY_USER_AGENT, "user-agent"},
+};
+
+static void
+sitepolicy_node_clear(struct SitePolicyNode *node)
+{
+	if(node->children != NULL) g_hash_table_destroy(node->children);
+	g_free(node->policy.user_agent);
+
+	node->children          = NULL;
+	node->policy.set        = 0;
+	node->policy.user_agent = NULL;
+}
+
+static void
+sitepolicy_node_free(gpointer data)
+{
+	sitepolicy_node_clear(data);
+	g_free(data);
+}
+
+/* sitepolicy_node: Node of domain in the trie, created when missing
+ */
+static struct SitePolicyNode *
+sitepolicy_node(struct SitePolicies *policies, const gchar *domain)
+{
+	struct SitePolicyNode *node = &policies->root;
+	gchar *lower                = g_ascii_strdown(domain, -1);
+	gchar *labels               = lower;
+	gchar *end;
+
+	// *.example.org and .example.org are the same as example.org, which covers its subdomains
+	if(g_str_has_prefix(labels, "*."))
+		labels += 2;
+	else if(labels[0] == '.')
+		labels++;
+
+	if(strcmp(labels, "*") == 0) labels += 1;
+
+	end = labels + strlen(labels);
+	while(end > labels)
+	{
+		gchar *start = end;
+		struct SitePolicyNode *child;
+
+		while(start > labels && start[-1] != '.')
+			start--;
+		*end = '\0';
+
+		if(start < end)
+		{
+			if(node->children == NULL)
+				node->children =
+				    g_hash_table_new_full(g_str_hash, g_str_equal, g_free, sitepolicy_node_free);
+
+			child = g_hash_table_lookup(node->children, start);
+			if(child == NULL)
+			{
+				child = g_new0(struct SitePolicyNode, 1);
+				g_hash_table_insert(node->children, g_strdup(start), child);
+			}
+			node = child;
+		}
+
+		end = start > labels ? start - 1 : labels;
+	}
+
+	g_free(lower);
+
+	return node;
+}
+
+static void
+sitepolicy_read(GKeyFile *file,
+                const gchar *group,
+                enum sitepolicy_field field,
+                const gchar *key,
+                struct SitePolicy *policy)
+{
+	GError *err = NULL;
+	gdouble zoom;
+
+	switch(field)
+	{
+	case SITEPOLICY_JAVASCRIPT:
+		policy->javascript = g_key_file_get_boolean(file, group, key, &err);
+		break;
+	case SITEPOLICY_IMAGES:
+		policy->images = g_key_file_get_boolean(file, group, key, &err);
+		break;
+	case SITEPOLICY_AUTOPLAY:
+		policy->autoplay = g_key_file_get_boolean(file, group, key, &err);
+		break;
+	case SITEPOLICY_ZOOM:
+		zoom = g_key_file_get_double(file, group, key, &err);
+		if(err == NULL && zoom <= 0)
+			g_set_error(&err, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_INVALID_VALUE, _("not positive"));
+		else if(err == NULL)
+			policy->zoom = zoom;
+		break;
+	case SITEPOLICY_USER_AGENT:
+		g_free(policy->user_agent);
+		policy->user_agent = g_key_file_get_string(file, group, key, &err);
+		break;
+	}
+
+	if(err != NULL)
+	{
+		fprintf(stderr,
+		        _("badwolf: Warning: Ignoring %s of [%s] in the site policies: %s\n"),
+		        key,
+		        group,
+		        err->message);
+		g_error_free(err);
+		return;
+	}
+
+	policy->set |= field;
+}
+
+/* sitepolicy_update: Rebuilds the trie from policies->file
+ */
+static void
+sitepolicy_update(struct SitePolicies *policies)
+{
+	gchar **groups = g_key_file_get_groups(policies->file, NULL);
+
+	sitepolicy_node_clear(&policies->root);
+
+	for(gchar **group = groups; *group != NULL; group++)
+	{
+		struct SitePolicyNode *node = sitepolicy_node(policies, *group);
+
+		for(size_t i = 0; i < G_N_ELEMENTS(sitepolicy_keys); i++)
+			if(g_key_file_has_key(policies->file, *group, sitepolicy_keys[i].key, NULL))
+				sitepolicy_read(policies->file,
+				                *group,
+				                sitepolicy_keys[i].field,
+				                sitepolicy_keys[i].key,
+				                &node->policy);
+	}
+
+	g_strfreev(groups);
+}
+
+/* sitepolicy_new: Empty policies, saved to path unless it's NULL
+ */
+struct SitePolicies *
+sitepolicy_new(const gchar *path)
+{
+	struct SitePolicies *policies = g_new0(struct SitePolicies, 1);
+
+	policies->file = g_key_file_new();
+	policies->path = g_strdup(path);
+
+	return policies;
+}
+
+void
+sitepolicy_free(struct SitePolicies *policies)
+{
+	sitepolicy_node_clear(&policies->root);
+	g_key_file_free(policies->file);
+	g_free(policies->path);
+	g_free(policies);
+}
+
+/* sitepolicy_parse: Replaces the policies by the ones of the site-policies data,
+ * invalid values being ignored with a warning
+ */
+gboolean
+sitepolicy_parse(struct SitePolicies *policies, const gchar *data, GError **err)
+{
+	if(!g_key_file_load_from_data(policies->file, data, (gsize)-1, G_KEY_FILE_KEEP_COMMENTS, err))
+		return FALSE;
+
+	sitepolicy_update(policies);
+
+	return TRUE;
+}
+
+/* sitepolicy_load: Same as sitepolicy_parse() but for the file at policies->path
+ */
+gboolean
+sitepolicy_load(struct SitePolicies *policies, GError **err)
+{
+	if(!g_key_file_load_from_file(policies->file, policies->path, G_KEY_FILE_KEEP_COMMENTS, err))
+		return FALSE;
+
+	sitepolicy_update(policies);
+
+	return TRUE;
+}
+
+/* sitepolicy_save: Writes the policies back to policies->path, comments included
+ */
+gboolean
+sitepolicy_save(struct SitePolicies *policies, GError **err)
+{
+	gchar *dir;
+
+	if(policies->path == NULL) return TRUE;
+
+	dir = g_path_get_dirname(policies->path);
+	g_mkdir_with_parents(dir, 0700);
+	g_free(dir);
+
+	return g_key_file_save_to_file(policies->file, policies->path, err);
+}
+
+static void
+sitepolicy_merge(struct SitePolicy *policy, const struct SitePolicy *from)
+{
+	if(from->set & SITEPOLICY_JAVASCRIPT) policy->javascript = from->javascript;
+	if(from->set & SITEPOLICY_IMAGES) policy->images = from->images;
+	if(from->set & SITEPOLICY_AUTOPLAY) policy->autoplay = from->autoplay;
+	if(from->set & SITEPOLICY_ZOOM) policy->zoom = from->zoom;
+	if(from->set & SITEPOLICY_USER_AGENT) policy->user_agent = from->user_agent;
+
+	policy->set |= from->set;
+}
+
+/* sitepolicy_lookup: Applies the policies of host over policy, which should hold the defaults,
+ * the ones of the longest domain suffix winning, without allocating.
+ * host can be NULL, only getting the [*] group.
+ */
+void
+sitepolicy_lookup(struct SitePolicies *policies, const gchar *host, struct SitePolicy *policy)
+{
+	gchar labels[SITEPOLICY_HOST_MAX + 1];
+	struct SitePolicyNode *node = &policies->root;
+	gsize end                   = host != NULL ? strlen(host) : 0;
+
+	policy->set = 0;
+	sitepolicy_merge(policy, &node->policy);
+
+	if(end == 0 || end > SITEPOLICY_HOST_MAX) return;
+
+	// Lowercased copy, which gets cut in labels from the end
+	for(gsize i = 0; i < end; i++)
+		labels[i] = g_ascii_tolower(host[i]);
+	if(labels[end - 1] == '.') end--;
+
+	while(end > 0 && node->children != NULL)
+	{
+		gsize start = end;
+
+		while(start > 0 && labels[start - 1] != '.')
+			start--;
+		labels[end] = '\0';
+
+		node = g_hash_table_lookup(node->children, labels + start);
+		if(node == NULL) return;
+
+		sitepolicy_merge(policy, &node->policy);
+
+		if(start == 0) return;
+		end = start - 1;
+	}
+}
+
+/* sitepolicy_lookup_uri: Same as sitepolicy_lookup() but for the host of uri,
+ * which can be NULL or have none (like about:blank)
+ */
+void
+sitepolicy_lookup_uri(struct SitePolicies *policies, const gchar *uri, struct SitePolicy *policy)
+{
+	GUri *guri = uri != NULL ? g_uri_parse(uri, G_URI_FLAGS_NONE, NULL) : NULL;
+
+	sitepolicy_lookup(policies, guri != NULL ? g_uri_get_host(guri) : NULL, policy);
+
+	if(guri != NULL) g_uri_unref(guri);
+}
+
+/* sitepolicy_set_boolean: Sets javascript, images or autoplay in the policy of domain,
+ * as done by the toolbar toggles, see sitepolicy_save()
+ */
+void
+sitepolicy_set_boolean(struct SitePolicies *policies,
+                       const gchar *domain,
+                       enum sitepolicy_field field,
+                       gboolean value)
+{
+	struct SitePolicyNode *node;
+
+	// Other fields only come from the file
+	if(field != SITEPOLICY_JAVASCRIPT && field != SITEPOLICY_IMAGES && field != SITEPOLICY_AUTOPLAY)
+		return;
+
+	node = sitepolicy_node(policies, domain);
+
+	for(size_t i = 0; i < G_N_ELEMENTS(sitepolicy_keys); i++)
+		if(sitepolicy_keys[i].field == field)
+			g_key_file_set_boolean(policies->file, domain, sitepolicy_keys[i].key, value);
+
+	if(field == SITEPOLICY_JAVASCRIPT)
+		node->policy.javascript = value;
+	else if(field == SITEPOLICY_IMAGES)
+		node->policy.images = value;
+	else
+		node->policy.autoplay = value;
+
+	node->policy.set |= field;
+}
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SITEPOLICY_H_INCLUDED
+#define SITEPOLICY_H_INCLUDED
+#include <glib.h>
+
+/* SITEPOLICY_HOST_MAX: Longest hostname looked up, DNS names being at most 253 bytes
+ */
+#define SITEPOLICY_HOST_MAX 255
+
+enum sitepolicy_field
+{
+	SITEPOLICY_JAVASCRIPT = 1 << 0,
+	SITEPOLICY_IMAGES     = 1 << 1,
+	SITEPOLICY_AUTOPLAY   = 1 << 2,
+	SITEPOLICY_ZOOM       = 1 << 3,
+	SITEPOLICY_USER_AGENT = 1 << 4,
+};
+
+struct SitePolicy
+{
+	guint set; /* enum sitepolicy_field of the fields given by a policy */
+	gboolean javascript;
+	gboolean images;
+	gboolean autoplay;
+	gdouble zoom;
+	gchar *user_agent; /* owned by struct SitePolicies, NULL for WebKit's default */
+};
+
+struct SitePolicyNode
+{
+	GHashTable *children; /* label → struct SitePolicyNode, NULL when there is none */
+	struct SitePolicy policy;
+};
+
+/* struct SitePolicies: Policies of the groups of the site-policies file,
+ * in a trie of the labels of their domain starting from the top-level one,
+ * the [*] group being at the root.
+ */
+struct SitePolicies
+{
+	struct SitePolicyNode root;
+	GKeyFile *file;
+	gchar *path; /* NULL when it isn't saved */
+};
+
+struct SitePolicies *sitepolicy_new(const gchar *path);
+void sitepolicy_free(struct SitePolicies *policies);
+gboolean sitepolicy_parse(struct SitePolicies *policies, const gchar *data, GError **err);
+gboolean sitepolicy_load(struct SitePolicies *policies, GError **err);
+gboolean sitepolicy_save(struct SitePolicies *policies, GError **err);
+void sitepolicy_lookup(struct SitePolicies *policies, const gchar *host, struct SitePolicy *policy);
+void sitepolicy_lookup_uri(struct SitePolicies *policies, const gchar *uri, struct SitePolicy *policy);
+void sitepolicy_set_boolean(struct SitePolicies *policies,
+                            const gchar *domain,
+                            enum sitepolicy_field field,
+                            gboolean value);
+#endif /* SITEPOLICY_H_INCLUDED */
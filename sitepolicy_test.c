@@ -0,0 +1,195 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "sitepolicy.h"
+
+#include <glib.h>
+#include <glib/gstdio.h> /* g_unlink(), g_rmdir() */
+
+static const gchar *policies_data = "# Defaults\n"
+                                    "[*]\n"
+                                    "autoplay=false\n"
+                                    "\n"
+                                    "[example.org]\n"
+                                    "javascript=false\n"
+                                    "zoom=1.5\n"
+                                    "\n"
+                                    "[www.example.org]\n"
+                                    "javascript=true\n"
+                                    "\n"
+                                    "[*.ads.example]\n"
+                                    "images=false\n"
+                                    "user-agent=Test/1.0\n"
+                                    "\n"
+                                    "[broken.example]\n"
+                                    "javascript=maybe\n"
+                                    "zoom=-1\n";
+
+static const struct SitePolicy defaults = {0, TRUE, TRUE, TRUE, 1.0, NULL};
+
+static void
+sitepolicy_lookup_test(void)
+{
+	struct SitePolicies *policies = sitepolicy_new(NULL);
+	GError *err                   = NULL;
+
+	struct
+	{
+		const gchar *host;
+		guint set;
+		gboolean javascript;
+		gboolean images;
+		gdouble zoom;
+		const gchar *user_agent;
+	} cases[] = {
+	    //
+	    {NULL, SITEPOLICY_AUTOPLAY, TRUE, TRUE, 1.0, NULL},
+	    {"", SITEPOLICY_AUTOPLAY, TRUE, TRUE, 1.0, NULL},
+	    {"example.org",
+	     SITEPOLICY_AUTOPLAY | SITEPOLICY_JAVASCRIPT | SITEPOLICY_ZOOM,
+	     FALSE,
+	     TRUE,
+	     1.5,
+	     NULL},
+	    {"WWW.Example.org.",
+	     SITEPOLICY_AUTOPLAY | SITEPOLICY_JAVASCRIPT | SITEPOLICY_ZOOM,
+	     TRUE,
+	     TRUE,
+	     1.5,
+	     NULL},
+	    {"a.b.example.org",
+	     SITEPOLICY_AUTOPLAY | SITEPOLICY_JAVASCRIPT | SITEPOLICY_ZOOM,
+	     FALSE,
+	     TRUE,
+	     1.5,
+	     NULL},
+	    {"notexample.org", SITEPOLICY_AUTOPLAY, TRUE, TRUE, 1.0, NULL},
+	    {"org", SITEPOLICY_AUTOPLAY, TRUE, TRUE, 1.0, NULL},
+	    {"x.ads.example",
+	     SITEPOLICY_AUTOPLAY | SITEPOLICY_IMAGES | SITEPOLICY_USER_AGENT,
+	     TRUE,
+	     FALSE,
+	     1.0,
+	     "Test/1.0"},
+	    {"broken.example", SITEPOLICY_AUTOPLAY, TRUE, TRUE, 1.0, NULL} //
+	};
+
+	g_assert_true(sitepolicy_parse(policies, policies_data, &err));
+	g_assert_no_error(err);
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		struct SitePolicy got = defaults;
+
+		g_info("sitepolicy_lookup(\"%s\")", cases[i].host);
+
+		sitepolicy_lookup(policies, cases[i].host, &got);
+
+		if(got.set != cases[i].set) g_error("expected: set %x, got: %x", cases[i].set, got.set);
+		g_assert_false(got.autoplay);
+		g_assert_cmpint(got.javascript, ==, cases[i].javascript);
+		g_assert_cmpint(got.images, ==, cases[i].images);
+		g_assert_cmpfloat(got.zoom, ==, cases[i].zoom);
+		g_assert_cmpstr(got.user_agent, ==, cases[i].user_agent);
+	}
+
+	g_assert_false(sitepolicy_parse(policies, "[unclosed\n", &err));
+	g_assert_error(err, G_KEY_FILE_ERROR, G_KEY_FILE_ERROR_PARSE);
+	g_clear_error(&err);
+
+	sitepolicy_free(policies);
+}
+
+static void
+sitepolicy_lookup_uri_test(void)
+{
+	struct SitePolicies *policies = sitepolicy_new(NULL);
+	struct SitePolicy got;
+	GError *err = NULL;
+
+	g_assert_true(sitepolicy_parse(policies,
+	                               "[t.example]\n"
+	                               "javascript=false\n"
+	                               "user-agent=Redirector/1.0\n"
+	                               "\n"
+	                               "[example.org]\n"
+	                               "images=false\n",
+	                               &err));
+	g_assert_no_error(err);
+
+	// Redirect source, applied at WEBKIT_LOAD_STARTED
+	got = defaults;
+	sitepolicy_lookup_uri(policies, "https://t.example/abc", &got);
+	g_assert_cmpuint(got.set, ==, SITEPOLICY_JAVASCRIPT | SITEPOLICY_USER_AGENT);
+	g_assert_false(got.javascript);
+
+	// Redirect target, applied again at WEBKIT_LOAD_REDIRECTED without anything from the source
+	got = defaults;
+	sitepolicy_lookup_uri(policies, "https://www.example.org:8443/page?q=1", &got);
+	g_assert_cmpuint(got.set, ==, SITEPOLICY_IMAGES);
+	g_assert_true(got.javascript);
+	g_assert_false(got.images);
+	g_assert_null(got.user_agent);
+
+	got = defaults;
+	sitepolicy_lookup_uri(policies, "about:blank", &got);
+	g_assert_cmpuint(got.set, ==, 0);
+
+	got = defaults;
+	sitepolicy_lookup_uri(policies, NULL, &got);
+	g_assert_cmpuint(got.set, ==, 0);
+
+	sitepolicy_free(policies);
+}
+
+static void
+sitepolicy_save_test(void)
+{
+	gchar *dir                    = g_dir_make_tmp("badwolf-sitepolicy_test-XXXXXX", NULL);
+	gchar *path                   = g_build_filename(dir, "site-policies", NULL);
+	struct SitePolicies *policies = sitepolicy_new(path);
+	struct SitePolicy got         = defaults;
+	GError *err                   = NULL;
+
+	g_assert_false(sitepolicy_load(policies, &err));
+	g_assert_error(err, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_clear_error(&err);
+
+	sitepolicy_set_boolean(policies, "example.net", SITEPOLICY_JAVASCRIPT, FALSE);
+	sitepolicy_set_boolean(policies, "example.net", SITEPOLICY_ZOOM, FALSE);
+	sitepolicy_lookup(policies, "www.example.net", &got);
+	g_assert_cmpuint(got.set, ==, SITEPOLICY_JAVASCRIPT);
+	g_assert_false(got.javascript);
+
+	g_assert_true(sitepolicy_save(policies, &err));
+	g_assert_no_error(err);
+	sitepolicy_free(policies);
+
+	policies = sitepolicy_new(path);
+	g_assert_true(sitepolicy_load(policies, &err));
+	g_assert_no_error(err);
+
+	got = defaults;
+	sitepolicy_lookup(policies, "example.net", &got);
+	g_assert_cmpuint(got.set, ==, SITEPOLICY_JAVASCRIPT);
+	g_assert_false(got.javascript);
+	sitepolicy_free(policies);
+
+	g_unlink(path);
+	g_rmdir(dir);
+	g_free(path);
+	g_free(dir);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/sitepolicy_lookup/test", sitepolicy_lookup_test);
+	g_test_add_func("/sitepolicy_lookup_uri/test", sitepolicy_lookup_uri_test);
+	g_test_add_func("/sitepolicy_save/test", sitepolicy_save_test);
+
+	return g_test_run();
+}
@@ -0,0 +1,98 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tablabel.h"
+
+#include "config.h"
+#include "fmt.h"
+
+/* badwolf_new_tab_box: Builds the tab box of browser, close_clicked and button_release being
+ * connected to its close button and to its "button-release-event" with browser as user_data
+ */
+GtkWidget *
+badwolf_new_tab_box(const gchar *title,
+                    struct Client *browser,
+                    GCallback close_clicked,
+                    GCallback button_release)
+{
+	/* flawfinder: ignore. bound checks are done */
+	char context_id_str[BADWOLF_CTX_SIZ] = {0, 0, 0, 0, 0, 0, 0};
+
+	fmt_context_id(browser->context_id, context_id_str);
+
+	GtkWidget *tab_box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+	gtk_widget_set_name(tab_box, "browser__tabbox");
+
+	GtkWidget *close =
+	    gtk_button_new_from_icon_name("window-close-symbolic", GTK_ICON_SIZE_LARGE_TOOLBAR);
+	gtk_widget_set_name(close, "browser__tabbox__close");
+	GtkWidget *label = gtk_label_new(title);
+	gtk_widget_set_name(label, "browser__tabbox__label");
+	GtkWidget *label_event_box = gtk_event_box_new();
+	gtk_container_add(GTK_CONTAINER(label_event_box), label);
+	GtkWidget *context_label = gtk_label_new(context_id_str);
+	gtk_widget_set_name(context_label, "browser__tabbox__context_label");
+	GtkWidget *context_label_event_box = gtk_event_box_new();
+	gtk_container_add(GTK_CONTAINER(context_label_event_box), context_label);
+	GtkWidget *playing =
+	    gtk_image_new_from_icon_name("audio-volume-high-symbolic", GTK_ICON_SIZE_SMALL_TOOLBAR);
+	gtk_widget_set_name(playing, "browser__tabbox__playing");
+	GtkWidget *playing_event_box = gtk_event_box_new();
+	gtk_container_add(GTK_CONTAINER(playing_event_box), playing);
+
+#ifdef BADWOLF_TAB_BOX_WIDTH
+	gtk_widget_set_size_request(label, BADWOLF_TAB_BOX_WIDTH, -1);
+#endif
+#ifdef BADWOLF_TAB_LABEL_CHARWIDTH
+	gtk_label_set_width_chars(GTK_LABEL(label), BADWOLF_TAB_LABEL_CHARWIDTH);
+#endif
+	gtk_widget_set_hexpand(tab_box, BADWOLF_TAB_HEXPAND);
+
+	gtk_label_set_ellipsize(GTK_LABEL(label), BADWOLF_TAB_LABEL_ELLIPSIZE);
+	gtk_label_set_single_line_mode(GTK_LABEL(label), TRUE);
+	gtk_label_set_single_line_mode(GTK_LABEL(context_label), TRUE);
+
+	gtk_box_pack_start(GTK_BOX(tab_box), context_label_event_box, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(tab_box), playing_event_box, FALSE, FALSE, 0);
+	gtk_box_pack_start(GTK_BOX(tab_box), label_event_box, TRUE, TRUE, 0);
+	gtk_box_pack_start(GTK_BOX(tab_box), close, FALSE, FALSE, 0);
+
+	gtk_button_set_relief(GTK_BUTTON(close), GTK_RELIEF_NONE);
+
+	g_signal_connect(close, "clicked", close_clicked, browser);
+
+	gtk_widget_set_tooltip_text(tab_box, title);
+
+	gtk_widget_show_all(tab_box);
+	gtk_widget_set_visible(playing,
+	                       browser->webView != NULL &&
+	                           webkit_web_view_is_playing_audio(browser->webView));
+	gtk_widget_set_events(label, GDK_BUTTON_RELEASE_MASK);
+	g_signal_connect(tab_box, "button-release-event", button_release, browser);
+
+	browser->tab_box     = tab_box;
+	browser->tab_label   = label;
+	browser->tab_playing = playing;
+
+	return tab_box;
+}
+
+/* badwolf_tab_label_update: Updates the tab box built by badwolf_new_tab_box() in place,
+ * pages animating their title would otherwise rebuild it constantly.
+ * Returns FALSE when title didn't change.
+ */
+gboolean
+badwolf_tab_label_update(struct Client *browser, const gchar *title)
+{
+	gtk_widget_set_visible(browser->tab_playing,
+	                       browser->webView != NULL &&
+	                           webkit_web_view_is_playing_audio(browser->webView));
+
+	if(g_strcmp0(gtk_label_get_text(GTK_LABEL(browser->tab_label)), title) == 0) return FALSE;
+
+	gtk_label_set_text(GTK_LABEL(browser->tab_label), title);
+	gtk_widget_set_tooltip_text(browser->tab_box, title);
+
+	return TRUE;
+}
@@ -0,0 +1,13 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TABLABEL_H_INCLUDED
+#define TABLABEL_H_INCLUDED
+#include "badwolf.h"
+
+GtkWidget *badwolf_new_tab_box(const gchar *title,
+                               struct Client *browser,
+                               GCallback close_clicked,
+                               GCallback button_release);
+gboolean badwolf_tab_label_update(struct Client *browser, const gchar *title);
+#endif /* TABLABEL_H_INCLUDED */
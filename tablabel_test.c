@@ -0,0 +1,209 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "tablabel.h"
+
+#include <glib.h>
+
+#define TITLE_CHANGES 10000
+
+static gboolean has_display = FALSE; /* widgets need one */
+
+static void
+tab_boxCb_close_clicked(GtkButton *UNUSED(close), gpointer user_data)
+{
+	guint *closed = g_object_get_data(G_OBJECT(((struct Client *)user_data)->box), "closed");
+
+	(*closed)++;
+}
+
+static gboolean
+tab_boxCb_button_release_event(GtkWidget *UNUSED(widget),
+                               GdkEvent *UNUSED(event),
+                               gpointer UNUSED(user_data))
+{
+	return FALSE;
+}
+
+static GtkWidget *
+tab_box_new(struct Client *browser, const gchar *title)
+{
+	return badwolf_new_tab_box(title,
+	                           browser,
+	                           G_CALLBACK(tab_boxCb_close_clicked),
+	                           G_CALLBACK(tab_boxCb_button_release_event));
+}
+
+static void
+tab_box_countCb(GtkWidget *widget, gpointer user_data)
+{
+	guint *widgets = user_data;
+
+	(*widgets)++;
+	if(GTK_IS_CONTAINER(widget))
+		gtk_container_forall(GTK_CONTAINER(widget), tab_box_countCb, widgets);
+}
+
+/* tab_box_widgets: Amount of widgets created by badwolf_new_tab_box(), internal ones included
+ */
+static guint
+tab_box_widgets(struct Client *browser)
+{
+	guint widgets = 0;
+
+	tab_box_countCb(browser->tab_box, &widgets);
+
+	return widgets;
+}
+
+/* notebook_new: Offscreen window with a notebook holding the tab of browser,
+ * like in badwolf_new_tab() but without a WebView behind it
+ */
+static GtkWidget *
+notebook_new(struct Client *browser, GtkWidget **notebook)
+{
+	GtkWidget *window = gtk_offscreen_window_new();
+
+	*notebook    = gtk_notebook_new();
+	browser->box = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 0);
+	gtk_container_add(GTK_CONTAINER(window), *notebook);
+	gtk_notebook_append_page(GTK_NOTEBOOK(*notebook), browser->box, tab_box_new(browser, "Title"));
+	gtk_widget_show_all(window);
+	gtk_container_check_resize(GTK_CONTAINER(window));
+
+	return window;
+}
+
+static void
+badwolf_tab_label_update_test(void)
+{
+	struct Client *browser;
+	GtkWidget *window, *notebook, *tab_box, *tab_label, *close;
+	GList *children;
+	gchar *tooltip;
+	guint closed = 0;
+
+	if(!has_display)
+	{
+		g_test_skip("No display");
+		return;
+	}
+
+	browser   = g_new0(struct Client, 1);
+	window    = notebook_new(browser, &notebook);
+	tab_box   = browser->tab_box;
+	tab_label = browser->tab_label;
+	g_object_set_data(G_OBJECT(browser->box), "closed", &closed);
+
+	g_assert_true(gtk_notebook_get_tab_label(GTK_NOTEBOOK(notebook), browser->box) == tab_box);
+	g_assert_cmpstr(gtk_widget_get_name(tab_box), ==, "browser__tabbox");
+	g_assert_cmpstr(gtk_widget_get_name(tab_label), ==, "browser__tabbox__label");
+	g_assert_false(badwolf_tab_label_update(browser, "Title"));
+
+	// Like a page animating its title
+	for(guint i = 0; i < 100; i++)
+	{
+		gchar *title = g_strdup_printf("(%u) Title", i);
+
+		g_assert_true(badwolf_tab_label_update(browser, title));
+		gtk_container_check_resize(GTK_CONTAINER(window));
+		g_free(title);
+	}
+
+	g_assert_true(browser->tab_box == tab_box);
+	g_assert_true(browser->tab_label == tab_label);
+	g_assert_true(gtk_notebook_get_tab_label(GTK_NOTEBOOK(notebook), browser->box) == tab_box);
+	g_assert_cmpstr(gtk_label_get_text(GTK_LABEL(tab_label)), ==, "(99) Title");
+	tooltip = gtk_widget_get_tooltip_text(tab_box);
+	g_assert_cmpstr(tooltip, ==, "(99) Title");
+	g_free(tooltip);
+	g_assert_false(gtk_widget_get_visible(browser->tab_playing));
+
+	// Close button is still connected to browser
+	children = gtk_container_get_children(GTK_CONTAINER(tab_box));
+	close    = g_list_last(children)->data;
+	g_assert_cmpstr(gtk_widget_get_name(close), ==, "browser__tabbox__close");
+	gtk_button_clicked(GTK_BUTTON(close));
+	g_assert_cmpuint(closed, ==, 1);
+	g_list_free(children);
+
+	gtk_widget_destroy(window);
+	g_free(browser);
+}
+
+/* badwolf_tab_label_update_perf: Replays TITLE_CHANGES title changes on a tab of a notebook,
+ * against setting a new tab box for each of them as done before, both relayouting the window.
+ * Only the widgets created are reported, not the memory allocations.
+ */
+static void
+badwolf_tab_label_update_perf(void)
+{
+	struct Client *browser;
+	GtkWidget *window, *notebook, *tab_box;
+	gchar *titles[TITLE_CHANGES];
+	gdouble rebuild, update;
+	guint widgets;
+
+	if(!has_display)
+	{
+		g_test_skip("No display");
+		return;
+	}
+
+	browser = g_new0(struct Client, 1);
+	for(guint i = 0; i < TITLE_CHANGES; i++)
+		titles[i] = g_strdup_printf("(%u) Title", i);
+
+	window  = notebook_new(browser, &notebook);
+	widgets = tab_box_widgets(browser);
+	g_test_timer_start();
+	for(guint i = 0; i < TITLE_CHANGES; i++)
+	{
+		gtk_notebook_set_tab_label(
+		    GTK_NOTEBOOK(notebook), browser->box, tab_box_new(browser, titles[i]));
+		gtk_container_check_resize(GTK_CONTAINER(window));
+	}
+	rebuild = g_test_timer_elapsed();
+	gtk_widget_destroy(window);
+
+	window  = notebook_new(browser, &notebook);
+	tab_box = browser->tab_box;
+	g_test_timer_start();
+	for(guint i = 0; i < TITLE_CHANGES; i++)
+	{
+		badwolf_tab_label_update(browser, titles[i]);
+		gtk_container_check_resize(GTK_CONTAINER(window));
+	}
+	update = g_test_timer_elapsed();
+	g_assert_true(browser->tab_box == tab_box);
+	gtk_widget_destroy(window);
+
+	g_test_message("%d title changes rebuilding the tab box in %.3fms, creating %u widgets",
+	               TITLE_CHANGES,
+	               rebuild * 1000,
+	               widgets * TITLE_CHANGES);
+	g_test_minimized_result(update * 1000,
+	                        "%d title changes updated in place in %.3fms (%.1fx faster), "
+	                        "creating no widgets",
+	                        TITLE_CHANGES,
+	                        update * 1000,
+	                        rebuild / update);
+
+	for(guint i = 0; i < TITLE_CHANGES; i++)
+		g_free(titles[i]);
+	g_free(browser);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+	has_display = gtk_init_check(&argc, &argv);
+
+	g_test_add_func("/badwolf_tab_label_update/test", badwolf_tab_label_update_test);
+	if(g_test_perf())
+		g_test_add_func("/badwolf_tab_label_update/perf", badwolf_tab_label_update_perf);
+
+	return g_test_run();
+}
@@ -0,0 +1,171 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+/* Event tracing, written as Chrome trace-event JSON (loadable in Perfetto)
+ *
+ * Each thread records into its own ring buffer, so recording never takes a lock,
+ * only the oldest events get lost when a ring is full.
+ */
+
+#include "trace.h"
+
+#include "config.h"
+
+#include <glib-unix.h>  /* g_unix_signal_add() */
+#include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
+#include <signal.h>     /* SIGUSR1 */
+#include <stdio.h>      /* fprintf() */
+#include <unistd.h>     /* getpid() */
+
+struct TraceEvent
+{
+	gint64 time;
+	const char *name;
+	char phase;
+};
+
+struct TraceRing
+{
+	guint tid;
+	gint head; /* amount of events ever recorded, atomic */
+	struct TraceEvent events[BADWOLF_TRACE_EVENTS];
+};
+
+gboolean trace_enabled = FALSE;
+
+static gchar *trace_path = NULL;
+static GPrivate trace_ring;
+static GMutex rings_lock;
+static GPtrArray *rings = NULL; /* struct TraceRing, kept after their thread exits */
+
+static struct TraceRing *
+trace_ring_get(void)
+{
+	struct TraceRing *ring = g_private_get(&trace_ring);
+
+	if(G_LIKELY(ring != NULL)) return ring;
+
+	ring = g_malloc0(sizeof(struct TraceRing));
+
+	g_mutex_lock(&rings_lock);
+	g_ptr_array_add(rings, ring);
+	ring->tid = rings->len;
+	g_mutex_unlock(&rings_lock);
+
+	g_private_set(&trace_ring, ring);
+
+	return ring;
+}
+
+void
+trace_event(char phase, const char *name)
+{
+	struct TraceRing *ring   = trace_ring_get();
+	guint head               = (guint)g_atomic_int_get(&ring->head);
+	struct TraceEvent *event = &ring->events[head % BADWOLF_TRACE_EVENTS];
+
+	event->time  = g_get_monotonic_time();
+	event->name  = name;
+	event->phase = phase;
+
+	// Published once written, for trace_json() running in another thread
+	g_atomic_int_set(&ring->head, (gint)(head + 1));
+}
+
+/* trace_json: Formats the recorded events as Chrome trace-event JSON
+ * Events of other threads being recorded meanwhile can end up garbled.
+ */
+GString *
+trace_json(void)
+{
+	GString *json = g_string_new("{\"traceEvents\":[\n");
+	int pid       = (int)getpid();
+
+	g_string_append_printf(json,
+	                       "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+	                       "\"args\":{\"name\":\"badwolf\"}}",
+	                       pid);
+
+	g_mutex_lock(&rings_lock);
+	for(guint i = 0; rings != NULL && i < rings->len; i++)
+	{
+		struct TraceRing *ring = g_ptr_array_index(rings, i);
+		guint head             = (guint)g_atomic_int_get(&ring->head);
+		guint start            = head > BADWOLF_TRACE_EVENTS ? head - BADWOLF_TRACE_EVENTS : 0;
+
+		for(guint n = start; n < head; n++)
+		{
+			struct TraceEvent *event = &ring->events[n % BADWOLF_TRACE_EVENTS];
+
+			g_string_append_printf(json,
+			                       ",\n{\"name\":\"%s\",\"cat\":\"badwolf\",\"ph\":\"%c\","
+			                       "\"ts\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%u%s}",
+			                       event->name,
+			                       event->phase,
+			                       event->time,
+			                       pid,
+			                       ring->tid,
+			                       event->phase == 'i' ? ",\"s\":\"t\"" : "");
+		}
+	}
+	g_mutex_unlock(&rings_lock);
+
+	g_string_append(json, "\n]}\n");
+
+	return json;
+}
+
+/* trace_dump: Writes the recorded events to the file named by BADWOLF_TRACE
+ */
+gboolean
+trace_dump(void)
+{
+	GString *json;
+	GError *err = NULL;
+	gboolean ret;
+
+	if(!trace_enabled) return FALSE;
+
+	json = trace_json();
+	ret  = g_file_set_contents(trace_path, json->str, (gssize)json->len, &err);
+
+	if(ret)
+		fprintf(stderr, _("badwolf: Trace written to %s\n"), trace_path);
+	else
+	{
+		fprintf(stderr, _("badwolf: Failed writing the trace: %s\n"), err->message);
+		g_error_free(err);
+	}
+
+	g_string_free(json, TRUE);
+
+	return ret;
+}
+
+static gboolean
+traceCb_sigusr1(gpointer user_data)
+{
+	(void)user_data;
+
+	trace_dump();
+
+	return G_SOURCE_CONTINUE;
+}
+
+/* trace_init: Enables tracing when BADWOLF_TRACE is set to the path of the file to write to
+ */
+void
+trace_init(void)
+{
+	const gchar *path = g_getenv("BADWOLF_TRACE");
+
+	if(path == NULL || path[0] == '\0') return;
+
+	trace_path = g_strdup(path);
+	rings      = g_ptr_array_new();
+
+	g_unix_signal_add(SIGUSR1, traceCb_sigusr1, NULL);
+
+	trace_enabled = TRUE;
+}
@@ -0,0 +1,36 @@
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TRACE_H_INCLUDED
+#define TRACE_H_INCLUDED
+#include <glib.h>
+
+/* TRACE_BEGIN, TRACE_END: Delimits a duration event, name has to outlive badwolf,
+ * like a string literal or __func__
+ * TRACE_INSTANT: Event without duration
+ *
+ * Only costs a branch when tracing isn't enabled, see trace_init().
+ */
+#define TRACE_BEGIN(name)                                    \
+	do                                                       \
+	{                                                        \
+		if(G_UNLIKELY(trace_enabled)) trace_event('B', name); \
+	} while(0)
+#define TRACE_END(name)                                      \
+	do                                                       \
+	{                                                        \
+		if(G_UNLIKELY(trace_enabled)) trace_event('E', name); \
+	} while(0)
+#define TRACE_INSTANT(name)                                  \
+	do                                                       \
+	{                                                        \
+		if(G_UNLIKELY(trace_enabled)) trace_event('i', name); \
+	} while(0)
+
+extern gboolean trace_enabled;
+
+void trace_init(void);
+void trace_event(char phase, const char *name);
+GString *trace_json(void);
+gboolean trace_dump(void);
+#endif /* TRACE_H_INCLUDED */
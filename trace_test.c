@@ -0,0 +1,82 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "trace.h"
+
+#include "config.h"
+
+#include <glib.h>
+#include <string.h> /* strstr() */
+
+static guint
+count_substr(const gchar *haystack, const gchar *needle)
+{
+	guint count = 0;
+
+	for(const gchar *p = strstr(haystack, needle); p != NULL; p = strstr(p + 1, needle))
+		count++;
+
+	return count;
+}
+
+static gpointer
+thread_trace(gpointer user_data)
+{
+	(void)user_data;
+
+	TRACE_INSTANT("thread");
+
+	return NULL;
+}
+
+static void
+trace_json_test(void)
+{
+	GThread *thread;
+	GString *json;
+
+	g_setenv("BADWOLF_TRACE", "/dev/null", TRUE);
+	trace_init();
+	g_assert_true(trace_enabled);
+
+	TRACE_BEGIN("outer");
+	TRACE_INSTANT("instant");
+	TRACE_END("outer");
+
+	thread = g_thread_new("trace_test", thread_trace, NULL);
+	g_thread_join(thread);
+
+	json = trace_json();
+	g_info("%s", json->str);
+
+	g_assert_true(g_str_has_prefix(json->str, "{\"traceEvents\":["));
+	g_assert_true(g_str_has_suffix(json->str, "]}\n"));
+	g_assert_nonnull(strstr(json->str, "{\"name\":\"outer\",\"cat\":\"badwolf\",\"ph\":\"B\","));
+	g_assert_nonnull(strstr(json->str, "{\"name\":\"outer\",\"cat\":\"badwolf\",\"ph\":\"E\","));
+	g_assert_nonnull(strstr(json->str, "\"ph\":\"i\","));
+	g_assert_nonnull(strstr(json->str, "\"name\":\"thread\""));
+	g_assert_nonnull(strstr(json->str, "\"tid\":1"));
+	g_assert_nonnull(strstr(json->str, "\"tid\":2"));
+	g_string_free(json, TRUE);
+
+	// Only the newest events are kept
+	for(guint i = 0; i < BADWOLF_TRACE_EVENTS; i++)
+		TRACE_INSTANT("overflow");
+
+	json = trace_json();
+	g_assert_cmpuint(count_substr(json->str, "\"name\":\"overflow\""), ==, BADWOLF_TRACE_EVENTS);
+	g_assert_null(strstr(json->str, "\"name\":\"outer\",\"cat\":\"badwolf\",\"ph\":\"B\""));
+	g_assert_nonnull(strstr(json->str, "\"name\":\"thread\""));
+	g_string_free(json, TRUE);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/trace_json/test", trace_json_test);
+
+	return g_test_run();
+}
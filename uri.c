@@ -4,35 +4,282 @@
 
 #include "uri.h"
 
-#include <glib.h>   /* g_strcmp0(), g_uri_parse_scheme(), g_strdup_printf */
+#include "config.h"
+
+#include <glib.h>   /* g_strcmp0(), g_filename_to_uri(), g_uri_escape_string() */
 #include <stdlib.h> /* realpath(), free() */
-#include <unistd.h> /* access() */
+#include <string.h> /* strcspn(), strspn(), strncmp(), memchr() */
 
-const gchar *
-badwolf_ensure_uri_scheme(const gchar *text, gboolean try_file)
+/* struct UriKeyword: "keyword template" line of the keywords file
+ */
+struct UriKeyword
+{
+	gchar *keyword;
+	gsize len;
+	gchar *template; /* every %s being replaced by the search terms */
+};
+
+static GArray *keywords = NULL; /* struct UriKeyword, looked up linearly as there are few */
+
+#define URI_SPACES " \t\r\n"
+
+static void
+uri_keyword_clear(gpointer data)
+{
+	struct UriKeyword *keyword = data;
+
+	g_free(keyword->keyword);
+	g_free(keyword->template);
+}
+
+/* badwolf_uri_keywords_parse: Replaces the keywords by the ones of text,
+ * lines of a keyword followed by its template, empty ones and the ones starting with # ignored.
+ * Returns the amount of keywords.
+ */
+guint
+badwolf_uri_keywords_parse(const gchar *text)
+{
+	gchar **lines = g_strsplit(text, "\n", -1);
+
+	if(keywords == NULL)
+	{
+		keywords = g_array_new(FALSE, FALSE, sizeof(struct UriKeyword));
+		g_array_set_clear_func(keywords, uri_keyword_clear);
+	}
+	g_array_set_size(keywords, 0);
+
+	for(gchar **line = lines; *line != NULL; line++)
+	{
+		gchar *keyword = g_strstrip(*line);
+		gsize len      = strcspn(keyword, URI_SPACES);
+		struct UriKeyword entry;
+
+		if(keyword[0] == '\0' || keyword[0] == '#' || keyword[len] == '\0') continue;
+
+		entry.keyword  = g_strndup(keyword, len);
+		entry.len      = len;
+		entry.template = g_strdup(keyword + len + strspn(keyword + len, URI_SPACES));
+		g_array_append_val(keywords, entry);
+	}
+
+	g_strfreev(lines);
+
+	return keywords->len;
+}
+
+/* badwolf_uri_keywords_load: Same as badwolf_uri_keywords_parse() but for the file at path
+ */
+gboolean
+badwolf_uri_keywords_load(const gchar *path, GError **err)
+{
+	gchar *text = NULL;
+
+	if(!g_file_get_contents(path, &text, NULL, err)) return FALSE;
+
+	badwolf_uri_keywords_parse(text);
+	g_free(text);
+
+	return TRUE;
+}
+
+static const struct UriKeyword *
+uri_keyword_find(const gchar *text, gsize len)
+{
+	if(keywords == NULL) return NULL;
+
+	for(guint i = 0; i < keywords->len; i++)
+	{
+		const struct UriKeyword *keyword = &g_array_index(keywords, struct UriKeyword, i);
+
+		if(keyword->len == len && strncmp(keyword->keyword, text, len) == 0) return keyword;
+	}
+
+	return NULL;
+}
+
+static gboolean
+uri_is_path(const gchar *text)
+{
+	if(text[0] == '/') return TRUE;
+
+	if(text[0] == '~') return text[1] == '\0' || text[1] == '/';
+
+	if(text[0] == '.')
+	{
+		gsize dots = text[1] == '.' ? 2 : 1;
+
+		return text[dots] == '\0' || text[dots] == '/';
+	}
+
+	return FALSE;
+}
+
+/* uri_has_scheme: Whether text starts with a scheme, "host:port" not being one */
+static gboolean
+uri_has_scheme(const gchar *text)
+{
+	gsize i = 1, port;
+
+	if(!g_ascii_isalpha(text[0])) return FALSE;
+
+	while(g_ascii_isalnum(text[i]) || text[i] == '+' || text[i] == '-' || text[i] == '.')
+		i++;
+
+	if(text[i] != ':') return FALSE;
+
+	port = i + 1;
+	while(g_ascii_isdigit(text[port]))
+		port++;
+
+	return port == i + 1 || strchr("/?#", text[port]) == NULL;
+}
+
+/* uri_is_host: Whether the len first bytes of text are an hostname with an optional port */
+static gboolean
+uri_is_host(const gchar *text, gsize len)
 {
-	const gchar *fallback = "about:blank";
-	char *path            = NULL;
+	const gchar *colon = memchr(text, ':', len);
+	gsize host_len     = colon != NULL ? (gsize)(colon - text) : len;
+	gboolean numeric   = TRUE;
+	guint dots         = 0;
 
-	if(g_strcmp0(text, "") <= 0) return fallback;
+	if(text[0] == '[') return memchr(text, ']', len) != NULL;
 
-	if(g_uri_parse_scheme(text)) return text;
+	if(colon != NULL)
+	{
+		if(host_len + 1 == len) return FALSE;
 
-	if(try_file)
+		for(gsize i = host_len + 1; i < len; i++)
+			if(!g_ascii_isdigit(text[i])) return FALSE;
+	}
+
+	if(host_len == 0 || text[0] == '.' || text[0] == '-') return FALSE;
+
+	if(host_len == 9 && g_ascii_strncasecmp(text, "localhost", 9) == 0) return TRUE;
+
+	for(gsize i = 0; i < host_len; i++)
 	{
-		/* flawfinder: ignore. `path` is allocated by realpath itself */
-		path     = realpath(text, NULL);
-		gchar *f = NULL;
+		guchar c = (guchar)text[i];
 
-		if(path != NULL)
-		{
-			f = g_strdup_printf("file://%s", path);
+		if(c == '.')
+			dots++;
+		else if(g_ascii_isdigit(c))
+			continue;
+		else if(g_ascii_isalpha(c) || c == '-' || c == '_' || c >= 0x80)
+			numeric = FALSE;
+		else
+			return FALSE;
+	}
+
+	// Numbers like 3.14 get searched, unless they're an IPv4 address
+	if(numeric) return dots == 3;
 
-			free(path);
+	return dots > 0 || colon != NULL;
+}
 
-			return f;
-		}
+/* badwolf_uri_classify: Tells what text looks like, without allocating
+ * nor accessing the filesystem
+ */
+enum badwolf_uri_kind
+badwolf_uri_classify(const gchar *text)
+{
+	gsize word;
+
+	if(text == NULL || text[0] == '\0') return BADWOLF_URI_BLANK;
+
+	// Before spaces, which paths can have
+	if(uri_is_path(text)) return BADWOLF_URI_PATH;
+
+	word = strcspn(text, URI_SPACES);
+	if(text[word] != '\0')
+	{
+		const gchar *terms = text + word + strspn(text + word, URI_SPACES);
+
+		if(terms[0] != '\0' && uri_keyword_find(text, word) != NULL) return BADWOLF_URI_KEYWORD;
+
+		// URIs and hostnames can't have spaces
+		return BADWOLF_URI_SEARCH;
+	}
+
+	if(uri_has_scheme(text)) return BADWOLF_URI_SCHEME;
+
+	if(uri_is_host(text, strcspn(text, "/?#"))) return BADWOLF_URI_HOST;
+
+	return BADWOLF_URI_SEARCH;
+}
+
+static gchar *
+uri_expand(const gchar *template, const gchar *terms)
+{
+	gchar *escaped = g_uri_escape_string(terms, NULL, TRUE);
+	GString *uri   = g_string_new(NULL);
+	const gchar *s;
+
+	// Not a format string, templates come from the keywords file
+	while((s = strstr(template, "%s")) != NULL)
+	{
+		g_string_append_len(uri, template, s - template);
+		g_string_append(uri, escaped);
+		template = s + 2;
+	}
+	g_string_append(uri, template);
+
+	g_free(escaped);
+
+	return g_string_free(uri, FALSE);
+}
+
+static gchar *
+uri_from_path(const gchar *text)
+{
+	gchar *expanded = text[0] == '~' ? g_build_filename(g_get_home_dir(), text + 1, NULL)
+	                                 : g_strdup(text);
+	/* flawfinder: ignore. `path` is allocated by realpath itself */
+	char *path = realpath(expanded, NULL);
+	gchar *uri;
+
+	// Not existing yet, still better as a file:// error page than as a http:// one
+	if(path == NULL)
+	{
+		gchar *canonical = g_canonicalize_filename(expanded, NULL);
+
+		uri = g_filename_to_uri(canonical, NULL, NULL);
+		g_free(canonical);
+	}
+	else
+	{
+		uri = g_filename_to_uri(path, NULL, NULL);
+		free(path);
+	}
+
+	g_free(expanded);
+
+	return uri != NULL ? uri : g_strconcat("http://", text, NULL);
+}
+
+gchar *
+badwolf_ensure_uri_scheme(const gchar *text, gboolean try_file)
+{
+	gsize word;
+
+	switch(badwolf_uri_classify(text))
+	{
+	case BADWOLF_URI_BLANK:
+		return g_strdup("about:blank");
+	case BADWOLF_URI_SCHEME:
+		return g_strdup(text);
+	case BADWOLF_URI_PATH:
+		if(try_file) return uri_from_path(text);
+		break;
+	case BADWOLF_URI_KEYWORD:
+		word = strcspn(text, URI_SPACES);
+		return uri_expand(uri_keyword_find(text, word)->template,
+		                  text + word + strspn(text + word, URI_SPACES));
+	case BADWOLF_URI_HOST:
+		break;
+	case BADWOLF_URI_SEARCH:
+		return uri_expand(BADWOLF_SEARCH_URI, text);
 	}
 
-	return g_strdup_printf("http://%s", text);
+	return g_strconcat("http://", text, NULL);
 }
@@ -5,16 +5,33 @@
 #define URI_H_INCLUDED
 #include <glib.h>
 
-/* badwolf_ensure_uri_scheme: tries to add a scheme on a pseudo-URL missing a scheme
+/* enum badwolf_uri_kind: What a location typed by the user looks like,
+ * see badwolf_uri_classify()
+ */
+enum badwolf_uri_kind
+{
+	BADWOLF_URI_BLANK,   /* NULL or empty */
+	BADWOLF_URI_SCHEME,  /* already an URI */
+	BADWOLF_URI_PATH,    /* starting with /, ./, ../ or ~/ */
+	BADWOLF_URI_KEYWORD, /* "keyword terms", see badwolf_uri_keywords_parse() */
+	BADWOLF_URI_HOST,    /* hostname, optionally followed by a port, path, query, … */
+	BADWOLF_URI_SEARCH,  /* anything else, searched with BADWOLF_SEARCH_URI */
+};
+
+enum badwolf_uri_kind badwolf_uri_classify(const gchar *text);
+guint badwolf_uri_keywords_parse(const gchar *text);
+gboolean badwolf_uri_keywords_load(const gchar *path, GError **err);
+
+/* badwolf_ensure_uri_scheme: turns a location typed by the user into an URI
  * - gchar text: pseudo-URL missing a scheme
- * - gboolean try_file: when TRUE check try first if it can be a file:// path
+ * - gboolean try_file: when FALSE paths aren't resolved, getting http:// as before
  *
  * When `text` isn't exploitable (ie. NULL), returns "about:blank",
  * when the URL seems to be valid, return it,
- * if try_file is TRUE, check if it can be file:// path,
- * some other checks might be added.
- * In the end use the fallback (`http://` for now, might get configuration),
- * might get some safeguard.
+ * a path gets resolved to a file:// URI when try_file is TRUE,
+ * keywords and search queries get their search URI,
+ * and hostnames get `http://`.
+ * The filesystem is only accessed for paths. Returns a newly allocated string.
  */
-const gchar *badwolf_ensure_uri_scheme(const gchar *text, gboolean try_file);
+gchar *badwolf_ensure_uri_scheme(const gchar *text, gboolean try_file);
 #endif /* URI_H_INCLUDED */
@@ -47,13 +47,136 @@ badwolf_ensure_uri_scheme_test(void)
 		       cases[i].text,
 		       cases[i].try_file ? "TRUE" : "FALSE");
 
-		const gchar *got = badwolf_ensure_uri_scheme(cases[i].text, cases[i].try_file);
+		gchar *got = badwolf_ensure_uri_scheme(cases[i].text, cases[i].try_file);
 
 		if(g_strcmp0(got, cases[i].expect) != 0)
 		{
 			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got);
 		}
+
+		g_free(got);
+	}
+}
+
+static const gchar *keywords = "# comment\n"
+                               "\n"
+                               "w https://en.wikipedia.org/w/index.php?search=%s\n"
+                               "  ddg\thttps://duckduckgo.com/?q=%s&t=%s \n"
+                               "broken\n";
+
+static void
+badwolf_uri_classify_test(void)
+{
+	struct
+	{
+		enum badwolf_uri_kind expect;
+		const gchar *text;
+	} cases[] = {
+	    //
+	    {BADWOLF_URI_BLANK, NULL},
+	    {BADWOLF_URI_BLANK, ""},
+	    {BADWOLF_URI_SCHEME, "https://example.org/"},
+	    {BADWOLF_URI_SCHEME, "about:blank"},
+	    {BADWOLF_URI_SCHEME, "mailto:contact@example.org"},
+	    {BADWOLF_URI_PATH, "/dev/null"},
+	    {BADWOLF_URI_PATH, "/home/user/Some Page.html"},
+	    {BADWOLF_URI_PATH, "./index.html"},
+	    {BADWOLF_URI_PATH, "../index.html"},
+	    {BADWOLF_URI_PATH, "~/index.html"},
+	    {BADWOLF_URI_PATH, "~"},
+	    {BADWOLF_URI_KEYWORD, "w Badwolf (browser)"},
+	    {BADWOLF_URI_KEYWORD, "ddg  foo"},
+	    {BADWOLF_URI_HOST, "example.org"},
+	    {BADWOLF_URI_HOST, "example.org:8080/path?q=1#top"},
+	    {BADWOLF_URI_HOST, "localhost"},
+	    {BADWOLF_URI_HOST, "localhost:8080"},
+	    {BADWOLF_URI_HOST, "127.0.0.1"},
+	    {BADWOLF_URI_HOST, "[::1]:8080/"},
+	    {BADWOLF_URI_HOST, "b\xc3\xbc" "cher.example"},
+	    {BADWOLF_URI_SEARCH, "w"},
+	    {BADWOLF_URI_SEARCH, "w "},
+	    {BADWOLF_URI_SEARCH, "wikipedia"},
+	    {BADWOLF_URI_SEARCH, "hello world"},
+	    {BADWOLF_URI_SEARCH, "error: no such file"},
+	    {BADWOLF_URI_SEARCH, "3.14"},
+	    {BADWOLF_URI_SEARCH, ".hidden"},
+	    {BADWOLF_URI_SEARCH, "user@example.org"} //
+	};
+
+	g_assert_cmpuint(badwolf_uri_keywords_parse(keywords), ==, 2);
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		enum badwolf_uri_kind got = badwolf_uri_classify(cases[i].text);
+
+		g_info("badwolf_uri_classify(\"%s\")", cases[i].text);
+
+		if(got != cases[i].expect) g_error("expected: %d, got: %d", cases[i].expect, got);
+	}
+}
+
+static void
+badwolf_uri_keywords_test(void)
+{
+	struct
+	{
+		const gchar *expect;
+		const gchar *text;
+	} cases[] = {
+	    //
+	    {"https://en.wikipedia.org/w/index.php?search=Badwolf%20%28browser%29",
+	     "w Badwolf (browser)"},
+	    {"https://duckduckgo.com/?q=a%26b&t=a%26b", "ddg  a&b"},
+	    {"http://localhost:8080", "localhost:8080"} //
+	};
+
+	g_assert_cmpuint(badwolf_uri_keywords_parse(keywords), ==, 2);
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		gchar *got = badwolf_ensure_uri_scheme(cases[i].text, TRUE);
+
+		g_info("badwolf_ensure_uri_scheme(\"%s\", TRUE)", cases[i].text);
+
+		if(g_strcmp0(got, cases[i].expect) != 0)
+		{
+			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got);
+		}
+
+		g_free(got);
 	}
+
+	g_assert_cmpuint(badwolf_uri_keywords_parse(""), ==, 0);
+	g_assert_cmpint(badwolf_uri_classify("w Badwolf"), ==, BADWOLF_URI_SEARCH);
+}
+
+static void
+badwolf_uri_classify_perf(void)
+{
+	const gchar *texts[] = {
+	    "https://example.org/some/path?query=1",
+	    "example.org",
+	    "localhost:8080/index.html",
+	    "w some search terms",
+	    "some search terms",
+	    "/usr/share/doc/index.html",
+	    "3.14",
+	    "wikipedia",
+	};
+	const guint count = 8 * 1000 * 1000;
+	guint hosts       = 0;
+	gdouble elapsed;
+
+	badwolf_uri_keywords_parse(keywords);
+
+	g_test_timer_start();
+	for(guint i = 0; i < count; i++)
+		if(badwolf_uri_classify(texts[i % G_N_ELEMENTS(texts)]) == BADWOLF_URI_HOST) hosts++;
+	elapsed = g_test_timer_elapsed();
+
+	g_assert_cmpuint(hosts, ==, count / 4);
+
+	g_test_maximized_result(count / elapsed, "%.0f classifications/s", count / elapsed);
 }
 
 int
@@ -62,6 +185,9 @@ main(int argc, char *argv[])
 	g_test_init(&argc, &argv, NULL);
 
 	g_test_add_func("/badwolf_ensure_uri_scheme/test", badwolf_ensure_uri_scheme_test);
+	g_test_add_func("/badwolf_uri_classify/test", badwolf_uri_classify_test);
+	g_test_add_func("/badwolf_uri_keywords/test", badwolf_uri_keywords_test);
+	if(g_test_perf()) g_test_add_func("/badwolf_uri_classify/perf", badwolf_uri_classify_perf);
 
 	return g_test_run();
 }
@@ -10,13 +10,549 @@
 #include <assert.h>
 #include <glib/gi18n.h> /* _() and other internationalization/localization helpers */
 #include <glob.h>
+#include <string.h> /* strstr(), strchr(), strcmp(), strcspn() */
 
+/* struct Userscript: A userscript added to window->content_manager
+ */
+struct Userscript
+{
+	WebKitUserScript *script;
+	struct UserscriptMeta meta;
+};
+
+/* struct UserscriptLoad: A userscript being read
+ */
+struct UserscriptLoad
+{
+	gint64 start;
+	gboolean reload; /* FALSE when loaded at startup */
+};
+
+static struct Window *userscripts_window = NULL;
+static GHashTable *userscripts           = NULL; /* path → struct Userscript */
+static GHashTable *reloads               = NULL; /* path → source id of the pending reload */
+static GFileMonitor *scripts_monitor     = NULL;
+static guint startup_pending = 0, startup_loaded = 0, startup_failed = 0;
+
+/* userscript_pattern: Translates a @match/@include/@exclude pattern to a WebKit URL pattern,
+ * returns NULL when it can't be translated (regular expressions, wildcards in the middle of hosts).
+ */
+gchar *
+userscript_pattern(const gchar *pattern)
+{
+	const gchar *rest;
+	const gchar *host_end;
+	const gchar *wildcard;
+	gchar *scheme;
+	gchar *host;
+	gchar *ret;
+
+	if(strcmp(pattern, "*") == 0 || strcmp(pattern, "<all_urls>") == 0)
+		return g_strdup("*://*/*");
+
+	// Regular expression
+	if(pattern[0] == '/') return NULL;
+
+	rest = strstr(pattern, "://");
+	if(rest == NULL) return NULL;
+
+	scheme = g_strndup(pattern, (gsize)(rest - pattern));
+	rest += 3;
+
+	// GreaseMonkey-style globs like http*://
+	if(strcmp(scheme, "http*") == 0)
+	{
+		g_free(scheme);
+		scheme = g_strdup("*");
+	}
+
+	if(strchr(scheme, '*') != NULL && strcmp(scheme, "*") != 0)
+	{
+		g_free(scheme);
+		return NULL;
+	}
+
+	host_end = strchr(rest, '/');
+
+	host     = host_end != NULL ? g_strndup(rest, (gsize)(host_end - rest)) : g_strdup(rest);
+	wildcard = strchr(host, '*');
+
+	// Only *, or *. as a prefix, is allowed in hosts
+	if(wildcard != NULL &&
+	   (wildcard != host || (host[1] != '\0' && host[1] != '.') || strchr(host + 1, '*') != NULL))
+	{
+		g_free(host);
+		g_free(scheme);
+		return NULL;
+	}
+
+	ret = g_strdup_printf("%s://%s%s", scheme, host, host_end != NULL ? host_end : "/*");
+
+	g_free(host);
+	g_free(scheme);
+
+	return ret;
+}
+
+static void
+userscript_meta_pattern(struct UserscriptMeta *meta,
+                        GPtrArray *list,
+                        guint *dropped,
+                        const gchar *value)
+{
+	gchar *pattern = userscript_pattern(value);
+
+	if(pattern == NULL)
+	{
+		fprintf(stderr,
+		        _("badwolf: Warning: Userscript %s: Unsupported pattern %s\n"),
+		        meta->name != NULL ? meta->name : "",
+		        value);
+		(*dropped)++;
+		return;
+	}
+
+	g_ptr_array_add(list, pattern);
+}
+
+/* userscript_meta_parse: Parses the ==UserScript== block of source into meta,
+ * returns FALSE when there is none, meta being then set to the defaults of badwolf.
+ */
+gboolean
+userscript_meta_parse(const gchar *source, struct UserscriptMeta *meta)
+{
+	const gchar *line = source;
+	gboolean in_block = FALSE;
+	gboolean found    = FALSE;
+
+	meta->name          = NULL;
+	meta->allow         = g_ptr_array_new_with_free_func(g_free);
+	meta->block         = g_ptr_array_new_with_free_func(g_free);
+	meta->run_at_end    = FALSE;
+	meta->noframes      = FALSE;
+	meta->allow_dropped = 0;
+	meta->block_dropped = 0;
+
+	while(line != NULL && *line != '\0')
+	{
+		const gchar *eol = strchr(line, '\n');
+		gsize len        = eol != NULL ? (gsize)(eol - line) : strlen(line);
+		gchar *text      = g_strstrip(g_strndup(line, len));
+		gchar *comment;
+
+		line = eol != NULL ? eol + 1 : NULL;
+
+		if(!g_str_has_prefix(text, "//"))
+		{
+			gboolean empty = *text == '\0';
+
+			g_free(text);
+			// The block has to be in the leading comments, no need to go through the whole script
+			if(empty) continue;
+			break;
+		}
+
+		comment = g_strchug(text + 2);
+
+		if(strcmp(comment, "==UserScript==") == 0)
+		{
+			in_block = TRUE;
+			found    = TRUE;
+			// GreaseMonkey default
+			meta->run_at_end = TRUE;
+		}
+		else if(strcmp(comment, "==/UserScript==") == 0)
+		{
+			g_free(text);
+			break;
+		}
+		else if(in_block && comment[0] == '@')
+		{
+			gchar *value = comment + strcspn(comment, " \t");
+
+			if(*value != '\0') *value++ = '\0';
+			value = g_strstrip(value);
+
+			if(strcmp(comment, "@name") == 0 && meta->name == NULL)
+				meta->name = g_strdup(value);
+			else if(strcmp(comment, "@match") == 0 || strcmp(comment, "@include") == 0)
+				userscript_meta_pattern(meta, meta->allow, &meta->allow_dropped, value);
+			else if(strcmp(comment, "@exclude") == 0 || strcmp(comment, "@exclude-match") == 0)
+				userscript_meta_pattern(meta, meta->block, &meta->block_dropped, value);
+			else if(strcmp(comment, "@run-at") == 0)
+				meta->run_at_end = strcmp(value, "document-start") != 0;
+			else if(strcmp(comment, "@noframes") == 0)
+				meta->noframes = TRUE;
+		}
+
+		g_free(text);
+	}
+
+	return found;
+}
+
+/* userscript_pattern_match: Matches uri against a pattern from userscript_pattern()
+ */
+static gboolean
+userscript_pattern_match(const gchar *pattern, const gchar *uri)
+{
+	const gchar *pattern_host = strstr(pattern, "://");
+	const gchar *uri_host     = strstr(uri, "://");
+	const gchar *pattern_path, *uri_path;
+	gsize scheme_len, host_len;
+	gboolean ret;
+	gchar *host;
+
+	if(pattern_host == NULL || uri_host == NULL) return FALSE;
+
+	scheme_len = (gsize)(uri_host - uri);
+	if(strncmp(pattern, "*://", 4) == 0)
+	{
+		if(!(scheme_len == 4 && strncmp(uri, "http", 4) == 0) &&
+		   !(scheme_len == 5 && strncmp(uri, "https", 5) == 0))
+			return FALSE;
+	}
+	else if((gsize)(pattern_host - pattern) != scheme_len || strncmp(pattern, uri, scheme_len) != 0)
+		return FALSE;
+
+	pattern_host += 3;
+	uri_host += 3;
+	pattern_path = strchr(pattern_host, '/');
+	if(pattern_path == NULL) return FALSE;
+
+	uri_path     = uri_host + strcspn(uri_host, "/?#");
+	host_len     = strcspn(uri_host, ":/?#");
+	host         = g_ascii_strdown(uri_host, (gssize)host_len);
+
+	if(strncmp(pattern_host, "*/", 2) == 0)
+		ret = TRUE;
+	else if(strncmp(pattern_host, "*.", 2) == 0)
+	{
+		gsize suffix_len = (gsize)(pattern_path - pattern_host) - 2;
+
+		ret = host_len >= suffix_len &&
+		      strncmp(host + host_len - suffix_len, pattern_host + 2, suffix_len) == 0 &&
+		      (host_len == suffix_len || host[host_len - suffix_len - 1] == '.');
+	}
+	else
+		ret = (gsize)(pattern_path - pattern_host) == host_len &&
+		      strncmp(host, pattern_host, host_len) == 0;
+
+	g_free(host);
+
+	if(!ret) return FALSE;
+
+	return g_pattern_match_simple(pattern_path, *uri_path != '\0' ? uri_path : "/");
+}
+
+/* userscript_meta_skipped: Whether the script of meta had @match or @include patterns
+ * but none of them is supported, as it would end up injected everywhere instead of nowhere
+ */
+gboolean
+userscript_meta_skipped(const struct UserscriptMeta *meta)
+{
+	return meta->allow_dropped > 0 && meta->allow->len == 0;
+}
+
+/* userscript_matches: Whether the script of meta gets injected into uri
+ */
+gboolean
+userscript_matches(const struct UserscriptMeta *meta, const gchar *uri)
+{
+	gboolean allowed = meta->allow->len == 0;
+
+	if(uri == NULL) return FALSE;
+
+	for(guint i = 0; i < meta->allow->len && !allowed; i++)
+		allowed = userscript_pattern_match(g_ptr_array_index(meta->allow, i), uri);
+
+	for(guint i = 0; i < meta->block->len && allowed; i++)
+		allowed = !userscript_pattern_match(g_ptr_array_index(meta->block, i), uri);
+
+	return allowed;
+}
+
+void
+userscript_meta_clear(struct UserscriptMeta *meta)
+{
+	g_free(meta->name);
+	g_ptr_array_free(meta->allow, TRUE);
+	g_ptr_array_free(meta->block, TRUE);
+}
+
+/* userscript_new: Creates the userscript of source, NULL when it can't ever match
+ */
+static struct Userscript *
+userscript_new(const gchar *filename, const gchar *source)
+{
+	struct Userscript *userscript = g_malloc(sizeof(struct Userscript));
+	struct UserscriptMeta *meta   = &userscript->meta;
+
+	userscript_meta_parse(source, meta);
+
+	if(userscript_meta_skipped(meta))
+	{
+		fprintf(stderr,
+		        _("badwolf: Warning: Userscript %s: No supported patterns, skipping it\n"),
+		        filename);
+		userscript_meta_clear(meta);
+		g_free(userscript);
+		return NULL;
+	}
+
+	if(meta->block_dropped > 0)
+		fprintf(stderr,
+		        _("badwolf: Warning: Userscript %s: %u @exclude patterns unsupported, "
+		          "it will also be injected in the pages they excluded\n"),
+		        filename,
+		        meta->block_dropped);
+
+	// Temporarily NULL-terminated for WebKit
+	g_ptr_array_add(meta->allow, NULL);
+	g_ptr_array_add(meta->block, NULL);
+
+	userscript->script = webkit_user_script_new(
+	    source,
+	    meta->noframes ? WEBKIT_USER_CONTENT_INJECT_TOP_FRAME : WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
+	    meta->run_at_end ? WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_END
+	                     : WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
+	    meta->allow->len > 1 ? (const gchar *const *)meta->allow->pdata : NULL,
+	    meta->block->len > 1 ? (const gchar *const *)meta->block->pdata : NULL);
+
+	g_ptr_array_remove_index(meta->allow, meta->allow->len - 1);
+	g_ptr_array_remove_index(meta->block, meta->block->len - 1);
+
+	return userscript;
+}
+
+static void
+userscript_free(gpointer data)
+{
+	struct Userscript *userscript = (struct Userscript *)data;
+
+	webkit_user_script_unref(userscript->script);
+	userscript_meta_clear(&userscript->meta);
+	g_free(userscript);
+}
+
+/* userscript_notify: Tells the tabs where userscript is injected that it changed,
+ * reloading them is left to the user.
+ */
+static void
+userscript_notify(struct Userscript *userscript, const gchar *filename)
+{
+	GtkNotebook *notebook = GTK_NOTEBOOK(userscripts_window->notebook);
+	gchar *basename       = g_path_get_basename(filename);
+	const gchar *name     = userscript->meta.name != NULL ? userscript->meta.name : basename;
+	gchar *message        = g_strdup_printf(_("Userscript %s changed, reload to apply it"), name);
+
+	for(gint i = 0; i < gtk_notebook_get_n_pages(notebook); i++)
+	{
+		// Not badwolf_page_get_client() to keep userscripts_test free of hibernate.c
+		GtkWidget *page        = gtk_notebook_get_nth_page(notebook, i);
+		struct Client *browser = g_object_get_data(G_OBJECT(page), "badwolf-client");
+
+		// Hibernated tabs get the new version once woken up
+		if(browser == NULL || browser->hibernation != NULL) continue;
+
+		if(userscript_matches(&userscript->meta, webkit_web_view_get_uri(browser->webView)))
+			gtk_label_set_text(GTK_LABEL(browser->statuslabel), message);
+	}
+
+	g_free(message);
+	g_free(basename);
+}
+
+/* userscript_replace: Replaces the userscript of filename in window->content_manager,
+ * removing it when userscript is NULL
+ */
+static void
+userscript_replace(const gchar *filename, struct Userscript *userscript, gboolean reload)
+{
+	WebKitUserContentManager *content_manager = userscripts_window->content_manager;
+	struct Userscript *old                    = g_hash_table_lookup(userscripts, filename);
+
+	if(old != NULL)
+	{
+		if(reload) userscript_notify(old, filename);
+		webkit_user_content_manager_remove_script(content_manager, old->script);
+		g_hash_table_remove(userscripts, filename);
+	}
+
+	if(userscript != NULL)
+	{
+		if(reload) userscript_notify(userscript, filename);
+		g_hash_table_insert(userscripts, g_strdup(filename), userscript);
+		webkit_user_content_manager_add_script(content_manager, userscript->script);
+	}
+}
+
+static void
+userscriptCb_loaded(GObject *file, GAsyncResult *result, gpointer user_data)
+{
+	struct UserscriptLoad *load   = (struct UserscriptLoad *)user_data;
+	struct Userscript *userscript = NULL;
+	gchar *filename               = g_file_get_path(G_FILE(file));
+	GError *err                   = NULL;
+	gchar *contents;
+	gsize length;
+
+	if(g_file_load_contents_finish(G_FILE(file), result, &contents, &length, NULL, &err))
+	{
+		userscript = userscript_new(filename, contents);
+
+		fprintf(stderr,
+		        _("badwolf: Userscript %s: %zu bytes, loaded in %.3fms\n"),
+		        filename,
+		        length,
+		        (gdouble)(g_get_monotonic_time() - load->start) / 1000);
+
+		g_free(contents);
+	}
+	else
+	{
+		fprintf(stderr, _("badwolf: Error reading userscript: %s\n"), err->message);
+		g_error_free(err);
+	}
+
+	// A failed reload keeps the previous version
+	if(userscript != NULL || !load->reload) userscript_replace(filename, userscript, load->reload);
+
+	g_free(filename);
+
+	if(!load->reload)
+	{
+		if(userscript != NULL)
+			startup_loaded++;
+		else
+			startup_failed++;
+
+		if(--startup_pending == 0)
+			fprintf(stderr,
+			        _("badwolf: Notice: Userscript loading: %u loaded, %u failed to load\n"),
+			        startup_loaded,
+			        startup_failed);
+	}
+
+	g_free(load);
+}
+
+static void
+userscript_load(const gchar *filename, gboolean reload)
+{
+	struct UserscriptLoad *load = g_malloc(sizeof(struct UserscriptLoad));
+	GFile *file                 = g_file_new_for_path(filename);
+
+	load->start  = g_get_monotonic_time();
+	load->reload = reload;
+
+	g_file_load_contents_async(file, NULL, userscriptCb_loaded, load);
+	g_object_unref(file);
+}
+
+static gboolean
+userscriptCb_reload(gpointer user_data)
+{
+	const gchar *filename = (const gchar *)user_data;
+
+	if(g_file_test(filename, G_FILE_TEST_IS_REGULAR))
+		userscript_load(filename, TRUE);
+	else if(userscripts != NULL && g_hash_table_contains(userscripts, filename))
+	{
+		fprintf(stderr, _("badwolf: Userscript %s removed\n"), filename);
+		userscript_replace(filename, NULL, TRUE);
+	}
+
+	// Frees filename
+	g_hash_table_remove(reloads, filename);
+
+	return G_SOURCE_REMOVE;
+}
+
+/* userscript_schedule_reload: Reloads the userscript once its file stopped changing,
+ * editors tending to write files in several steps.
+ */
 void
-load_userscripts(WebKitUserContentManager *content_manager)
+userscript_schedule_reload(GFile *file)
+{
+	gchar *filename;
+	guint source;
+
+	if(file == NULL) return;
+
+	filename = g_file_get_path(file);
+
+	if(filename == NULL || !g_str_has_suffix(filename, ".js"))
+	{
+		g_free(filename);
+		return;
+	}
+
+	if(reloads == NULL) reloads = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	source = GPOINTER_TO_UINT(g_hash_table_lookup(reloads, filename));
+	if(source != 0) g_source_remove(source);
+
+	// Replacing the key, as the previous one is freed while the timeout gets filename
+	source = g_timeout_add(BADWOLF_USERSCRIPT_RELOAD_DELAY, userscriptCb_reload, filename);
+	g_hash_table_replace(reloads, filename, GUINT_TO_POINTER(source));
+}
+
+/* userscript_pending_reloads: Amount of userscripts waiting for their reload
+ */
+guint
+userscript_pending_reloads(void)
+{
+	return reloads != NULL ? g_hash_table_size(reloads) : 0;
+}
+
+static void
+scripts_monitorCb_changed(GFileMonitor *UNUSED(monitor),
+                          GFile *file,
+                          GFile *other_file,
+                          GFileMonitorEvent event_type,
+                          gpointer UNUSED(user_data))
+{
+	switch(event_type)
+	{
+	case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+	case G_FILE_MONITOR_EVENT_DELETED:
+	case G_FILE_MONITOR_EVENT_CREATED:
+	case G_FILE_MONITOR_EVENT_MOVED_IN:
+	case G_FILE_MONITOR_EVENT_MOVED_OUT:
+		userscript_schedule_reload(file);
+		break;
+	case G_FILE_MONITOR_EVENT_RENAMED:
+		userscript_schedule_reload(file);
+		userscript_schedule_reload(other_file);
+		break;
+	default:
+		break;
+	}
+}
+
+void
+load_userscripts(struct Window *window)
 {
 	glob_t scripts_path_glob;
-	gchar *scripts_path = g_build_filename(g_get_user_data_dir(), "badwolf", "scripts", "*.js", NULL);
-	unsigned int loaded = 0, failed = 0;
+	gchar *scripts_dir  = g_build_filename(g_get_user_data_dir(), "badwolf", "scripts", NULL);
+	gchar *scripts_path = g_build_filename(scripts_dir, "*.js", NULL);
+	GFile *dir          = g_file_new_for_path(scripts_dir);
+	GError *err         = NULL;
+
+	userscripts_window = window;
+	userscripts        = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, userscript_free);
+
+	// Kept for the whole lifetime of badwolf
+	scripts_monitor = g_file_monitor_directory(dir, G_FILE_MONITOR_WATCH_MOVES, NULL, &err);
+	if(scripts_monitor != NULL)
+		g_signal_connect(scripts_monitor, "changed", G_CALLBACK(scripts_monitorCb_changed), NULL);
+	else
+	{
+		fprintf(stderr, _("badwolf: Notice: Userscripts won't be reloaded: %s\n"), err->message);
+		g_error_free(err);
+	}
+	g_object_unref(dir);
 
 	fprintf(stderr, _("badwolf: Checking for userscripts matching %s\n"), scripts_path);
 
@@ -39,38 +575,14 @@ load_userscripts(WebKitUserContentManager *content_manager)
 		break;
 	}
 
-	for(size_t i = 0; i < scripts_path_glob.gl_pathc; i++)
-	{
-		char *filename = scripts_path_glob.gl_pathv[i];
-		gchar *contents;
-		GError *err = NULL;
-
-		if(g_file_get_contents(filename, &contents, NULL, &err) && err == NULL)
-		{
+	startup_pending = (guint)scripts_path_glob.gl_pathc;
 
-			WebKitUserScript *userscript =
-			    webkit_user_script_new(contents,
-			                           WEBKIT_USER_CONTENT_INJECT_ALL_FRAMES,
-			                           WEBKIT_USER_SCRIPT_INJECT_AT_DOCUMENT_START,
-			                           NULL,
-			                           NULL);
-			webkit_user_content_manager_add_script(content_manager, userscript);
-			loaded++;
-		}
-		else
-		{
-			fprintf(stderr, _("badwolf: Error reading userscript: %s\n"), err->message);
-			g_error_free(err);
-			failed++;
-		}
-	}
-
-	fprintf(stderr,
-	        _("badwolf: Notice: Userscript loading: %d loaded, %d failed to load\n"),
-	        loaded,
-	        failed);
+	// Read asynchronously, scripts getting added as they are read
+	for(size_t i = 0; i < scripts_path_glob.gl_pathc; i++)
+		userscript_load(scripts_path_glob.gl_pathv[i], FALSE);
 
 clean:
 	g_free(scripts_path);
+	g_free(scripts_dir);
 	globfree(&scripts_path_glob);
 }
@@ -2,6 +2,31 @@
 // SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
 // SPDX-License-Identifier: BSD-3-Clause
 
+#ifndef USERSCRIPTS_H_INCLUDED
+#define USERSCRIPTS_H_INCLUDED
+#include "badwolf.h"
+
 #include <webkit2/webkit2.h>
 
-void load_userscripts(WebKitUserContentManager *content_manager);
+/* struct UserscriptMeta: What's used of the ==UserScript== block of a userscript
+ */
+struct UserscriptMeta
+{
+	gchar *name;
+	GPtrArray *allow; /* WebKit URL patterns from @match and @include, empty for any */
+	GPtrArray *block; /* WebKit URL patterns from @exclude */
+	gboolean run_at_end;
+	gboolean noframes;
+	guint allow_dropped; /* @match/@include patterns WebKit can't match, like regular expressions */
+	guint block_dropped; /* Same for @exclude, making the script injected in more pages */
+};
+
+gchar *userscript_pattern(const gchar *pattern);
+gboolean userscript_meta_parse(const gchar *source, struct UserscriptMeta *meta);
+gboolean userscript_meta_skipped(const struct UserscriptMeta *meta);
+gboolean userscript_matches(const struct UserscriptMeta *meta, const gchar *uri);
+void userscript_meta_clear(struct UserscriptMeta *meta);
+void userscript_schedule_reload(GFile *file);
+guint userscript_pending_reloads(void);
+void load_userscripts(struct Window *window);
+#endif /* USERSCRIPTS_H_INCLUDED */
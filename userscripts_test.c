@@ -0,0 +1,204 @@
+// BadWolf: Minimalist and privacy-oriented WebKitGTK+ browser
+// SPDX-FileCopyrightText: 2019-2023 Badwolf Authors <https://hacktivis.me/projects/badwolf>
+//
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "userscripts.h"
+
+#include <glib.h>
+
+static void
+userscript_pattern_test(void)
+{
+	struct
+	{
+		const gchar *expect;
+		const gchar *pattern;
+	} cases[] = {
+	    //
+	    {"*://*/*", "*"},
+	    {"*://*/*", "<all_urls>"},
+	    {"https://example.org/*", "https://example.org/*"},
+	    {"*://*.example.org/*", "*://*.example.org/*"},
+	    {"*://example.org/*", "http*://example.org/*"},
+	    {"https://example.org/*", "https://example.org"},
+	    {NULL, "/^https?:\\/\\/example\\.org/"},
+	    {NULL, "https://example.*/*"},
+	    {NULL, "https://ex*ample.org/*"},
+	    {NULL, "example.org"} //
+	};
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		g_info("userscript_pattern(\"%s\")", cases[i].pattern);
+
+		gchar *got = userscript_pattern(cases[i].pattern);
+
+		if(g_strcmp0(got, cases[i].expect) != 0)
+		{
+			g_error("expected: \"%s\", got: \"%s\"", cases[i].expect, got);
+		}
+
+		g_free(got);
+	}
+}
+
+static void
+userscript_meta_parse_test(void)
+{
+	struct UserscriptMeta meta;
+
+	g_assert_false(userscript_meta_parse("alert(1);\n// ==UserScript==\n", &meta));
+	g_assert_false(meta.run_at_end);
+	g_assert_cmpuint(meta.allow->len, ==, 0);
+	userscript_meta_clear(&meta);
+
+	g_assert_true(userscript_meta_parse("// ==UserScript==\n"
+	                                    "// @name    Test\n"
+	                                    "// @match   https://example.org/*\n"
+	                                    "// @include /regex/\n"
+	                                    "// @exclude https://example.org/login\n"
+	                                    "// @run-at  document-start\n"
+	                                    "// @noframes\n"
+	                                    "// ==/UserScript==\n"
+	                                    "// @match https://ignored.example/*\n",
+	                                    &meta));
+	g_assert_cmpstr(meta.name, ==, "Test");
+	g_assert_cmpuint(meta.allow->len, ==, 1);
+	g_assert_cmpstr(g_ptr_array_index(meta.allow, 0), ==, "https://example.org/*");
+	g_assert_cmpuint(meta.block->len, ==, 1);
+	g_assert_cmpstr(g_ptr_array_index(meta.block, 0), ==, "https://example.org/login");
+	g_assert_cmpuint(meta.allow_dropped, ==, 1);
+	g_assert_cmpuint(meta.block_dropped, ==, 0);
+	g_assert_false(userscript_meta_skipped(&meta));
+	g_assert_false(meta.run_at_end);
+	g_assert_true(meta.noframes);
+	userscript_meta_clear(&meta);
+
+	g_assert_true(userscript_meta_parse("\n// ==UserScript==\n// ==/UserScript==\n", &meta));
+	g_assert_true(meta.run_at_end);
+	g_assert_false(meta.noframes);
+	userscript_meta_clear(&meta);
+}
+
+static void
+userscript_matches_test(void)
+{
+	struct UserscriptMeta meta;
+	struct
+	{
+		gboolean expect;
+		const gchar *uri;
+	} cases[] = {
+	    //
+	    {TRUE, "https://example.org/"},
+	    {TRUE, "https://example.org"},
+	    {TRUE, "http://www.example.org/page?q=1"},
+	    {TRUE, "https://EXAMPLE.org:8080/page"},
+	    {FALSE, "https://example.org/login"},
+	    {FALSE, "https://notexample.org/"},
+	    {FALSE, "ftp://example.org/"},
+	    {FALSE, "about:blank"},
+	    {FALSE, NULL} //
+	};
+
+	g_assert_true(userscript_meta_parse("// ==UserScript==\n"
+	                                    "// @match   *://*.example.org/*\n"
+	                                    "// @exclude https://example.org/login\n"
+	                                    "// ==/UserScript==\n",
+	                                    &meta));
+
+	for(size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+	{
+		g_info("userscript_matches(\"%s\")", cases[i].uri);
+
+		if(userscript_matches(&meta, cases[i].uri) != cases[i].expect)
+		{
+			g_error("expected: %d, got: %d", cases[i].expect, !cases[i].expect);
+		}
+	}
+
+	userscript_meta_clear(&meta);
+
+	g_assert_false(userscript_meta_parse("alert(1);\n", &meta));
+	g_assert_true(userscript_matches(&meta, "https://example.org/"));
+	userscript_meta_clear(&meta);
+}
+
+static void
+userscript_meta_skipped_test(void)
+{
+	struct UserscriptMeta meta;
+
+	// Runs everywhere, the unsupported exclusion only making it broader
+	g_assert_true(userscript_meta_parse("// ==UserScript==\n"
+	                                    "// @exclude /login/\n"
+	                                    "// ==/UserScript==\n",
+	                                    &meta));
+	g_assert_cmpuint(meta.allow_dropped, ==, 0);
+	g_assert_cmpuint(meta.block_dropped, ==, 1);
+	g_assert_false(userscript_meta_skipped(&meta));
+	g_assert_true(userscript_matches(&meta, "https://example.org/login"));
+	userscript_meta_clear(&meta);
+
+	// Only the exclusion is dropped
+	g_assert_true(userscript_meta_parse("// ==UserScript==\n"
+	                                    "// @match   https://example.org/*\n"
+	                                    "// @exclude /\\/login/\n"
+	                                    "// ==/UserScript==\n",
+	                                    &meta));
+	g_assert_cmpuint(meta.allow_dropped, ==, 0);
+	g_assert_cmpuint(meta.block_dropped, ==, 1);
+	g_assert_false(userscript_meta_skipped(&meta));
+	g_assert_true(userscript_matches(&meta, "https://example.org/"));
+	g_assert_false(userscript_matches(&meta, "https://example.net/"));
+	userscript_meta_clear(&meta);
+
+	// None of the inclusions survived, it would be injected everywhere
+	g_assert_true(userscript_meta_parse("// ==UserScript==\n"
+	                                    "// @include /example\\.org/\n"
+	                                    "// @exclude https://example.org/login\n"
+	                                    "// ==/UserScript==\n",
+	                                    &meta));
+	g_assert_cmpuint(meta.allow_dropped, ==, 1);
+	g_assert_cmpuint(meta.block_dropped, ==, 0);
+	g_assert_true(userscript_meta_skipped(&meta));
+	userscript_meta_clear(&meta);
+
+	g_assert_false(userscript_meta_parse("alert(1);\n", &meta));
+	g_assert_false(userscript_meta_skipped(&meta));
+	userscript_meta_clear(&meta);
+}
+
+static void
+userscript_schedule_reload_test(void)
+{
+	// Missing, so the reload only has to forget it
+	GFile *file = g_file_new_for_path("/nonexistent/badwolf-userscripts_test.js");
+	gint64 end  = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+
+	// Like the burst of events of an editor saving the file
+	userscript_schedule_reload(file);
+	userscript_schedule_reload(file);
+	g_assert_cmpuint(userscript_pending_reloads(), ==, 1);
+
+	while(userscript_pending_reloads() > 0 && g_get_monotonic_time() < end)
+		g_main_context_iteration(NULL, TRUE);
+	g_assert_cmpuint(userscript_pending_reloads(), ==, 0);
+
+	g_object_unref(file);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/userscript_pattern/test", userscript_pattern_test);
+	g_test_add_func("/userscript_meta_parse/test", userscript_meta_parse_test);
+	g_test_add_func("/userscript_matches/test", userscript_matches_test);
+	g_test_add_func("/userscript_meta_skipped/test", userscript_meta_skipped_test);
+	g_test_add_func("/userscript_schedule_reload/test", userscript_schedule_reload_test);
+
+	return g_test_run();
+}